@@ -11,41 +11,107 @@
 
 #include "bu/builder_unit.h"
 
+#include "transport/completion_waiter.h"
+#include "transport/write_ring.h"
+
 namespace lseb {
 
-BuilderUnit::BuilderUnit(
-    int nodes,
-    int bulk_size,
-    int credits,
-    int max_fragment_size,
-    int id)
-    : m_data_vect(nodes),
-      m_bulk_size(bulk_size),
-      m_credits(credits),
-      m_max_fragment_size(max_fragment_size),
-      m_id(id),
-      m_data_ptr(
-          new unsigned char[max_fragment_size * bulk_size * credits * nodes]) {
+BuilderUnit::BuilderUnit(Options const& options)
+    : m_data_vect(options.nodes),
+      m_bulk_size(options.bulk_size),
+      m_credits(options.credits),
+      m_max_fragment_size(options.max_fragment_size),
+      m_id(options.id),
+      m_shared_memory(options.shared_memory),
+      m_shared_receive_buffers(options.shared_receive_buffers),
+      m_remote_peers(0),
+      m_shared_completion_queue(options.shared_completion_queue),
+      m_rdm_endpoints(options.rdm_endpoints),
+      m_rdma_write(options.rdma_write),
+      m_spin_time(options.spin_time),
+      m_rails(options.rails),
+      m_datagram_size(options.datagram_size),
+      m_placement(options.placement),
+      m_serve_feedback(options.serve_feedback),
+      m_feedback_port_offset(options.feedback_port_offset),
+      m_short_multievents(options.short_multievents),
+      m_rail_data(options.nodes),
+      m_next_read(options.nodes, 0),
+      m_next_release(options.nodes, 0),
+      m_rail_release(options.rails),
+      m_incomplete_events(0),
+      m_peak_held(0),
+      m_peak_source(0) {
+  // Reserve the space for all the buffers a source can hold, so that polling
+  // does not allocate
+  int const messages =
+      m_rdma_write ? m_credits * write_ring::MESSAGES_PER_BUFFER : m_credits;
+  int const held = std::max(messages, m_shared_receive_buffers);
+  m_completed_wr.resize(held);
+  for (auto& iov_vect : m_data_vect) {
+    iov_vect.reserve(held * m_rails);
+  }
+  for (auto& iov_vect : m_rail_release) {
+    iov_vect.reserve(held);
+  }
 }
 
 int BuilderUnit::read_data(int id) {
   auto& iov_vect = m_data_vect[id];
-  int const old_size = iov_vect.size();
-  auto& conn = *(m_connection_ids.at(id));
-  std::vector<iovec> new_data = conn.poll_completed_recv();
-  if (!new_data.empty()) {
+  auto& conns = m_connection_ids.at(id);
+  int count = 0;
+  if (conns.size() == 1) {
+    count = conns.front()->poll_completed_recv(
+        m_completed_wr.data(),
+        m_completed_wr.size());
     iov_vect.insert(
         std::end(iov_vect),
-        std::begin(new_data),
-        std::end(new_data));
+        std::begin(m_completed_wr),
+        std::begin(m_completed_wr) + count);
+  } else {
+    auto& rail_data = m_rail_data[id];
+    for (size_t rail = 0; rail < conns.size(); ++rail) {
+      int const rail_count = conns[rail]->poll_completed_recv(
+          m_completed_wr.data(),
+          m_completed_wr.size());
+      rail_data[rail].insert(
+          std::end(rail_data[rail]),
+          std::begin(m_completed_wr),
+          std::begin(m_completed_wr) + rail_count);
+      count += rail_count;
+    }
+    int& rail = m_next_read[id];
+    while (!rail_data[rail].empty()) {
+      iov_vect.push_back(rail_data[rail].front());
+      rail_data[rail].pop_front();
+      rail = (rail + 1) % conns.size();
+    }
   }
-  return iov_vect.size() - old_size;
+  // With a shared receive queue a source that is ahead of the others can take
+  // many buffers, keep track of it
+  if (iov_vect.size() > m_peak_held) {
+    m_peak_held = iov_vect.size();
+    m_peak_source = id;
+  }
+  return count;
 }
 
 bool BuilderUnit::check_data() {
+  // The multievents lost by the datagrams are empty, the others must start
+  // with the same event
+  auto const first = std::find_if(
+      std::begin(m_data_vect),
+      std::end(m_data_vect),
+      [](std::vector<iovec> const& data) {return data.front().iov_len;});
+  if (first == std::end(m_data_vect)) {
+    return true;
+  }
   uint64_t first_evt_id = pointer_cast<EventHeader>(
-      m_data_vect[0].front().iov_base)->id;
+      first->front().iov_base)->id;
   for (auto& data : m_data_vect) {
+    if (!data.front().iov_len) {
+      continue;
+    }
     uint64_t id = pointer_cast<EventHeader>(data.front().iov_base)->id;
     uint64_t flags = pointer_cast<EventHeader>(data.front().iov_base)->flags;
     uint64_t length = pointer_cast<EventHeader>(data.front().iov_base)->length;
@@ -53,7 +119,7 @@ bool BuilderUnit::check_data() {
       LOG_ERROR
         << "Remote event id ("
         << id
-        << ") is different from the event id of the BU 0 ("
+        << ") is different from the event id of the first BU ("
         << first_evt_id
         << ")";
       return false;
@@ -70,20 +136,63 @@ bool BuilderUnit::check_data() {
   return true;
 }
 
+// The multievents of a wr have the same events from all the sources: they
+// are counted from the headers of the first one that is not lost, in each of
+// the segments in which it was delivered
+int BuilderUnit::count_events(int wr) const {
+  if (!m_short_multievents) {
+    return m_bulk_size;
+  }
+  for (size_t i = 0; i < m_data_vect.size(); ++i) {
+    iovec const& message = m_data_vect[i][wr];
+    if (message.iov_len) {
+      iovec segments[MAX_SEND_SGE];
+      size_t const n = m_connection_ids.at(i).front()->received_segments(
+          message,
+          segments);
+      int events = 0;
+      for (size_t s = 0; s < n; ++s) {
+        unsigned char const* const begin =
+            static_cast<unsigned char const*>(segments[s].iov_base);
+        for (auto it = begin; it < begin + segments[s].iov_len;
+            it += pointer_cast<EventHeader const>(it)->length) {
+          ++events;
+        }
+      }
+      return events;
+    }
+  }
+  return m_bulk_size;
+}
+
 size_t BuilderUnit::release_data(int id, int n) {
   auto& iov_vect = m_data_vect[id];
   assert(iov_vect.size() >= n);
-  std::vector<iovec> sub_vect(std::begin(iov_vect), std::begin(iov_vect) + n);
-  // Erase iovec
-  iov_vect.erase(std::begin(iov_vect), std::begin(iov_vect) + n);
-  size_t const bytes = iovec_length(sub_vect);
-  // Release iovec
-  auto& conn = *(m_connection_ids.at(id));
+  size_t bytes = 0;
   // Reset len of iovec
-  for (auto& iov : sub_vect) {
-    iov.iov_len = m_max_fragment_size * m_bulk_size;  // chunk size
-    conn.post_recv(iov);
+  for (auto it = std::begin(iov_vect); it != std::begin(iov_vect) + n; ++it) {
+    bytes += it->iov_len;
+    it->iov_len = m_max_fragment_size * m_bulk_size;  // chunk size
   }
+  // Release iovec, all together on each rail
+  auto& conns = m_connection_ids.at(id);
+  if (conns.size() == 1) {
+    conns.front()->post_recv(iov_vect.data(), n);
+  } else {
+    int& rail = m_next_release[id];
+    for (auto it = std::begin(iov_vect); it != std::begin(iov_vect) + n; ++it) {
+      m_rail_release[rail].push_back(*it);
+      rail = (rail + 1) % conns.size();
+    }
+    for (size_t r = 0; r < conns.size(); ++r) {
+      if (!m_rail_release[r].empty()) {
+        conns[r]->post_recv(m_rail_release[r].data(), m_rail_release[r].size());
+        m_rail_release[r].clear();
+      }
+    }
+  }
+  // Erase iovec
+  iov_vect.erase(std::begin(iov_vect), std::begin(iov_vect) + n);
   return bytes;
 }
 
@@ -91,34 +200,189 @@ void BuilderUnit::connect(std::vector<Endpoint> const& endpoints) {
 
   // Connections
 
-  Acceptor acceptor(m_credits);
+  auto const t_start = std::chrono::high_resolution_clock::now();
 
-  acceptor.listen(endpoints[m_id].hostname(), endpoints[m_id].port());
+  // One acceptor for each rail, listening on the address of its interface
+  std::vector<std::unique_ptr<Acceptor> > acceptors;
+  for (int rail = 0; rail < m_rails; ++rail) {
+    acceptors.emplace_back(new Acceptor(m_credits));
+  }
+  shm::Acceptor shm_acceptor(m_credits);
+  local::Acceptor local_acceptor(m_credits);
+
+  // Peers on the same node connect through shared memory, while the own
+  // Readout Unit uses an in-process connection
+  int local_peers = 0;
+  if (m_shared_memory) {
+    local_peers = std::count_if(
+        std::begin(endpoints),
+        std::end(endpoints),
+        [&](Endpoint const& ep) {return is_local(ep, endpoints[m_id]);}) - 1;
+  }
+  int const remote_peers = endpoints.size() - local_peers - 1;
+  m_remote_peers = remote_peers;
+
+  // The remote peers can share a single pool of receive buffers, sized by
+  // the data in flight instead of by the number of peers. The shared queues
+  // are only available with a single rail.
+  if (!remote_peers) {
+    m_shared_receive_buffers = 0;
+  }
+  bool const shared_receive = m_shared_receive_buffers;
+  size_t const remote_chunks =
+      shared_receive ?
+          m_shared_receive_buffers : remote_peers * m_credits * m_rails;
+  if (m_shared_completion_queue && remote_peers) {
+    m_cq = std::make_shared<CompletionQueue>(
+        m_rdma_write ?
+            remote_chunks * write_ring::MESSAGES_PER_BUFFER : remote_chunks,
+        m_spin_time > 0);
+  }
+  // With datagrams, a single endpoint receives from all the remote sources
+  if (m_datagram_size && remote_peers) {
+    m_dgram_acceptor.reset(new dgram::Acceptor(m_credits, m_datagram_size));
+    if (m_spin_time) {
+      m_dgram_acceptor->enable_wait();
+    }
+  }
+  for (auto& acceptor : acceptors) {
+    if (shared_receive) {
+      acceptor->share_receive_queue(m_shared_receive_buffers);
+    }
+    if (m_spin_time) {
+      acceptor->enable_wait();
+    }
+    if (m_cq) {
+      acceptor->share_completion_queue(m_cq);
+    }
+    if (m_rdm_endpoints) {
+      acceptor->enable_rdm();
+    }
+    // The buffers of each remote peer make up the ring it writes into
+    if (m_rdma_write) {
+      acceptor->enable_write_ring();
+    }
+  }
+
+  if (m_dgram_acceptor) {
+    m_dgram_acceptor->listen(
+        endpoints[m_id].hostname(),
+        endpoints[m_id].port());
+  } else if (remote_peers) {
+    for (int rail = 0; rail < m_rails; ++rail) {
+      acceptors[rail]->listen(
+          endpoints[m_id].rails()[rail],
+          endpoints[m_id].port());
+    }
+  }
+  if (local_peers) {
+    shm_acceptor.listen(endpoints[m_id].hostname(), endpoints[m_id].port());
+  }
+  local_acceptor.listen(endpoints[m_id].hostname(), endpoints[m_id].port());
+  if (m_serve_feedback) {
+    m_feedback.reset(
+        new feedback::Server(
+            endpoints[m_id].hostname(),
+            std::to_string(
+                std::stoi(endpoints[m_id].port()) + m_feedback_port_offset),
+            endpoints.size()));
+  }
 
   LOG_INFO << "Builder Unit - Waiting for connections...";
+  auto const t_listen = std::chrono::high_resolution_clock::now();
 
   size_t const chunk_size = m_max_fragment_size * m_bulk_size;
 
+  // The own Readout Unit hands over its multievents in place: the receive
+  // buffers of its connection only count the credits, and need no memory
+  size_t const local_chunks = local_peers * m_credits;
+  unsigned char* pool_ptr = nullptr;
+  if (remote_chunks + local_chunks) {
+    m_data_segment.reset(
+        new shm::Segment(
+            (remote_chunks + local_chunks) * chunk_size,
+            m_placement));
+    pool_ptr = m_data_segment->begin();
+  }
+  unsigned char* base_data_ptr = pool_ptr;
+  if (shared_receive) {
+    base_data_ptr += remote_chunks * chunk_size;
+  }
+
+  double accept_time = 0.;
+  double setup_time = 0.;
   for (int i = 0; i < endpoints.size(); ++i) {
 
-    // Create a temporary entry in the map with the local id
-    auto p = m_connection_ids.emplace(
-        std::make_pair(i, std::unique_ptr<Socket>(acceptor.accept())));
-    auto& conn = *(m_connection_ids.at(i));
+    // Create a temporary entry in the map with the local id. The rails of a
+    // remote source are accepted independently, so they may come from
+    // different Readout Units: since all of them send the multievents of the
+    // same events in the same order, the rails of a source only need to be
+    // taken in turn.
+    auto& conns = m_connection_ids[i];
+    auto const t_accept = std::chrono::high_resolution_clock::now();
+    if (i < remote_peers && m_dgram_acceptor) {
+      conns.push_back(m_dgram_acceptor->accept());
+    } else if (i < remote_peers) {
+      for (auto& acceptor : acceptors) {
+        conns.push_back(acceptor->accept());
+      }
+    } else if (i < remote_peers + local_peers) {
+      conns.push_back(shm_acceptor.accept());
+    } else {
+      conns.push_back(local_acceptor.accept());
+    }
+    m_rail_data[i].resize(conns.size());
+    auto const t_setup = std::chrono::high_resolution_clock::now();
+    accept_time += std::chrono::duration<double>(t_setup - t_accept).count();
 
-    unsigned char* base_data_ptr = m_data_ptr.get()
-        + i * chunk_size * m_credits;
-    conn.register_memory(base_data_ptr, chunk_size * m_credits);
+    for (size_t rail = 0; rail < conns.size(); ++rail) {
+      auto& conn = *conns[rail];
 
-    for (int j = 0; j < m_credits; ++j) {
-      conn.post_recv({ base_data_ptr + j * chunk_size, chunk_size });
-    }
+      std::vector<iovec> iov_vect;
+      if (shared_receive && i < remote_peers) {
+        // The pool is posted once, through the first connection
+        conn.register_memory(pool_ptr, remote_chunks * chunk_size);
+        if (i == 0) {
+          for (size_t j = 0; j < remote_chunks; ++j) {
+            iov_vect.push_back({ pool_ptr + j * chunk_size, chunk_size });
+          }
+        }
+      } else if (i >= remote_peers + local_peers) {
+        for (int j = 0; j < m_credits; ++j) {
+          iov_vect.push_back({ nullptr, chunk_size });
+        }
+      } else {
+        conn.register_memory(base_data_ptr, chunk_size * m_credits);
+        for (int j = 0; j < m_credits; ++j) {
+          iov_vect.push_back({ base_data_ptr + j * chunk_size, chunk_size });
+        }
+        base_data_ptr += chunk_size * m_credits;
+      }
+      conn.post_recv(iov_vect.data(), iov_vect.size());
 
-    LOG_INFO
-      << "Builder Unit - Connection established with ip "
-      << conn.peer_hostname();
+      LOG_INFO
+        << "Builder Unit - Connection established with ip "
+        << conn.peer_hostname()
+        << (conns.size() > 1 ? " (rail " + std::to_string(rail) + ")" : "");
+    }
+    setup_time += std::chrono::duration<double>(
+        std::chrono::high_resolution_clock::now() - t_setup).count();
   }
-  LOG_INFO << "Builder Unit - All connections established";
+
+  // The time spent waiting for the peers is mostly the one they take to
+  // start and to reach this node, the setup the one spent registering and
+  // posting the receive buffers
+  LOG_INFO
+    << "Builder Unit - All connections established in "
+    << std::chrono::duration<double>(
+        std::chrono::high_resolution_clock::now() - t_start).count()
+    << " s (listen "
+    << std::chrono::duration<double>(t_listen - t_start).count()
+    << " s, waiting for peers "
+    << accept_time
+    << " s, setup "
+    << setup_time
+    << " s)";
 }
 
 void BuilderUnit::run() {
@@ -129,13 +393,38 @@ void BuilderUnit::run() {
       std::chrono::high_resolution_clock::now();
   std::chrono::high_resolution_clock::time_point t_active;
   double active_time = 0;
+  double received_bytes = 0;  // as reported by the completions
+
+  // Receive buffers that a source can fill, as advertised with the feedback
+  size_t const capacity = m_rails
+      * (m_rdma_write ?
+          m_credits * write_ring::MESSAGES_PER_BUFFER : m_credits);
+
+  if (m_feedback) {
+    m_feedback->update(capacity, 0);
+  }
+
+  // Once idle for m_spin_time, block until some connection completes
+  std::unique_ptr<CompletionWaiter> waiter;
+  if (m_spin_time) {
+    waiter.reset(new CompletionWaiter(std::chrono::microseconds(m_spin_time)));
+    for (auto& conns : m_connection_ids) {
+      for (auto& conn : conns.second) {
+        waiter->add(*conn);
+      }
+    }
+  }
 
   while (true) {
 
     bool active_flag = false;
     t_active = std::chrono::high_resolution_clock::now();
 
-    // Acquire
+    // Acquire. With a shared queue, the remote connections only return what
+    // it has handed to them.
+    if (m_cq) {
+      m_cq->poll();
+    }
     int min_wrs = m_credits;
     for (int i = 0; i < m_connection_ids.size(); ++i) {
       int read_wrs = read_data(i);
@@ -155,36 +444,114 @@ void BuilderUnit::run() {
       if (!check_data()) {
         throw std::runtime_error("Error checking data");
       }
+      if (m_dgram_acceptor) {
+        for (int wr = 0; wr < min_wrs; ++wr) {
+          if (std::any_of(
+              std::begin(m_data_vect),
+              std::end(m_data_vect),
+              [wr](std::vector<iovec> const& data) {
+                return !data[wr].iov_len;
+              })) {
+            m_incomplete_events += count_events(wr);
+          }
+        }
+      }
+
+      int events = 0;
+      for (int wr = 0; wr < min_wrs; ++wr) {
+        events += count_events(wr);
+      }
 
       // Release
       for (int i = 0; i < m_connection_ids.size(); ++i) {
-        size_t const bytes = release_data(i, min_wrs);
+        received_bytes += release_data(i, min_wrs);
         LOG_TRACE
           << "Builder Unit - Released "
           << min_wrs
           << " wrs of conn "
           << i;
       }
-      frequency.add(min_wrs * m_bulk_size * m_connection_ids.size());
+      frequency.add(events * m_connection_ids.size());
+    }
+
+    // Advertise to the Readout Units the multievents held by the source that
+    // is furthest ahead, which are waiting for the other sources
+    if (m_feedback && (active_flag || min_wrs)) {
+      size_t backlog = 0;
+      for (auto const& data : m_data_vect) {
+        backlog = std::max(backlog, data.size());
+      }
+      m_feedback->update(
+          backlog < capacity ? capacity - backlog : 0,
+          backlog);
     }
 
     if (active_flag) {
       active_time += std::chrono::duration<double>(
           std::chrono::high_resolution_clock::now() - t_active).count();
     }
+    if (waiter) {
+      waiter->progress(active_flag);
+    }
 
     if (frequency.check()) {
 
       double tot_time = std::chrono::duration<double>(
           std::chrono::high_resolution_clock::now() - t_tot).count();
 
+      double const rate = frequency.frequency();
       LOG_INFO
         << "Builder Unit: "
-        << frequency.frequency() / std::mega::num
-        << " MHz - "
+        << rate / std::mega::num
+        << " MHz, "
+        << received_bytes / tot_time / std::giga::num * 8.
+        << " Gb/s - "
         << active_time / tot_time * 100.
         << " %";
+      if (m_shared_receive_buffers) {
+        LOG_INFO
+          << "Builder Unit - Up to "
+          << m_peak_held
+          << " receive buffers held by conn "
+          << m_peak_source;
+        size_t held = 0;
+        for (int i = 0; i < m_remote_peers; ++i) {
+          held += m_data_vect[i].size();
+        }
+        if (!rate
+            && held == static_cast<size_t>(m_shared_receive_buffers)) {
+          LOG_WARNING
+            << "Builder Unit - Shared receive buffers exhausted while waiting"
+            << " for the other sources: increase SHARED_RECEIVE_BUFFERS";
+        }
+        m_peak_held = 0;
+      }
+      if (m_dgram_acceptor) {
+        dgram::Statistics const losses = m_dgram_acceptor->statistics();
+        LOG_INFO
+          << "Builder Unit - Lost "
+          << losses.lost_multievents
+          << " multievents ("
+          << losses.lost_fragments
+          << " fragments of the partially received ones), "
+          << m_incomplete_events
+          << " incomplete events, "
+          << losses.late_fragments
+          << " late, "
+          << losses.duplicate_fragments
+          << " duplicate and "
+          << losses.dropped_fragments
+          << " dropped fragments";
+        m_incomplete_events = 0;
+      }
+      if (waiter) {
+        LOG_INFO
+          << "Builder Unit - Blocked "
+          << waiter->blocks()
+          << " times waiting for completions";
+      }
       active_time = 0;
+      received_bytes = 0;
       t_tot = std::chrono::high_resolution_clock::now();
     }
   }
@@ -1,36 +1,100 @@
 #ifndef BU_BUILDER_UNIT_H
 #define BU_BUILDER_UNIT_H
 
+#include <deque>
 #include <map>
+#include <memory>
+#include <vector>
 
 #include <sys/uio.h>
 
+#include "common/huge_pages.h"
 #include "transport/transport.h"
 #include "transport/endpoints.h"
 
 namespace lseb {
 
 class BuilderUnit {
-  std::map<int, std::unique_ptr<Socket> > m_connection_ids;
+ public:
+  // Settings of the Builder Unit, from the configuration
+  struct Options {
+    int nodes = 0;
+    int bulk_size = 0;  // events of a multievent
+    int credits = 0;
+    int max_fragment_size = 0;
+    int id = 0;
+    bool shared_memory = false;
+    int shared_receive_buffers = 0;  // 0 for a receive queue per source
+    bool shared_completion_queue = false;
+    bool rdm_endpoints = false;
+    bool rdma_write = false;
+    int spin_time = 0;  // us, 0 to always poll
+    int rails = 1;
+    int datagram_size = 0;  // 0 for reliable connections
+    MemoryPlacement placement;  // of the receive buffers
+    bool serve_feedback = false;  // to the Readout Units, for their assignment
+    int feedback_port_offset = 1000;  // from the port of the endpoint
+    bool short_multievents = false;  // flushed before bulk_size events
+  };
+
+ private:
+  // Connections from each source, one per rail if remote
+  std::map<int, std::vector<std::unique_ptr<Connection> > > m_connection_ids;
   std::vector<std::vector<iovec> > m_data_vect;
+  std::vector<iovec> m_completed_wr;
   int m_bulk_size;
   int m_credits;
   int m_max_fragment_size;
   int m_id;
+  bool m_shared_memory;
+  int m_shared_receive_buffers;
+  int m_remote_peers;  // connections from 0 to m_remote_peers - 1
+  bool m_shared_completion_queue;
+  bool m_rdm_endpoints;
+  bool m_rdma_write;
+  int m_spin_time;  // us, 0 to always poll
+  int m_rails;
+  int m_datagram_size;  // 0 for reliable connections
+  MemoryPlacement m_placement;  // of the receive buffers
+  bool m_serve_feedback;
+  int m_feedback_port_offset;
+  bool m_short_multievents;  // flushed before m_bulk_size events
+
+  // A source sends its multievents through its rails in turn: the ones
+  // received on a rail wait here for those sent before them on the others.
+  // The buffers go back to the rail they came from.
+  std::vector<std::vector<std::deque<iovec> > > m_rail_data;
+  std::vector<int> m_next_read;  // rail of the next multievent, by source
+  std::vector<int> m_next_release;
+  std::vector<std::vector<iovec> > m_rail_release;  // reused, by rail
+
+  // Completions of the remote connections, when they share a single queue
+  std::shared_ptr<CompletionQueue> m_cq;
+
+  // With datagrams, the remote sources are accepted by m_dgram_acceptor and
+  // their lost multievents are delivered empty: the events built from them
+  // since the last report are incomplete
+  std::unique_ptr<dgram::Acceptor> m_dgram_acceptor;
+  uint64_t m_incomplete_events;
+
+  // Shareable memory, so that local peers can write into it. It is allocated
+  // once the number of local and remote peers is known.
+  std::unique_ptr<shm::Segment> m_data_segment;
+
+  // Answers the Readout Units that ask for the free buffers and the backlog
+  std::unique_ptr<feedback::Server> m_feedback;
 
-  std::unique_ptr<unsigned char[]> m_data_ptr;
+  // Largest number of buffers held by a single source, since the last report
+  size_t m_peak_held;
+  int m_peak_source;
 
   int read_data(int id);
   bool check_data();
+  int count_events(int wr) const;
   size_t release_data(int id, int n);
 
  public:
-  BuilderUnit(
-    int nodes,
-    int bulk_size,
-    int credits,
-    int max_fragment_size,
-    int id);
+  explicit BuilderUnit(Options const& options);
   void connect(std::vector<Endpoint> const& endpoints);
   void run();
 };
@@ -0,0 +1,50 @@
+#ifndef COMMON_BACKOFF_H
+#define COMMON_BACKOFF_H
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+#include <cassert>
+
+namespace lseb {
+
+// Delays between the attempts of an operation: they double from min up to
+// max, and each one is drawn between half and one and a half times the
+// current delay, so that many nodes retrying together spread out.
+
+class Backoff {
+  std::chrono::milliseconds const m_min;
+  std::chrono::milliseconds const m_max;
+  std::chrono::milliseconds m_current;
+  std::default_random_engine m_engine;
+
+ public:
+  Backoff(
+      std::chrono::milliseconds min = std::chrono::milliseconds(10),
+      std::chrono::milliseconds max = std::chrono::milliseconds(1000))
+      :
+        m_min(min),
+        m_max(max),
+        m_current(min),
+        m_engine(std::random_device()()) {
+    assert(m_min.count() > 0 && m_min <= m_max);
+  }
+
+  std::chrono::milliseconds next() {
+    std::uniform_int_distribution<std::chrono::milliseconds::rep> jitter(
+        m_current.count() / 2,
+        m_current.count() * 3 / 2);
+    std::chrono::milliseconds const delay(jitter(m_engine));
+    m_current = std::min(m_current * 2, m_max);
+    return delay;
+  }
+
+  void reset() {
+    m_current = m_min;
+  }
+};
+
+}
+
+#endif
@@ -0,0 +1,186 @@
+#ifndef COMMON_HUGE_PAGES_H
+#define COMMON_HUGE_PAGES_H
+
+#include <fstream>
+#include <string>
+
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <ifaddrs.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+#include "common/exception.h"
+
+namespace lseb {
+
+// Placement of the large buffers: huge pages, mapped explicitly, cut the TLB
+// misses and the cost of registering the memory with the network card, and
+// binding the memory to the NUMA node of the card avoids the DMA across the
+// sockets of the node.
+struct MemoryPlacement {
+  size_t page_size;  // 0 for the default pages, or 2 MiB or 1 GiB
+  int numa_node;  // -1 for the default policy
+
+  MemoryPlacement(size_t page_size = 0, int numa_node = -1)
+      :
+        page_size(page_size),
+        numa_node(numa_node) {
+  }
+};
+
+namespace huge_pages {
+
+inline size_t round_up(size_t size, size_t page_size) {
+  return page_size ? (size + page_size - 1) / page_size * page_size : size;
+}
+
+// Flags of mmap and memfd_create that select the huge pages, which share the
+// same encoding of their size
+inline int size_flags(size_t page_size) {
+  int shift = 0;
+  while ((size_t(1) << shift) < page_size) {
+    ++shift;
+  }
+  return shift << MAP_HUGE_SHIFT;
+}
+
+// Bind the memory to the node of placement, and ask for transparent huge
+// pages if it could not be mapped with huge pages. Both are hints: the
+// memory is still usable if they fail.
+inline void place(
+    void* addr,
+    size_t size,
+    MemoryPlacement const& placement,
+    bool huge) {
+  if (placement.page_size && !huge) {
+    madvise(addr, size, MADV_HUGEPAGE);
+  }
+  if (placement.numa_node >= 0) {
+    unsigned long const nodemask = 1UL << placement.numa_node;
+    syscall(
+        SYS_mbind,
+        addr,
+        size,
+        MPOL_BIND,
+        &nodemask,
+        sizeof(nodemask) * 8,
+        MPOL_MF_MOVE);
+  }
+}
+
+// NUMA node of the network interface that owns the address of hostname, -1
+// if unknown (e.g. the loopback or a virtual interface)
+inline int interface_numa_node(std::string const& hostname) {
+  addrinfo hints;
+  std::memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  addrinfo* res;
+  if (getaddrinfo(hostname.c_str(), nullptr, &hints, &res)) {
+    return -1;
+  }
+  in_addr const addr = reinterpret_cast<sockaddr_in*>(res->ai_addr)->sin_addr;
+  freeaddrinfo(res);
+
+  ifaddrs* ifaddr;
+  if (getifaddrs(&ifaddr)) {
+    return -1;
+  }
+  std::string iface;
+  for (ifaddrs* ifa = ifaddr; ifa; ifa = ifa->ifa_next) {
+    if (ifa->ifa_addr && ifa->ifa_addr->sa_family == AF_INET
+        && reinterpret_cast<sockaddr_in*>(ifa->ifa_addr)->sin_addr.s_addr
+            == addr.s_addr) {
+      iface = ifa->ifa_name;
+      break;
+    }
+  }
+  freeifaddrs(ifaddr);
+
+  int node = -1;
+  if (!iface.empty()) {
+    std::ifstream file("/sys/class/net/" + iface + "/device/numa_node");
+    if (!(file >> node)) {
+      node = -1;
+    }
+  }
+  return node;
+}
+
+}
+
+// Anonymous memory placed with a MemoryPlacement. Without huge pages
+// available, it falls back to the default pages with transparent huge pages.
+
+class HugeBuffer {
+
+  unsigned char* m_begin;
+  size_t m_size;
+  bool m_huge;
+
+ public:
+
+  HugeBuffer(size_t size, MemoryPlacement const& placement)
+      :
+        m_begin(nullptr),
+        m_size(huge_pages::round_up(size, placement.page_size)),
+        m_huge(false) {
+    void* addr = MAP_FAILED;
+    if (placement.page_size) {
+      addr = mmap(
+          nullptr,
+          m_size,
+          PROT_READ | PROT_WRITE,
+          MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB
+              | huge_pages::size_flags(placement.page_size),
+          -1,
+          0);
+      m_huge = addr != MAP_FAILED;
+    }
+    if (addr == MAP_FAILED) {
+      addr = mmap(
+          nullptr,
+          m_size,
+          PROT_READ | PROT_WRITE,
+          MAP_PRIVATE | MAP_ANONYMOUS,
+          -1,
+          0);
+    }
+    if (addr == MAP_FAILED) {
+      throw exception::memory::generic_error(
+          "Error on mmap: " + std::string(strerror(errno)));
+    }
+    m_begin = static_cast<unsigned char*>(addr);
+    huge_pages::place(m_begin, m_size, placement, m_huge);
+  }
+
+  HugeBuffer(HugeBuffer const& other) = delete;  // non construction-copyable
+  HugeBuffer& operator=(HugeBuffer const&) = delete;  // non copyable
+
+  ~HugeBuffer() {
+    munmap(m_begin, m_size);
+  }
+
+  unsigned char* begin() const {
+    return m_begin;
+  }
+  unsigned char* end() const {
+    return m_begin + m_size;
+  }
+  size_t size() const {
+    return m_size;
+  }
+  // Whether it is mapped with huge pages
+  bool huge() const {
+    return m_huge;
+  }
+};
+
+}
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef COMMON_SPSC_QUEUE_H
+#define COMMON_SPSC_QUEUE_H
+
+#include <atomic>
+#include <vector>
+
+#include <cassert>
+#include <cstdint>
+
+namespace lseb {
+
+// Bounded lock-free queue for one producer thread and one consumer thread
+
+template<typename T>
+class SpscQueue {
+  static size_t const cache_line = 64;
+
+  std::vector<T> m_ring;
+  char m_pad0[cache_line];
+  std::atomic<uint64_t> m_head;  // written by the producer
+  char m_pad1[cache_line - sizeof(std::atomic<uint64_t>)];
+  std::atomic<uint64_t> m_tail;  // written by the consumer
+  char m_pad2[cache_line - sizeof(std::atomic<uint64_t>)];
+
+ public:
+  explicit SpscQueue(size_t size)
+      : m_ring(size),
+        m_head(0),
+        m_tail(0) {
+    assert(size > 0);
+  }
+
+  bool push(T const& value) {
+    uint64_t const head = m_head.load(std::memory_order_relaxed);
+    if (head - m_tail.load(std::memory_order_acquire) == m_ring.size()) {
+      return false;
+    }
+    m_ring[head % m_ring.size()] = value;
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(T& value) {
+    uint64_t const tail = m_tail.load(std::memory_order_relaxed);
+    if (tail == m_head.load(std::memory_order_acquire)) {
+      return false;
+    }
+    value = m_ring[tail % m_ring.size()];
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool empty() const {
+    return m_tail.load(std::memory_order_acquire)
+        == m_head.load(std::memory_order_acquire);
+  }
+
+  size_t size() const {
+    return m_head.load(std::memory_order_acquire)
+        - m_tail.load(std::memory_order_acquire);
+  }
+
+  SpscQueue(const SpscQueue&) = delete;            // disable copying
+  SpscQueue& operator=(const SpscQueue&) = delete;  // disable assignment
+};
+
+}
+
+#endif
@@ -1,6 +1,7 @@
 #include <thread>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 
 #include <boost/asio.hpp>
 #include <boost/program_options.hpp>
@@ -14,6 +15,7 @@
 #include "log/log.hpp"
 #include "common/configuration.h"
 #include "common/dataformat.h"
+#include "common/huge_pages.h"
 #include "common/local_ip.h"
 
 #ifdef HAVE_HYDRA
@@ -117,8 +119,14 @@ int main(int argc, char* argv[]) {
   iface = "ib0";
   LOG_DEBUG << "Using iface = " << iface << ", port = " << port << ", range = " << range;
 
-  //get ip
-  std::string ip = get_local_ip(iface);
+  //get ip, one per rail: IFACE can list several interfaces separated by
+  //commas
+  std::string rail_ips;
+  std::istringstream iface_is(iface);
+  for (std::string rail_iface; std::getline(iface_is, rail_iface, ',');) {
+    rail_ips += (rail_ips.empty() ? "" : ",") + get_local_ip(rail_iface);
+  }
+  std::string ip = rail_ips.substr(0, rail_ips.find(','));
 
   //exchange
   HydraLauncher launcher;
@@ -126,6 +134,7 @@ int main(int argc, char* argv[]) {
   char portStr[8];
   sprintf(portStr,"%d",port+launcher.getRank()%range);
   launcher.set("ip",ip);
+  launcher.set("rails",rail_ips);
   launcher.set("port",portStr);
   launcher.commit();
   launcher.barrier();
@@ -178,25 +187,262 @@ int main(int argc, char* argv[]) {
     return EXIT_FAILURE;
   }
 
+  bool const shared_memory = configuration.get<bool>(
+      "GENERAL.SHARED_MEMORY",
+      false);
+
+  // Unsignaled sends keep their multievent until a later send to the same
+  // peer completes, and the memory of the Readout Unit is released in order:
+  // the multievents held in this way must leave room for the following ones
+  int const signal_interval = configuration.get<int>(
+      "GENERAL.SIGNAL_INTERVAL",
+      1);
+  if (signal_interval < 1 || signal_interval > credits
+      || (signal_interval - 1) * static_cast<int>(endpoints.size()) > credits) {
+    LOG_ERROR << "Wrong SIGNAL_INTERVAL: " << signal_interval;
+    return EXIT_FAILURE;
+  }
+
+  // Receive buffers shared by all the remote Readout Units (0 to disable):
+  // each of them must be able to deliver at least one multievent. The TCP
+  // sockets take at most their share of them, while the shared receive
+  // queues of the network cards give them to the first sources that send,
+  // which may take all of them while the events wait for the others: the
+  // pool must then hold all the credits of the sources.
+  int const shared_receive_buffers = configuration.get<int>(
+      "GENERAL.SHARED_RECEIVE_BUFFERS",
+      0);
+#if defined(TCP)
+  int const min_shared_receive_buffers = endpoints.size();
+#else
+  int const min_shared_receive_buffers = (endpoints.size() - 1) * credits;
+#endif
+  if (shared_receive_buffers < 0
+      || (shared_receive_buffers
+          && shared_receive_buffers < min_shared_receive_buffers)) {
+    LOG_ERROR << "Wrong SHARED_RECEIVE_BUFFERS: " << shared_receive_buffers;
+    return EXIT_FAILURE;
+  }
+
+  // All the connections of a unit are peers of a single reliable unconnected
+  // endpoint, whose completions are read from a single queue
+  bool const rdm_endpoints = configuration.get<bool>(
+      "GENERAL.RDM_ENDPOINTS",
+      false);
+#if defined(FI_VERBS) || defined(FI_TCP)
+  bool const rdm_endpoints_supported = true;
+#else
+  bool const rdm_endpoints_supported = false;
+#endif
+  if (rdm_endpoints && (shared_receive_buffers || !rdm_endpoints_supported)) {
+    LOG_ERROR << "Wrong RDM_ENDPOINTS: " << rdm_endpoints;
+    return EXIT_FAILURE;
+  }
+
+  // Completions of all the network connections are read from a single queue
+  bool const shared_completion_queue = rdm_endpoints
+      || configuration.get<bool>("GENERAL.SHARED_COMPLETION_QUEUE", false);
+
+  // The Readout Units write the multievents into a ring of each Builder Unit,
+  // which receives them without posting buffers
+  bool const rdma_write = configuration.get<bool>(
+      "GENERAL.RDMA_WRITE",
+      false);
+#if defined(TCP)
+  bool const rdma_write_supported = false;
+#elif defined(FI_VERBS) || defined(FI_TCP)
+  bool const rdma_write_supported = !shared_completion_queue;
+#else
+  bool const rdma_write_supported = true;
+#endif
+  if (rdma_write && (shared_receive_buffers || !rdma_write_supported)) {
+    LOG_ERROR << "Wrong RDMA_WRITE: " << rdma_write;
+    return EXIT_FAILURE;
+  }
+
+  // Idle time, in microseconds, spent polling before blocking until some
+  // completions are available (0 to always poll)
+  int const spin_time = configuration.get<int>("GENERAL.SPIN_TIME", 0);
+  if (spin_time < 0) {
+    LOG_ERROR << "Wrong SPIN_TIME: " << spin_time;
+    return EXIT_FAILURE;
+  }
+
+  // Network interfaces of each node: the multievents addressed to a remote
+  // Builder Unit are striped across them
+  int const rails = endpoints[id].rails().size();
+  for (auto const& ep : endpoints) {
+    if (static_cast<int>(ep.rails().size()) != rails) {
+      LOG_ERROR
+        << "Wrong RAILS of "
+        << ep
+        << ": all the endpoints must have "
+        << rails;
+      return EXIT_FAILURE;
+    }
+  }
+  // The shared queues belong to a single device
+  if (rails > 1 && (shared_receive_buffers || shared_completion_queue)) {
+    LOG_ERROR
+      << "Wrong RAILS: "
+      << rails
+      << " can't be used with shared receive buffers or completion queue";
+    return EXIT_FAILURE;
+  }
+
+  // Size of the datagrams carrying the multievents to the remote Builder
+  // Units (0 for reliable connections). The multievents are fragmented and
+  // the lost ones are counted instead of being sent again.
+  int const datagram_size = configuration.get<int>(
+      "GENERAL.DATAGRAM_SIZE",
+      0);
+  if (datagram_size < 0
+      || (datagram_size
+          && (datagram_size <= static_cast<int>(sizeof(dgram::Header))
+              || shared_receive_buffers || shared_completion_queue
+              || rdma_write || rails > 1))) {
+    LOG_ERROR << "Wrong DATAGRAM_SIZE: " << datagram_size;
+    return EXIT_FAILURE;
+  }
+
+  // Threads of the Readout Unit sending to the Builder Units, each of them
+  // owning a disjoint subset of the connections. The shared completion queue
+  // and the datagram endpoint belong to all the connections.
+  int const sender_threads = configuration.get<int>(
+      "GENERAL.SENDER_THREADS",
+      1);
+  if (sender_threads < 1
+      || (sender_threads > 1 && (shared_completion_queue || datagram_size))) {
+    LOG_ERROR << "Wrong SENDER_THREADS: " << sender_threads;
+    return EXIT_FAILURE;
+  }
+
+  // Length, in microseconds, of the time slots of the barrel shifter (0 to
+  // disable): in each slot every Readout Unit sends to a different Builder
+  // Unit, so that the nodes must have their clocks synchronized
+  int const slot_time = configuration.get<int>("GENERAL.SLOT_TIME", 0);
+  if (slot_time < 0 || (slot_time && sender_threads > 1)) {
+    LOG_ERROR << "Wrong SLOT_TIME: " << slot_time;
+    return EXIT_FAILURE;
+  }
+
+  // Multievents acquired ahead of their send by each sending thread, queued
+  // by Builder Unit so that one without credits does not hold back the others
+  int const lookahead = configuration.get<int>(
+      "GENERAL.SEND_LOOKAHEAD",
+      endpoints.size());
+  if (lookahead < 1) {
+    LOG_ERROR << "Wrong SEND_LOOKAHEAD: " << lookahead;
+    return EXIT_FAILURE;
+  }
+
+  // Multievents of each epoch of the assignment to the Builder Units, dealt
+  // from the free buffers that they advertise (0 to deal them in turn). The
+  // Builder Units answer on the port of their endpoint plus the offset.
+  int const assignment_epoch = configuration.get<int>(
+      "GENERAL.ASSIGNMENT_EPOCH",
+      0);
+  if (assignment_epoch < 0
+      || (assignment_epoch
+          && (assignment_epoch < static_cast<int>(endpoints.size())
+              || slot_time))) {
+    LOG_ERROR << "Wrong ASSIGNMENT_EPOCH: " << assignment_epoch;
+    return EXIT_FAILURE;
+  }
+  int const feedback_port_offset = configuration.get<int>(
+      "GENERAL.FEEDBACK_PORT_OFFSET",
+      1000);
+  if (feedback_port_offset <= 0) {
+    LOG_ERROR << "Wrong FEEDBACK_PORT_OFFSET: " << feedback_port_offset;
+    return EXIT_FAILURE;
+  }
+
+  // Size of the pages of the data buffers, in MiB (0 for the default pages,
+  // 2 or 1024 for huge pages), and NUMA node of their memory (-1 for the
+  // node of the network interface of the endpoint, if known)
+  int const huge_page_size = configuration.get<int>(
+      "GENERAL.HUGE_PAGE_SIZE",
+      0);
+  if (huge_page_size != 0 && huge_page_size != 2 && huge_page_size != 1024) {
+    LOG_ERROR << "Wrong HUGE_PAGE_SIZE: " << huge_page_size;
+    return EXIT_FAILURE;
+  }
+  int numa_node = configuration.get<int>("GENERAL.NUMA_NODE", -1);
+  if (numa_node < -1 || numa_node >= 64) {
+    LOG_ERROR << "Wrong NUMA_NODE: " << numa_node;
+    return EXIT_FAILURE;
+  }
+  if (numa_node == -1) {
+    numa_node = huge_pages::interface_numa_node(endpoints[id].hostname());
+  }
+  MemoryPlacement const placement(
+      static_cast<size_t>(huge_page_size) << 20,
+      numa_node);
+
   /************** Memory allocation ******************/
 
   int const meta_size = sizeof(EventMetaData) * bulk_size * (credits * 2 + 1);
   int const data_size = max_fragment_size * bulk_size * (credits * 2 + 1);
 
-  std::unique_ptr<unsigned char[]> const metadata_ptr(
-      new unsigned char[meta_size]);
-  std::unique_ptr<unsigned char[]> const data_ptr(new unsigned char[data_size]);
+  HugeBuffer const metadata_buffer(meta_size, placement);
+  HugeBuffer const data_buffer(data_size, placement);
+  if (huge_page_size && !(metadata_buffer.huge() && data_buffer.huge())) {
+    LOG_WARNING
+      << "Huge pages of "
+      << huge_page_size
+      << " MiB not available, using transparent huge pages";
+  }
+  LOG_INFO
+    << "Memory - Pages of "
+    << (huge_page_size ?
+        std::to_string(huge_page_size) + " MiB" : std::string("default size"))
+    << (numa_node >= 0 ? " on NUMA node " + std::to_string(numa_node) : "");
 
   MetaDataRange metadata_range(
-      pointer_cast<EventMetaData>(metadata_ptr.get()),
-      pointer_cast<EventMetaData>(metadata_ptr.get() + meta_size));
-  DataRange data_range(data_ptr.get(), data_ptr.get() + data_size);
+      pointer_cast<EventMetaData>(metadata_buffer.begin()),
+      pointer_cast<EventMetaData>(metadata_buffer.begin() + meta_size));
+  DataRange data_range(data_buffer.begin(), data_buffer.begin() + data_size);
 
   /********* Generator, Controller and Accumulator **********/
 
   int const generator_frequency = configuration.get<int>("GENERATOR.FREQUENCY");
   assert(generator_frequency > 0);
 
+  // Arrival of the events (CONSTANT, POISSON or BUNCHES), depth of the token
+  // bucket that holds the ones arrived while the generator is full (0 for
+  // no limit), and waiting for the next arrival without sleeping
+  ArrivalModel arrival_model;
+  std::string const arrival = configuration.get<std::string>(
+      "GENERATOR.ARRIVAL",
+      "CONSTANT");
+  if (!arrival_model_from_string(arrival, arrival_model)) {
+    LOG_ERROR << "Wrong ARRIVAL: " << arrival;
+    return EXIT_FAILURE;
+  }
+  int const burst = configuration.get<int>("GENERATOR.BURST", 0);
+  if (burst < 0) {
+    LOG_ERROR << "Wrong BURST: " << burst;
+    return EXIT_FAILURE;
+  }
+  bool const busy_wait = configuration.get<bool>("GENERATOR.BUSY_WAIT", false);
+
+  // Time, in microseconds, after which a multievent is sent with the events
+  // arrived since its first one (0 to always wait for BULKED_EVENTS). The
+  // Readout Units flush the same events only if none of them is dropped.
+  int const flush_time = configuration.get<int>("GENERAL.FLUSH_TIME", 0);
+  if (flush_time < 0 || (flush_time && burst)) {
+    LOG_ERROR << "Wrong FLUSH_TIME: " << flush_time;
+    return EXIT_FAILURE;
+  }
+
+  Pacer const pacer(
+      arrival_model,
+      generator_frequency,
+      burst,
+      busy_wait,
+      std::chrono::microseconds(flush_time),
+      bulk_size);
+
   int const mean = configuration.get<int>("GENERATOR.MEAN");
   assert(mean > 0);
 
@@ -208,14 +454,48 @@ int main(int argc, char* argv[]) {
       stddev,
       max_fragment_size - sizeof(EventHeader));
   Generator generator(payload_size_generator, metadata_range, data_range, id);
-  Controller controller(generator, metadata_range, generator_frequency);
+  Controller controller(generator, metadata_range, pacer);
   Accumulator accumulator(controller, metadata_range, data_range, bulk_size);
 
   /**************** Builder Unit and Readout Unit *****************/
 
-  BuilderUnit bu(endpoints.size(), bulk_size, credits, max_fragment_size, id);
-
-  ReadoutUnit ru(accumulator, credits, id);
+  BuilderUnit::Options bu_options;
+  bu_options.nodes = endpoints.size();
+  bu_options.bulk_size = bulk_size;
+  bu_options.credits = credits;
+  bu_options.max_fragment_size = max_fragment_size;
+  bu_options.id = id;
+  bu_options.shared_memory = shared_memory;
+  bu_options.shared_receive_buffers = shared_receive_buffers;
+  bu_options.shared_completion_queue = shared_completion_queue;
+  bu_options.rdm_endpoints = rdm_endpoints;
+  bu_options.rdma_write = rdma_write;
+  bu_options.spin_time = spin_time;
+  bu_options.rails = rails;
+  bu_options.datagram_size = datagram_size;
+  bu_options.placement = placement;
+  bu_options.serve_feedback = assignment_epoch > 0;
+  bu_options.feedback_port_offset = feedback_port_offset;
+  bu_options.short_multievents = flush_time > 0;
+  BuilderUnit bu(bu_options);
+
+  ReadoutUnit::Options ru_options;
+  ru_options.credits = credits;
+  ru_options.id = id;
+  ru_options.shared_memory = shared_memory;
+  ru_options.signal_interval = signal_interval;
+  ru_options.shared_completion_queue = shared_completion_queue;
+  ru_options.rdm_endpoints = rdm_endpoints;
+  ru_options.rdma_write = rdma_write;
+  ru_options.spin_time = spin_time;
+  ru_options.rails = rails;
+  ru_options.datagram_size = datagram_size;
+  ru_options.sender_threads = sender_threads;
+  ru_options.slot_time = slot_time;
+  ru_options.assignment_epoch = assignment_epoch;
+  ru_options.feedback_port_offset = feedback_port_offset;
+  ru_options.lookahead = lookahead;
+  ReadoutUnit ru(accumulator, ru_options);
 
   std::thread bu_conn_th(&BuilderUnit::connect, &bu, endpoints);
   std::thread ru_conn_th(&ReadoutUnit::connect, &ru, endpoints);
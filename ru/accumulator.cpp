@@ -1,6 +1,6 @@
 #include "ru/accumulator.h"
 
-#include <algorithm>
+#include <cassert>
 
 #include "log/log.hpp"
 #include "common/utility.h"
@@ -19,60 +19,85 @@ Accumulator::Accumulator(
       m_current_metadata(std::begin(m_metadata_range)),
       m_events_in_multievent(events_in_multievent),
       m_generated_events(0),
-      m_release_metadata(std::begin(m_metadata_range)) {
+      m_acquired_events(0),
+      m_release_metadata(std::begin(m_metadata_range)),
+      m_next_sequence(0),
+      m_release_sequence(0) {
+  // A flushed multievent may have a single event
+  size_t const multievents = std::distance(
+    std::begin(m_metadata_range),
+    std::end(m_metadata_range)) + 1;
+  m_completed.resize((multievents + 63) / 64, 0);
+  m_multievent_events.resize(m_completed.size() * 64, 0);
 }
 
-bool Accumulator::checkDataWrap(MetaDataRange multievent_metadata){
-  uint64_t first_offset = std::begin(multievent_metadata)->offset;
-  auto it =
-    find_in_range(
-      multievent_metadata,
-      m_metadata_range,
-      [first_offset](EventMetaData const& m) {return (m.offset < first_offset) ? true : false;});
-  return it != std::end(multievent_metadata);
-}
-
-std::pair<iovec, bool> Accumulator::get_multievent() {
+std::pair<MultiEventIov, bool> Accumulator::get_multievent() {
 
-  // If not enough data ready, read data from the Controller
-  if (m_generated_events < m_events_in_multievent) {
+  // If not enough data ready, read data from the Controller, which may also
+  // flush the multievent
+  int events = m_controller.multievent_end(m_acquired_events)
+    - m_acquired_events;
+  if (m_generated_events < events) {
     MetaDataRange meta = m_controller.read();
     m_generated_events += distance_in_range(meta, m_metadata_range);
+    events = m_controller.multievent_end(m_acquired_events)
+      - m_acquired_events;
   }
 
-  std::pair<iovec, bool> p;
+  std::pair<MultiEventIov, bool> p;
 
-  if (m_generated_events >= m_events_in_multievent) {
+  if (m_generated_events >= events) {
 
   // Create bulked metadata and data ranges
   MetaDataRange multievent_metadata(
     m_current_metadata,
     advance_in_range(
       m_current_metadata,
-      m_events_in_multievent,
+      events,
       m_metadata_range));
 
-  // Check for wrap
-  bool wrap = checkDataWrap(multievent_metadata);
-  assert(wrap == 0 && "Wrap found!");
-
-  // Find data begin
-  auto data_begin = std::begin(m_data_range) + multievent_metadata.begin()
-    ->offset;
-
-  // Find data end
+  // Find the events that wrap around the end of the data ring, which are
+  // placed again from its beginning. They are only looked for if the last
+  // event comes before the first one.
+  uint64_t const first_offset = std::begin(multievent_metadata)->offset;
   auto last_metadata = advance_in_range(
     std::end(multievent_metadata),
     -1,
     m_metadata_range);
+  auto wrap_metadata = std::end(multievent_metadata);
+  if (last_metadata->offset < first_offset) {
+    wrap_metadata =
+      find_in_range(
+        multievent_metadata,
+        m_metadata_range,
+        [first_offset](EventMetaData const& m) {
+          return m.offset < first_offset;});
+  }
+
+  MultiEventIov& data = p.first;
+  auto data_begin = std::begin(m_data_range) + first_offset;
   auto data_end =
     std::begin(m_data_range) + last_metadata->offset + last_metadata->length;
-
-  p.first = { data_begin, (size_t) std::distance(data_begin, data_end) };
-  m_iov_multievents.emplace_back(p.first.iov_base, false);
+  if (wrap_metadata == std::end(multievent_metadata)) {
+    data.iov[0] = { data_begin, (size_t) std::distance(data_begin, data_end) };
+    data.count = 1;
+  } else {
+    // The tail of the ring after the last event before the wrap is not sent
+    auto before_wrap = advance_in_range(wrap_metadata, -1, m_metadata_range);
+    auto tail_end =
+      std::begin(m_data_range) + before_wrap->offset + before_wrap->length;
+    auto head_begin = std::begin(m_data_range) + wrap_metadata->offset;
+    data.iov[0] = { data_begin, (size_t) std::distance(data_begin, tail_end) };
+    data.iov[1] = { head_begin, (size_t) std::distance(head_begin, data_end) };
+    data.count = 2;
+  }
+  data.sequence = m_next_sequence++;
+  assert(m_next_sequence - m_release_sequence <= m_completed.size() * 64);
+  m_multievent_events[data.sequence % m_multievent_events.size()] = events;
   p.second = true;
 
-  m_generated_events -= m_events_in_multievent;
+  m_generated_events -= events;
+  m_acquired_events += events;
   m_current_metadata = std::end(multievent_metadata);
 
   LOG_TRACE << "Accumulator - Acquired 1 multievent";
@@ -85,40 +110,56 @@ std::pair<iovec, bool> Accumulator::get_multievent() {
 }
 
 int Accumulator::releaseContiguousMemory() {
-  auto it = std::find_if(
-    std::begin(m_iov_multievents),
-    std::end(m_iov_multievents),
-    [](std::pair<void*, bool> const& p) {return p.second == false;});
-  int multievents_to_release = std::distance(std::begin(m_iov_multievents), it);
-  assert(multievents_to_release >= 0);
+  // Count the set bits from the one of the first multievent not released, a
+  // word at a time, clearing them. The bits past the last multievent
+  // acquired are never set.
+  uint64_t const bits = m_completed.size() * 64;
+  int multievents_to_release = 0;
+  while (true) {
+    uint64_t const bit =
+      (m_release_sequence + multievents_to_release) % bits;
+    uint64_t& word = m_completed[bit / 64];
+    int const shift = bit % 64;
+    uint64_t const ones_from_bit = ~(word >> shift);
+    int const ones = ones_from_bit ? __builtin_ctzll(ones_from_bit) : 64;
+    if (!ones) {
+      break;
+    }
+    word &= ~((ones == 64 ? ~uint64_t(0) : (uint64_t(1) << ones) - 1) << shift);
+    multievents_to_release += ones;
+    if (shift + ones < 64) {
+      break;
+    }
+  }
+
   if (multievents_to_release) {
+    int events_to_release = 0;
+    for (int i = 0; i < multievents_to_release; ++i) {
+      events_to_release += m_multievent_events[(m_release_sequence + i) % bits];
+    }
     MetaDataRange metadata_to_release(
       m_release_metadata,
       advance_in_range(
         m_release_metadata,
-        m_events_in_multievent * multievents_to_release,
+        events_to_release,
         m_metadata_range));
     m_release_metadata = std::end(metadata_to_release);
     m_controller.release(metadata_to_release);
-    m_iov_multievents.erase(
-      std::begin(m_iov_multievents),
-      std::begin(m_iov_multievents) + multievents_to_release);
+    m_release_sequence += multievents_to_release;
     LOG_DEBUG << "Accumulator - Released " << multievents_to_release
                << " contiguous multievents";
   }
   return multievents_to_release;
 }
 
-void Accumulator::release_multievents(std::vector<void*> const& vect) {
-  for (auto& addr : vect) {
-    auto it =
-      std::find_if(
-        std::begin(m_iov_multievents),
-        std::end(m_iov_multievents),
-        [&addr] (std::pair<void*, bool> const& p) {return p.first == addr;});
-    assert(it != std::end(m_iov_multievents));
-    assert(it->second == false);
-    it->second = true;
+void Accumulator::release_multievents(std::vector<uint64_t> const& sequences) {
+  uint64_t const bits = m_completed.size() * 64;
+  for (auto sequence : sequences) {
+    assert(sequence >= m_release_sequence && sequence < m_next_sequence);
+    uint64_t const bit = sequence % bits;
+    uint64_t const mask = uint64_t(1) << (bit % 64);
+    assert(!(m_completed[bit / 64] & mask));
+    m_completed[bit / 64] |= mask;
   }
   releaseContiguousMemory();
 }
@@ -1,8 +1,12 @@
 #ifndef RU_ACCUMULATOR_H
 #define RU_ACCUMULATOR_H
 
-#include <deque>
 #include <utility>
+#include <vector>
+
+#include <cstdint>
+
+#include <sys/uio.h>
 
 #include "common/dataformat.h"
 
@@ -10,6 +14,14 @@
 
 namespace lseb {
 
+// Data of a multievent: a single segment of the data ring, or two if the
+// multievent wraps around its end. The sequence identifies it when released.
+struct MultiEventIov {
+  iovec iov[2];
+  int count;
+  uint64_t sequence;
+};
+
 class Accumulator {
   Controller m_controller;
   MetaDataRange m_metadata_range;
@@ -17,10 +29,19 @@ class Accumulator {
   MetaDataRange::iterator m_current_metadata;
   int m_events_in_multievent;
   int m_generated_events;
-  std::deque<std::pair<void*, bool> > m_iov_multievents;
+  uint64_t m_acquired_events;
   MetaDataRange::iterator m_release_metadata;
 
-  bool checkDataWrap(MetaDataRange multievent_metadata);
+  // Multievents acquired and not yet released, by sequence. The bit of a
+  // multievent in m_completed, a ring of bits indexed by sequence, is set
+  // once it has been sent: the ones at the front are released together.
+  // The multievents flushed by the controller have fewer events, which are
+  // counted in m_multievent_events, indexed in the same way.
+  uint64_t m_next_sequence;
+  uint64_t m_release_sequence;
+  std::vector<uint64_t> m_completed;
+  std::vector<int> m_multievent_events;
+
   int releaseContiguousMemory();
 
  public:
@@ -29,8 +50,9 @@ class Accumulator {
     MetaDataRange const& metadata_range,
     DataRange const& data_range,
     int events_in_multievent);
-  std::pair<iovec, bool> get_multievent();
-  void release_multievents(std::vector<void*> const& vect);
+  std::pair<MultiEventIov, bool> get_multievent();
+  // The multievents can be released in any order
+  void release_multievents(std::vector<uint64_t> const& sequences);
   DataRange data_range() {
     return m_data_range;
   }
@@ -0,0 +1,78 @@
+#include "ru/assignment.h"
+
+#include <algorithm>
+
+#include <cassert>
+
+namespace lseb {
+
+Assignment::Assignment(int nodes, uint64_t epoch_size)
+    : m_client(nodes),
+      m_nodes(nodes),
+      m_epoch_size(epoch_size),
+      m_lag(std::max(uint64_t(LAG), (LEAD + epoch_size - 1) / epoch_size)),
+      m_requested(m_lag),
+      m_last_shares(nodes, 0) {
+  assert(m_epoch_size >= static_cast<uint64_t>(m_nodes));
+}
+
+void Assignment::connect(
+    int id,
+    std::string const& hostname,
+    std::string const& port) {
+  m_client.connect(id, hostname, port);
+}
+
+// The weight of a Builder Unit is one more than its free buffers, so that
+// a full one keeps receiving a few multievents. They are interleaved by a
+// smooth weighted round robin, which only depends on the weights.
+void Assignment::build_table(uint64_t epoch) {
+  std::vector<int64_t> weights(m_nodes);
+  int64_t total = 0;
+  for (int id = 0; id < m_nodes; ++id) {
+    weights[id] = 1 + m_status[id].free_buffers;
+    total += weights[id];
+  }
+
+  std::vector<int>& table = m_tables[epoch];
+  table.resize(m_epoch_size);
+  std::fill(std::begin(m_last_shares), std::end(m_last_shares), 0);
+  std::vector<int64_t> current(m_nodes, 0);
+  for (auto& destination : table) {
+    int best = 0;
+    for (int id = 0; id < m_nodes; ++id) {
+      current[id] += weights[id];
+      if (current[id] > current[best]) {
+        best = id;
+      }
+    }
+    current[best] -= total;
+    destination = best;
+    ++m_last_shares[best];
+  }
+}
+
+int Assignment::destination(uint64_t sequence) {
+  uint64_t const epoch = sequence / m_epoch_size;
+
+  // Entering an epoch, ask for the status of the one m_lag later
+  for (; m_requested <= epoch + m_lag; ++m_requested) {
+    m_client.request(m_requested);
+  }
+
+  if (epoch < m_lag) {
+    return sequence % m_nodes;
+  }
+  auto table = m_tables.find(epoch);
+  if (table == std::end(m_tables)) {
+    if (!m_client.answers(epoch, m_status)) {
+      return -1;
+    }
+    build_table(epoch);
+    m_tables.erase(std::begin(m_tables), m_tables.find(epoch));
+    table = m_tables.find(epoch);
+  }
+  return table->second[sequence % m_epoch_size];
+}
+
+}
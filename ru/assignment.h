@@ -0,0 +1,56 @@
+#ifndef RU_ASSIGNMENT_H
+#define RU_ASSIGNMENT_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <cstdint>
+
+#include "transport/feedback.h"
+
+namespace lseb {
+
+// Builder Unit of each multievent, by sequence, the same on all the Readout
+// Units. The multievents are grouped in epochs, and the ones of an epoch are
+// dealt to the Builder Units in proportion to the receive buffers that they
+// had free when the first Readout Unit entered the epoch m_lag before, so
+// that the fastest ones build the most. The status is asked for at least
+// LEAD multievents ahead, so that the answers are there when the epoch
+// starts. The first epochs are dealt in turn.
+
+class Assignment {
+  static uint64_t const LAG = 2;  // epochs, at least
+  static uint64_t const LEAD = 64;  // multievents, at least
+
+  feedback::Client m_client;
+  int m_nodes;
+  uint64_t m_epoch_size;  // multievents
+  uint64_t m_lag;  // epochs
+  uint64_t m_requested;  // first epoch not yet requested
+  std::map<uint64_t, std::vector<int> > m_tables;  // by epoch
+  std::vector<feedback::Status> m_status;  // reused
+  std::vector<int> m_last_shares;  // multievents by Builder Unit
+
+  void build_table(uint64_t epoch);
+
+ public:
+  Assignment(int nodes, uint64_t epoch_size);
+  Assignment(Assignment const& other) = delete;  // non construction-copyable
+  Assignment& operator=(Assignment const&) = delete;  // non copyable
+
+  void connect(int id, std::string const& hostname, std::string const& port);
+
+  // Return the Builder Unit of the multievent, or -1 if the status of its
+  // epoch has not been received yet
+  int destination(uint64_t sequence);
+
+  // Multievents dealt to each Builder Unit in the last epoch built
+  std::vector<int> const& last_shares() const {
+    return m_last_shares;
+  }
+};
+
+}
+
+#endif
@@ -1,44 +1,68 @@
 #include "ru/controller.h"
 
 #include <chrono>
-#include<thread>
+#include <iterator>
+#include <ratio>
+#include <thread>
 
 #include "common/utility.h"
+#include "log/log.hpp"
 
 namespace lseb {
 
+// Seconds between two reports of the achieved rate
+static double const REPORT_INTERVAL = 5.0;
+
 Controller::Controller(
   Generator const& generator,
   MetaDataRange const& metadata_range,
-  size_t generator_frequency)
+  Pacer const& pacer)
     :
       m_generator(generator),
       m_metadata_range(metadata_range),
       m_current_metadata(std::begin(m_metadata_range)),
-      m_start_time(std::chrono::high_resolution_clock::now()),
-      m_generator_frequency(generator_frequency),
-      m_generated_events(0) {
+      m_pacer(pacer),
+      m_report_time(std::chrono::steady_clock::now()),
+      m_report_events(0) {
 }
 
 MetaDataRange Controller::read() {
 
-  double const elapsed_seconds = std::chrono::duration<double>(
-    std::chrono::high_resolution_clock::now() - m_start_time).count();
-
-  std::this_thread::sleep_for(
-    std::chrono::microseconds(std::mega::num / m_generator_frequency));
-
-  size_t const events_to_generate = elapsed_seconds * m_generator_frequency;
-  assert(events_to_generate >= m_generated_events);
-
-  size_t const current_generated_events = m_generator.generateEvents(
-    events_to_generate - m_generated_events);
+  // The events arrived and not yet generated wait in the bucket of the
+  // pacer until the generator has room for them, which is never more than
+  // the events of its ring
+  uint64_t const tokens = m_pacer.fill(
+    std::distance(std::begin(m_metadata_range), std::end(m_metadata_range)));
+  size_t const current_generated_events = m_generator.generateEvents(tokens);
+  m_pacer.take(current_generated_events);
+  // With the generator full, only the completions polled by the caller free
+  // it: leave the processor to the other threads rather than sleeping
+  if (current_generated_events < tokens) {
+    std::this_thread::yield();
+  }
   auto previous_metadata = m_current_metadata;
   m_current_metadata = advance_in_range(
     m_current_metadata,
     current_generated_events,
     m_metadata_range);
-  m_generated_events += current_generated_events;
+  m_report_events += current_generated_events;
+
+  auto const now = std::chrono::steady_clock::now();
+  double const elapsed_seconds = std::chrono::duration<double>(
+    now - m_report_time).count();
+  if (elapsed_seconds >= REPORT_INTERVAL) {
+    LOG_INFO
+      << "Generator: "
+      << m_report_events / elapsed_seconds / std::mega::num
+      << " MHz of "
+      << m_pacer.frequency() / std::mega::num
+      << " MHz requested, "
+      << m_pacer.dropped()
+      << " events dropped";
+    m_report_time = now;
+    m_report_events = 0;
+  }
+
   return MetaDataRange(previous_metadata, m_current_metadata);
 }
 
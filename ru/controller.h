@@ -5,6 +5,7 @@
 
 #include "common/dataformat.h"
 #include "generator/generator.h"
+#include "ru/pacer.h"
 
 namespace lseb {
 
@@ -13,16 +14,23 @@ class Controller {
   Generator m_generator;
   MetaDataRange m_metadata_range;
   MetaDataRange::iterator m_current_metadata;
-  std::chrono::high_resolution_clock::time_point m_start_time;
-  size_t m_generator_frequency;
-  size_t m_generated_events;
+  Pacer m_pacer;
+
+  // Events generated since the last report of the achieved rate
+  std::chrono::steady_clock::time_point m_report_time;
+  size_t m_report_events;
 
  public:
   Controller(
     Generator const& generator,
     MetaDataRange const& metadata_range,
-    size_t generator_frequency);
+    Pacer const& pacer);
   MetaDataRange read();
+  // Event after the last one of the multievent that starts with the event
+  // first, counting from the first event generated
+  uint64_t multievent_end(uint64_t first) {
+    return m_pacer.window_end(first);
+  }
   void release(MetaDataRange metadata_range);
 
 };
@@ -0,0 +1,214 @@
+#include "ru/pacer.h"
+
+#include <algorithm>
+#include <ratio>
+#include <thread>
+
+#include <cassert>
+
+namespace lseb {
+
+namespace {
+
+// LHC orbit: 3564 bunch crossings 25 ns apart. The bunches are filled in
+// trains of 72, separated by 8 empty crossings, and the orbit ends with the
+// abort gap.
+uint64_t const CROSSING_NS = 25;
+uint64_t const ORBIT_CROSSINGS = 3564;
+uint64_t const TRAIN_BUNCHES = 72;
+uint64_t const TRAIN_GAP = 8;
+uint64_t const ABORT_GAP = 119;
+
+uint64_t const SEED = 5489u;
+
+// Shortest wait that is slept: a sleep lasts about this much longer than
+// asked, so that the shorter waits, and the end of the longer ones, spin
+std::chrono::microseconds const MIN_SLEEP(50);
+
+}
+
+bool arrival_model_from_string(std::string const& str, ArrivalModel& model) {
+  if (str == "CONSTANT") {
+    model = ArrivalModel::CONSTANT;
+  } else if (str == "POISSON") {
+    model = ArrivalModel::POISSON;
+  } else if (str == "BUNCHES") {
+    model = ArrivalModel::BUNCHES;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+Pacer::Pacer(
+    ArrivalModel model,
+    double frequency,
+    uint64_t depth,
+    bool busy_wait,
+    std::chrono::microseconds flush_time,
+    uint64_t window)
+    : m_model(model),
+      m_frequency(frequency),
+      m_depth(depth),
+      m_busy_wait(busy_wait),
+      m_flush_ns(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(flush_time)
+              .count()),
+      m_window(window),
+      m_start(clock::now()),
+      m_arrivals(0),
+      m_next_ns(0.),
+      m_tokens(0),
+      m_dropped(0),
+      m_engine(SEED),
+      m_poisson_gap(frequency),
+      m_next_filled(0),
+      m_window_first(0),
+      m_window_first_ns(0.) {
+  assert(m_frequency > 0. && m_window > 0);
+  for (uint64_t i = 0; i < ORBIT_CROSSINGS - ABORT_GAP; ++i) {
+    if (i % (TRAIN_BUNCHES + TRAIN_GAP) < TRAIN_BUNCHES) {
+      m_filled.push_back(i);
+    }
+  }
+  // Each filled crossing has an event with the probability that gives the
+  // mean frequency, up to all of them
+  double const orbit_seconds = ORBIT_CROSSINGS * CROSSING_NS * 1e-9;
+  m_bunches_gap = std::geometric_distribution<uint64_t>(
+      std::min(1., m_frequency * orbit_seconds / m_filled.size()));
+  schedule();
+}
+
+void Pacer::schedule() {
+  switch (m_model) {
+    case ArrivalModel::CONSTANT:
+      m_next_ns = (m_arrivals + 1) * 1e9 / m_frequency;
+      break;
+    case ArrivalModel::POISSON:
+      m_next_ns += m_poisson_gap(m_engine) * 1e9;
+      break;
+    case ArrivalModel::BUNCHES: {
+      uint64_t const filled = m_next_filled + m_bunches_gap(m_engine);
+      m_next_filled = filled + 1;
+      uint64_t const crossing = filled / m_filled.size() * ORBIT_CROSSINGS
+          + m_filled[filled % m_filled.size()];
+      m_next_ns = crossing * CROSSING_NS;
+      break;
+    }
+  }
+}
+
+// The window closes before the arrival if it already has the events of a
+// multievent, or if the arrival comes after the flush time
+void Pacer::close_window(uint64_t arrival, double arrival_ns) {
+  if (arrival > m_window_first) {
+    if (arrival - m_window_first == m_window) {
+      m_window_first = arrival;
+    } else if (arrival_ns > m_window_first_ns + m_flush_ns) {
+      m_flushed.push_back(arrival);
+      m_window_first = arrival;
+    }
+  }
+  if (arrival == m_window_first) {
+    m_window_first_ns = arrival_ns;
+  }
+}
+
+void Pacer::add_arrivals(uint64_t room) {
+  add_arrivals(
+      std::chrono::duration<double, std::nano>(clock::now() - m_start)
+          .count(),
+      room);
+}
+
+void Pacer::add_arrivals(double now_ns, uint64_t room) {
+  uint64_t arrivals = 0;
+  if (m_model == ArrivalModel::CONSTANT && !m_flush_ns) {
+    // Without windows to close, the evenly spaced arrivals are counted at
+    // once
+    uint64_t const arrived = now_ns * 1e-9 * m_frequency;
+    if (arrived > m_arrivals) {
+      arrivals = arrived - m_arrivals;
+      m_arrivals = arrived;
+    }
+  } else {
+    // The dropped ones are counted whatever the room
+    for (; m_next_ns <= now_ns && (m_depth || m_tokens + arrivals < room);
+        ++arrivals) {
+      if (m_flush_ns) {
+        close_window(m_arrivals, m_next_ns);
+      }
+      ++m_arrivals;
+      schedule();
+    }
+  }
+  // Once the flush time has passed, the next arrival closes the window
+  // without waiting for it, from the time it is scheduled at
+  if (m_flush_ns && m_arrivals > m_window_first
+      && now_ns > m_window_first_ns + m_flush_ns) {
+    close_window(m_arrivals, m_next_ns);
+  }
+
+  m_tokens += arrivals;
+  if (m_depth && m_tokens > m_depth) {
+    m_dropped += m_tokens - m_depth;
+    m_tokens = m_depth;
+  }
+}
+
+uint64_t Pacer::fill(uint64_t room) {
+  add_arrivals(room);
+  if (!m_tokens) {
+    wait();
+    add_arrivals(room);
+  }
+  return m_tokens;
+}
+
+uint64_t Pacer::fill(std::chrono::nanoseconds time, uint64_t room) {
+  add_arrivals(time.count(), room);
+  return m_tokens;
+}
+
+void Pacer::wait() {
+  // Wake up at the next arrival, or at the flush time if it comes first
+  double end_ns = m_model == ArrivalModel::CONSTANT && !m_flush_ns ?
+      (m_arrivals + 1) * 1e9 / m_frequency :
+      m_next_ns;
+  if (m_flush_ns && m_arrivals > m_window_first) {
+    end_ns = std::min(end_ns, m_window_first_ns + m_flush_ns + 1.);
+  }
+  clock::time_point const end = m_start
+      + std::chrono::nanoseconds(static_cast<uint64_t>(end_ns));
+  if (!m_busy_wait && end - clock::now() > MIN_SLEEP) {
+    std::this_thread::sleep_until(end - MIN_SLEEP);
+  }
+  while (clock::now() < end) {
+    if (!m_busy_wait) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void Pacer::take(uint64_t events) {
+  assert(events <= m_tokens);
+  m_tokens -= events;
+}
+
+uint64_t Pacer::window_end(uint64_t first) {
+  while (!m_flushed.empty() && m_flushed.front() <= first) {
+    m_flushed.pop_front();
+  }
+  if (!m_flushed.empty() && m_flushed.front() < first + m_window) {
+    return m_flushed.front();
+  }
+  return first + m_window;
+}
+
+uint64_t Pacer::dropped() {
+  uint64_t const dropped = m_dropped;
+  m_dropped = 0;
+  return dropped;
+}
+
+}
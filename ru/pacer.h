@@ -0,0 +1,113 @@
+#ifndef RU_PACER_H
+#define RU_PACER_H
+
+#include <chrono>
+#include <deque>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <cstdint>
+
+namespace lseb {
+
+// Arrival of the events: evenly spaced, as a Poisson process, or on the
+// filled bunch crossings of the LHC orbit
+enum class ArrivalModel {
+  CONSTANT,
+  POISSON,
+  BUNCHES
+};
+
+// Parse the name of an arrival model, return false if unknown
+bool arrival_model_from_string(std::string const& str, ArrivalModel& model);
+
+// Token bucket filled by the arrivals of the events, with the resolution of
+// the nanoseconds of a steady clock. The events are tokens that the
+// generator takes when it has room for them: the ones beyond the depth of
+// the bucket are dropped, as triggers lost while the buffers are full.
+//
+// The time of each arrival is drawn in turn from an engine with a fixed
+// seed, so that all the Readout Units see the same schedule. The arrivals
+// are grouped in windows of the events of a multievent, which a flush time
+// also closes once it has passed since their first arrival: the events that
+// end the windows are then the same everywhere, as long as none is dropped.
+
+class Pacer {
+  typedef std::chrono::steady_clock clock;
+
+  ArrivalModel m_model;
+  double m_frequency;  // mean, Hz
+  uint64_t m_depth;  // events, 0 for an unbounded bucket
+  bool m_busy_wait;
+  uint64_t m_flush_ns;  // 0 to never flush
+  uint64_t m_window;  // events of a multievent
+  clock::time_point m_start;
+
+  uint64_t m_arrivals;
+  double m_next_ns;  // time of the next arrival, since m_start
+  uint64_t m_tokens;
+  uint64_t m_dropped;
+
+  std::mt19937_64 m_engine;
+  std::exponential_distribution<double> m_poisson_gap;  // s
+  // Crossings of the orbit that are filled, the filled ones passed since
+  // m_start, and the ones skipped between two events
+  std::vector<uint64_t> m_filled;
+  uint64_t m_next_filled;
+  std::geometric_distribution<uint64_t> m_bunches_gap;
+
+  // Window of the next arrivals, and the events that end the flushed ones
+  uint64_t m_window_first;
+  double m_window_first_ns;
+  std::deque<uint64_t> m_flushed;
+
+  void schedule();
+  void close_window(uint64_t arrival, double arrival_ns);
+  void add_arrivals(uint64_t room);
+  void add_arrivals(double now_ns, uint64_t room);
+
+ public:
+  Pacer(
+    ArrivalModel model,
+    double frequency,
+    uint64_t depth,
+    bool busy_wait,
+    std::chrono::microseconds flush_time,
+    uint64_t window);
+
+  // Add the events arrived since the last call, and return the tokens. If
+  // there are none, wait for the next arrival and try again once. An unbounded bucket stops at room
+  // tokens, the ones of the generator: the arrivals beyond are added by the
+  // next calls, so that drawing a schedule that is behind the clock costs
+  // no more than the events generated.
+  uint64_t fill(uint64_t room = std::numeric_limits<uint64_t>::max());
+  // Add the events arrived until time, since the construction of the
+  // pacer, without waiting, and return the tokens
+  uint64_t fill(
+    std::chrono::nanoseconds time,
+    uint64_t room = std::numeric_limits<uint64_t>::max());
+  // Wait for the next arrival, or for the flush time if it comes first:
+  // sleeping, then yielding the processor, or spinning with busy_wait
+  void wait();
+  // Take the tokens of the events generated
+  void take(uint64_t events);
+  // Return the event after the last one of the window that starts with the
+  // event first: the one a multievent later, unless flushed before
+  uint64_t window_end(uint64_t first);
+
+  // Return the events dropped since the last call
+  uint64_t dropped();
+  // Rate of arrival of the events when the bucket never fills, in Hz
+  double frequency() const {
+    return m_frequency;
+  }
+  ArrivalModel model() const {
+    return m_model;
+  }
+};
+
+}
+
+#endif
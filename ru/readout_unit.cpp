@@ -3,6 +3,10 @@
 #include <thread>
 #include <chrono>
 #include <algorithm>
+#include <atomic>
+#include <functional>
+#include <numeric>
+#include <utility>
 
 #include <cstdlib>
 #include <cassert>
@@ -13,16 +17,38 @@
 #include "log/log.hpp"
 #include "common/utility.h"
 #include "common/frequency_meter.h"
+#include "common/backoff.h"
+#include "transport/completion_waiter.h"
 
 namespace lseb {
 
-ReadoutUnit::ReadoutUnit(
-    Accumulator& accumulator,
-    int credits,
-    int id)
+// Threads connecting to the Builder Units at the same time
+static int const CONNECT_WORKERS = 16;
+
+// Index of the time slot of the barrel shifter, counted from the epoch of the
+// system clock so that all the nodes agree on it
+static uint64_t current_slot(int slot_time) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count() / slot_time;
+}
+
+ReadoutUnit::ReadoutUnit(Accumulator& accumulator, Options const& options)
     : m_accumulator(accumulator),
-      m_credits(credits),
-      m_id(id) {
+      m_credits(options.credits),
+      m_id(options.id),
+      m_shared_memory(options.shared_memory),
+      m_signal_interval(options.signal_interval),
+      m_shared_completion_queue(options.shared_completion_queue),
+      m_rdm_endpoints(options.rdm_endpoints),
+      m_rdma_write(options.rdma_write),
+      m_spin_time(options.spin_time),
+      m_rails(options.rails),
+      m_datagram_size(options.datagram_size),
+      m_sender_threads(options.sender_threads),
+      m_slot_time(options.slot_time),
+      m_assignment_epoch(options.assignment_epoch),
+      m_feedback_port_offset(options.feedback_port_offset),
+      m_lookahead(options.lookahead) {
 }
 
 void ReadoutUnit::connect(std::vector<Endpoint> const& endpoints){
@@ -31,36 +57,152 @@ void ReadoutUnit::connect(std::vector<Endpoint> const& endpoints){
   LOG_INFO << "Readout Unit - Waiting for connections...";
 
   DataRange const data_range = m_accumulator.data_range();
-  Connector connector(m_credits);
+  Connector connector(m_credits, m_signal_interval);
+  shm::Connector shm_connector(m_credits);
+  local::Connector local_connector(m_credits);
+  dgram::Connector dgram_connector(
+      m_credits,
+      m_id,
+      endpoints[m_id].hostname(),
+      m_datagram_size);
+  if (m_spin_time) {
+    connector.enable_wait();
+    dgram_connector.enable_wait();
+  }
+  if (m_shared_completion_queue) {
+    m_cq = std::make_shared<CompletionQueue>(
+        m_credits * endpoints.size(),
+        m_spin_time > 0);
+    connector.share_completion_queue(m_cq);
+  }
+  if (m_rdm_endpoints) {
+    connector.enable_rdm();
+  }
+  if (m_rdma_write) {
+    connector.enable_write_ring();
+  }
 
-  for (auto id : id_sequence) {
-    Endpoint const& ep = endpoints[id];
-    bool connected = false;
-    while (!connected) {
-      try {
-        auto ret = m_connection_ids.emplace(
-            std::make_pair(id, connector.connect(ep.hostname(), ep.port())));
-        assert(ret.second && "Connection already present");
-        ret.first->second->register_memory(
-            (void*) std::begin(data_range),
-            std::distance(std::begin(data_range), std::end(data_range)));
-        connected = true;
-      } catch (std::exception& e) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-      }
-    }
-    LOG_INFO
-      << "Readout Unit - Connection established with ip "
-      << ep.hostname()
-      << " (bu "
-      << id
-      << ")";
-  }
-  LOG_INFO << "Readout Unit - All connections established";
+  // The Builder Units are connected by a pool of workers, so that the ones
+  // not listening yet do not hold back the others. Each connection is
+  // retried with an exponential backoff.
+  auto const t_start = std::chrono::high_resolution_clock::now();
+  std::vector<std::vector<std::unique_ptr<Connection> > > conns(
+      endpoints.size());
+  std::vector<double> connect_time(endpoints.size(), 0.);
+  std::vector<int> failed_attempts(endpoints.size(), 0);
+  std::atomic<size_t> next_id(0);
+
+  auto connect_workers = [&]() {
+    for (size_t i; (i = next_id++) < id_sequence.size();) {
+      int const id = id_sequence[i];
+      Endpoint const& ep = endpoints[id];
+      bool const self = (id == m_id);
+      bool const local = !self && m_shared_memory
+          && is_local(ep, endpoints[m_id]);
+      // Only the remote Builder Units are reached through several rails
+      int const rails = (self || local) ? 1 : m_rails;
+      for (int rail = 0; rail < rails; ++rail) {
+        std::string const& hostname = ep.rails()[rail];
+        Backoff backoff;
+        bool connected = false;
+        while (!connected) {
+          try {
+            std::unique_ptr<Connection> conn;
+            if (self) {
+              // The own Builder Unit gets the multievents without copies
+              conn = local_connector.connect(ep.hostname(), ep.port());
+            } else if (local) {
+              conn = shm_connector.connect(ep.hostname(), ep.port());
+            } else if (m_datagram_size) {
+              conn = dgram_connector.connect(hostname, ep.port());
+            } else {
+              conn = connector.connect(hostname, ep.port());
+            }
+            conn->register_memory(
+                (void*) std::begin(data_range),
+                std::distance(std::begin(data_range), std::end(data_range)));
+            conns[id].push_back(std::move(conn));
+            connected = true;
+          } catch (std::exception& e) {
+            ++failed_attempts[id];
+            std::this_thread::sleep_for(backoff.next());
+          }
+        }
+        LOG_INFO
+          << "Readout Unit - Connection established with ip "
+          << hostname
+          << " (bu "
+          << id
+          << (self ? ", in-process" :
+              local ? ", shared memory" :
+              m_datagram_size ? ", datagrams" : "")
+          << (rails > 1 ? ", rail " + std::to_string(rail) : "")
+          << ")";
+      }
+      connect_time[id] = std::chrono::duration<double>(
+          std::chrono::high_resolution_clock::now() - t_start).count();
+    }
+  };
+
+  std::vector<std::thread> workers;
+  int const n_workers = std::min<int>(CONNECT_WORKERS, id_sequence.size());
+  for (int i = 0; i < n_workers; ++i) {
+    workers.emplace_back(connect_workers);
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  for (size_t id = 0; id < conns.size(); ++id) {
+    m_connection_ids[id] = std::move(conns[id]);
+  }
+
+  // The Builder Units answer the requests for their status on the port of
+  // their endpoint plus m_feedback_port_offset
+  if (m_assignment_epoch) {
+    m_assignment.reset(new Assignment(endpoints.size(), m_assignment_epoch));
+    for (size_t id = 0; id < endpoints.size(); ++id) {
+      std::string const port = std::to_string(
+          std::stoi(endpoints[id].port()) + m_feedback_port_offset);
+      Backoff backoff;
+      bool connected = false;
+      while (!connected) {
+        try {
+          m_assignment->connect(id, endpoints[id].hostname(), port);
+          connected = true;
+        } catch (std::exception& e) {
+          std::this_thread::sleep_for(backoff.next());
+        }
+      }
+    }
+    LOG_INFO << "Readout Unit - Feedback connections established";
+  }
+
+  auto const slowest = std::max_element(
+      std::begin(connect_time),
+      std::end(connect_time));
+  LOG_INFO
+    << "Readout Unit - All connections established in "
+    << std::chrono::duration<double>(
+        std::chrono::high_resolution_clock::now() - t_start).count()
+    << " s ("
+    << std::accumulate(
+        std::begin(failed_attempts),
+        std::end(failed_attempts),
+        0)
+    << " failed attempts, last bu "
+    << std::distance(std::begin(connect_time), slowest)
+    << " after "
+    << *slowest
+    << " s)";
 }
 
 void ReadoutUnit::run() {
 
+  if (m_sender_threads > 1) {
+    run_sharded();
+    return;
+  }
+
   std::vector<int> id_sequence = create_sequence(m_id, m_connection_ids.size());
 
   FrequencyMeter bandwith(5.0);
@@ -70,43 +212,137 @@ void ReadoutUnit::run() {
   std::chrono::high_resolution_clock::time_point t_start;
   double active_time = 0;
 
-  auto seq_it = std::begin(id_sequence);
-  std::vector<iovec> iov_to_send;
+  // Multievents waiting for a credit, in a ring for each Builder Unit. At
+  // most m_lookahead are acquired ahead of their send, so that a Builder Unit
+  // without credits does not hold back the others while the memory taken
+  // from the generator stays bounded.
+  std::vector<Ring<MultiEventIov> > queued(
+      m_connection_ids.size(),
+      Ring<MultiEventIov>(m_lookahead));
+  int queued_count = 0;
+  std::pair<MultiEventIov, bool> p;
+  p.second = false;  // whether p.first waits for its destination
+
+  // Buffers reused in each iteration, so that polling does not allocate
+  std::vector<iovec> completed_wr(m_credits);
+  std::vector<uint64_t> wr_to_release;
+  wr_to_release.reserve(m_credits * m_connection_ids.size() * m_rails);
+
+  // Sequences of the multievents posted to each connection, which completes
+  // its sends in the same order, in a ring of m_credits slots
+  std::vector<std::vector<Ring<uint64_t> > > posted(m_connection_ids.size());
+  for (auto& conns : m_connection_ids) {
+    posted[conns.first].resize(conns.second.size(), Ring<uint64_t>(m_credits));
+  }
+
+  // The multievents addressed to a Builder Unit go through its rails in
+  // turn, in the order in which it reads them
+  std::vector<int> next_rail(m_connection_ids.size(), 0);
+  std::vector<double> rail_bytes(m_rails, 0.);  // to remote Builder Units
+
+  // With the barrel shifter, the Builder Unit of each slot is the next one of
+  // the previous slot, and the Readout Units start from different ones. The
+  // first slot starts on a boundary.
+  uint64_t slot = 0;
+  uint64_t report_slot = 0;
+  uint64_t last_used_slot = 0;
+  uint64_t used_slots = 0;
+  double slot_bytes = 0.;  // posted in the used slots
+  if (m_slot_time) {
+    uint64_t const first_slot = current_slot(m_slot_time) + 1;
+    while ((slot = current_slot(m_slot_time)) < first_slot) {
+      std::this_thread::sleep_for(std::chrono::microseconds(m_slot_time) / 4);
+    }
+    report_slot = slot;
+    last_used_slot = slot - 1;
+  }
+
+  // Post the multievents queued for a Builder Unit while it has credits on
+  // its next rail, return the bytes posted
+  auto send_queued = [&](int id) {
+    auto& conns = m_connection_ids.at(id);
+    auto& pending = queued[id];
+    int& rail = next_rail[id];
+    size_t bytes = 0;
+    while (!pending.empty() && conns[rail]->available_send()) {
+      MultiEventIov const data = pending.pop();
+      conns[rail]->post_sendv(data.iov, data.count);
+      posted[id][rail].push(data.sequence);
+      rail = (rail + 1) % conns.size();
+      --queued_count;
+      for (int i = 0; i < data.count; ++i) {
+        bytes += data.iov[i].iov_len;
+      }
+      LOG_TRACE << "Readout Unit - Written 1 wrs to conn " << id;
+    }
+    return bytes;
+  };
+
+  // Once idle for m_spin_time, block until some connection completes or the
+  // timeout of the waiter, after which new multievents are looked for
+  std::unique_ptr<CompletionWaiter> waiter;
+  if (m_spin_time) {
+    waiter.reset(new CompletionWaiter(std::chrono::microseconds(m_spin_time)));
+    for (auto& conns : m_connection_ids) {
+      for (auto& conn : conns.second) {
+        waiter->add(*conn);
+      }
+    }
+  }
 
   while (true) {
 
     t_start = std::chrono::high_resolution_clock::now();
     bool active_flag = false;
-    bool conn_avail = false;
-    int seq_id = *seq_it;
 
-    // Check for data to acquire
-    std::pair<iovec, bool> p;
-    p.second = true;
-    for (int i = iov_to_send.size(); i <= seq_id && p.second; ++i) {
-      p = m_accumulator.get_multievent();
-      if (p.second) {
-        iov_to_send.push_back(p.first);
+    // Check for data to acquire. The n-th multievent of each cycle goes to
+    // the n-th Builder Unit, unless they are assigned from the status of the
+    // Builder Units.
+    while (queued_count < m_lookahead) {
+      if (!p.second) {
+        p = m_accumulator.get_multievent();
+        if (!p.second) {
+          break;
+        }
+      }
+      int const id = m_assignment ?
+          m_assignment->destination(p.first.sequence) :
+          p.first.sequence % m_connection_ids.size();
+      if (id < 0) {
+        break;
       }
+      queued[id].push(p.first);
+      ++queued_count;
+      p.second = false;
     }
 
-    // Check for completed wr (in all connections)
-    std::vector<void*> wr_to_release;
+    // Check for completed wr (in all connections). With a shared queue, the
+    // remote connections only return what it has handed to them.
+    wr_to_release.clear();
+    if (m_cq) {
+      m_cq->poll();
+    }
     for (auto id : id_sequence) {
-      auto& conn = *(m_connection_ids.at(id));
-      std::vector<iovec> completed_wr = conn.poll_completed_send();
-      for (auto const& wr : completed_wr) {
-        bandwith.add(wr.iov_len);
-        wr_to_release.push_back(wr.iov_base);
-      }
-      int const count = completed_wr.size();
-      conn_avail = (seq_id == id) ? (conn.available_send()) : conn_avail;
-      if (!count) {
-        LOG_TRACE
-          << "Readout Unit - Completed "
-          << count
-          << " wrs of conn "
-          << id;
+      auto& conns = m_connection_ids.at(id);
+      for (size_t rail = 0; rail < conns.size(); ++rail) {
+        auto& conn = *conns[rail];
+        int const count = conn.poll_completed_send(
+            completed_wr.data(),
+            completed_wr.size());
+        for (int i = 0; i < count; ++i) {
+          bandwith.add(completed_wr[i].iov_len);
+          if (conns.size() > 1) {
+            rail_bytes[rail] += completed_wr[i].iov_len;
+          }
+          wr_to_release.push_back(posted[id][rail].pop());
+        }
+        if (!count) {
+          LOG_TRACE
+            << "Readout Unit - Completed "
+            << count
+            << " wrs of conn "
+            << id;
+        }
       }
     }
 
@@ -116,30 +352,201 @@ void ReadoutUnit::run() {
       m_accumulator.release_multievents(wr_to_release);
     }
 
-    // If there are free resources for this connection and ready data, send it
-    if (conn_avail && iov_to_send.size() > seq_id) {
-      active_flag = true;
-      auto& iov = iov_to_send[seq_id];
-      auto& conn = *(m_connection_ids.at(seq_id));
-      conn.post_send(iov);
-      LOG_TRACE << "Readout Unit - Written 1 wrs to conn " << seq_id;
+    // Send to every Builder Unit with free resources and ready data, or only
+    // to the one of the slot
+    if (m_slot_time) {
+      slot = current_slot(m_slot_time);
+      size_t const bytes = send_queued((slot + m_id) % m_connection_ids.size());
+      if (bytes) {
+        active_flag = true;
+        if (slot != last_used_slot) {
+          last_used_slot = slot;
+          ++used_slots;
+        }
+        slot_bytes += bytes;
+      }
+    } else {
+      for (auto id : id_sequence) {
+        if (send_queued(id)) {
+          active_flag = true;
+        }
+      }
+    }
+
+    if (active_flag) {
+      active_time += std::chrono::duration<double>(
+          std::chrono::high_resolution_clock::now() - t_start).count();
+    }
+    if (waiter) {
+      waiter->progress(active_flag);
+    }
+
+    if (bandwith.check()) {
+
+      double tot_time = std::chrono::duration<double>(
+          std::chrono::high_resolution_clock::now() - t_tot).count();
 
-      // Increment seq_it and check for end of a cycle
-      if (++seq_it == std::end(id_sequence)) {
-        // End of a cycle
-        seq_it = std::begin(id_sequence);
-        assert(iov_to_send.size() == m_connection_ids.size());
-        iov_to_send.clear();
+      LOG_INFO
+        << "Readout Unit: "
+        << bandwith.frequency() / std::giga::num * 8.
+        << " Gb/s - "
+        << active_time / tot_time * 100.
+        << " %";
+      if (m_rails > 1) {
+        for (int rail = 0; rail < m_rails; ++rail) {
+          LOG_INFO
+            << "Readout Unit - Rail "
+            << rail
+            << ": "
+            << rail_bytes[rail] / tot_time / std::giga::num * 8.
+            << " Gb/s";
+          rail_bytes[rail] = 0.;
+        }
       }
+      if (m_slot_time) {
+        uint64_t const slots = current_slot(m_slot_time) - report_slot;
+        LOG_INFO
+          << "Readout Unit - Slots of "
+          << m_slot_time
+          << " us: "
+          << (slots ? 100. * used_slots / slots : 0.)
+          << " % occupied, "
+          << (used_slots ? slot_bytes / used_slots : 0.)
+          << " bytes per occupied slot";
+        report_slot += slots;
+        used_slots = 0;
+        slot_bytes = 0.;
+      }
+      if (m_assignment) {
+        std::string shares;
+        for (auto share : m_assignment->last_shares()) {
+          shares += " " + std::to_string(share);
+        }
+        LOG_INFO
+          << "Readout Unit - Multievents of the last epoch by bu:"
+          << shares;
+      }
+      if (waiter) {
+        LOG_INFO
+          << "Readout Unit - Blocked "
+          << waiter->blocks()
+          << " times waiting for completions";
+      }
+      active_time = 0;
+      t_tot = std::chrono::high_resolution_clock::now();
+    }
+  }
+
+  LOG_DEBUG << "Readout Unit: exiting";
+}
+
+void ReadoutUnit::run_sharded() {
+
+  std::vector<int> id_sequence = create_sequence(m_id, m_connection_ids.size());
+  int const threads = std::min<int>(
+      m_sender_threads,
+      m_connection_ids.size());
+
+  // The Builder Units are dealt to the threads, each of which polls them in
+  // the same order as a single thread would
+  std::vector<std::unique_ptr<Shard> > shards;
+  size_t const shard_size = m_credits * m_rails
+      * ((m_connection_ids.size() + threads - 1) / threads);
+  for (int t = 0; t < threads; ++t) {
+    shards.emplace_back(new Shard(shard_size));
+  }
+  for (auto id : id_sequence) {
+    shards[id % threads]->ids.push_back(id);
+  }
+  std::vector<std::thread> senders;
+  for (int t = 0; t < threads; ++t) {
+    senders.emplace_back(&ReadoutUnit::send, this, std::ref(*shards[t]), t);
+  }
+
+  FrequencyMeter bandwith(5.0);
+
+  std::chrono::high_resolution_clock::time_point t_tot =
+      std::chrono::high_resolution_clock::now();
+  std::chrono::high_resolution_clock::time_point t_start;
+  double active_time = 0;
+
+  // Each multievent goes to the same Builder Unit as with a single thread.
+  // It is held until the queue of its shard has room.
+  std::pair<int, MultiEventIov> next;
+  bool pending = false;
+
+  std::vector<uint64_t> wr_to_release;
+  wr_to_release.reserve(shard_size * threads);
+  uint64_t bytes = 0;
+
+  // Once idle for m_spin_time, block until a thread hands back some
+  // multievents or the timeout of the waiter, after which new ones are
+  // looked for
+  std::unique_ptr<CompletionWaiter> waiter;
+  if (m_spin_time) {
+    waiter.reset(new CompletionWaiter(std::chrono::microseconds(m_spin_time)));
+    for (auto& shard : shards) {
+      waiter->add(shard->reclaimer);
+    }
+  }
+
+  while (true) {
+
+    t_start = std::chrono::high_resolution_clock::now();
+    bool active_flag = false;
+
+    // Check for data to acquire
+    if (!pending) {
+      std::pair<MultiEventIov, bool> p = m_accumulator.get_multievent();
+      if (p.second) {
+        next = std::make_pair(-1, p.first);
+        pending = true;
+      }
+    }
+    if (pending && next.first < 0) {
+      next.first = m_assignment ?
+          m_assignment->destination(next.second.sequence) :
+          next.second.sequence % m_connection_ids.size();
+    }
+    if (pending && next.first >= 0) {
+      Shard& shard = *shards[next.first % threads];
+      if (shard.to_send.push(next)) {
+        shard.sender.ring();
+        active_flag = true;
+        pending = false;
+      }
+    }
+
+    // Release the multievents completed by all the threads
+    wr_to_release.clear();
+    uint64_t seq;
+    for (auto& shard : shards) {
+      while (shard->sent.pop(seq)) {
+        wr_to_release.push_back(seq);
+      }
+    }
+    if (!wr_to_release.empty()) {
+      active_flag = true;
+      m_accumulator.release_multievents(wr_to_release);
     }
 
     if (active_flag) {
       active_time += std::chrono::duration<double>(
           std::chrono::high_resolution_clock::now() - t_start).count();
     }
+    if (waiter) {
+      waiter->progress(active_flag);
+    }
 
     if (bandwith.check()) {
 
+      uint64_t total = 0;
+      for (auto& shard : shards) {
+        total += shard->bytes.load(std::memory_order_relaxed);
+      }
+      bandwith.add(total - bytes);
+      bytes = total;
+
       double tot_time = std::chrono::duration<double>(
           std::chrono::high_resolution_clock::now() - t_tot).count();
 
@@ -149,12 +556,187 @@ void ReadoutUnit::run() {
         << " Gb/s - "
         << active_time / tot_time * 100.
         << " %";
+      if (m_assignment) {
+        std::string shares;
+        for (auto share : m_assignment->last_shares()) {
+          shares += " " + std::to_string(share);
+        }
+        LOG_INFO
+          << "Readout Unit - Multievents of the last epoch by bu:"
+          << shares;
+      }
+      if (waiter) {
+        LOG_INFO
+          << "Readout Unit - Blocked "
+          << waiter->blocks()
+          << " times waiting for the sender threads";
+      }
       active_time = 0;
       t_tot = std::chrono::high_resolution_clock::now();
     }
   }
 
+  for (auto& sender : senders) {
+    sender.join();
+  }
+
   LOG_DEBUG << "Readout Unit: exiting";
 }
 
+void ReadoutUnit::send(Shard& shard, int thread) {
+
+  FrequencyMeter bandwith(5.0);
+
+  std::chrono::high_resolution_clock::time_point t_tot =
+      std::chrono::high_resolution_clock::now();
+  std::chrono::high_resolution_clock::time_point t_start;
+  double active_time = 0;
+
+  // Buffers reused in each iteration, so that polling does not allocate. The
+  // sequences that do not fit in the queue of the reclaimer are kept.
+  std::vector<iovec> completed_wr(m_credits);
+  std::vector<uint64_t> wr_to_release;
+  wr_to_release.reserve(m_credits * shard.ids.size() * m_rails);
+
+  // The multievents handed to the thread wait for a credit of their Builder
+  // Unit in its own ring, at most m_lookahead of them
+  std::vector<Ring<MultiEventIov> > queued(
+      m_connection_ids.size(),
+      Ring<MultiEventIov>(0));
+  int queued_count = 0;
+  std::pair<int, MultiEventIov> next;
+
+  std::vector<std::vector<Ring<uint64_t> > > posted(m_connection_ids.size());
+  std::vector<int> next_rail(m_connection_ids.size(), 0);
+  std::vector<double> rail_bytes(m_rails, 0.);
+  bool striped = false;  // whether the shard has remote Builder Units
+  for (auto id : shard.ids) {
+    queued[id] = Ring<MultiEventIov>(m_lookahead);
+    posted[id].resize(m_connection_ids.at(id).size(), Ring<uint64_t>(m_credits));
+    striped = striped || m_connection_ids.at(id).size() > 1;
+  }
+
+  std::unique_ptr<CompletionWaiter> waiter;
+  if (m_spin_time) {
+    waiter.reset(new CompletionWaiter(std::chrono::microseconds(m_spin_time)));
+    for (auto id : shard.ids) {
+      for (auto& conn : m_connection_ids.at(id)) {
+        waiter->add(*conn);
+      }
+    }
+    waiter->add(shard.sender);
+  }
+
+  while (true) {
+
+    t_start = std::chrono::high_resolution_clock::now();
+    bool active_flag = false;
+
+    while (queued_count < m_lookahead && shard.to_send.pop(next)) {
+      queued[next.first].push(next.second);
+      ++queued_count;
+    }
+
+    // Check for completed wr (in the connections of the shard)
+    uint64_t bytes = 0;
+    for (auto id : shard.ids) {
+      auto& conns = m_connection_ids.at(id);
+      for (size_t rail = 0; rail < conns.size(); ++rail) {
+        int const count = conns[rail]->poll_completed_send(
+            completed_wr.data(),
+            completed_wr.size());
+        for (int i = 0; i < count; ++i) {
+          bytes += completed_wr[i].iov_len;
+          if (conns.size() > 1) {
+            rail_bytes[rail] += completed_wr[i].iov_len;
+          }
+          wr_to_release.push_back(posted[id][rail].pop());
+        }
+      }
+    }
+    if (bytes) {
+      bandwith.add(bytes);
+      shard.bytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    // Hand the completed wr to the reclaimer
+    if (!wr_to_release.empty()) {
+      active_flag = true;
+      size_t handed = 0;
+      while (handed < wr_to_release.size()
+          && shard.sent.push(wr_to_release[handed])) {
+        ++handed;
+      }
+      wr_to_release.erase(
+          std::begin(wr_to_release),
+          std::begin(wr_to_release) + handed);
+      if (handed) {
+        shard.reclaimer.ring();
+      }
+    }
+
+    // Send to every Builder Unit with free resources and ready data
+    for (auto id : shard.ids) {
+      auto& conns = m_connection_ids.at(id);
+      auto& pending = queued[id];
+      int& rail = next_rail[id];
+      while (!pending.empty() && conns[rail]->available_send()) {
+        active_flag = true;
+        MultiEventIov const data = pending.pop();
+        conns[rail]->post_sendv(data.iov, data.count);
+        posted[id][rail].push(data.sequence);
+        rail = (rail + 1) % conns.size();
+        --queued_count;
+        LOG_TRACE << "Readout Unit - Written 1 wrs to conn " << id;
+      }
+    }
+
+    if (active_flag) {
+      active_time += std::chrono::duration<double>(
+          std::chrono::high_resolution_clock::now() - t_start).count();
+    }
+    if (waiter) {
+      waiter->progress(active_flag);
+    }
+
+    if (bandwith.check()) {
+
+      double tot_time = std::chrono::duration<double>(
+          std::chrono::high_resolution_clock::now() - t_tot).count();
+
+      LOG_INFO
+        << "Readout Unit - Sender thread "
+        << thread
+        << ": "
+        << bandwith.frequency() / std::giga::num * 8.
+        << " Gb/s - "
+        << active_time / tot_time * 100.
+        << " %";
+      if (striped) {
+        for (int rail = 0; rail < m_rails; ++rail) {
+          LOG_INFO
+            << "Readout Unit - Sender thread "
+            << thread
+            << " - Rail "
+            << rail
+            << ": "
+            << rail_bytes[rail] / tot_time / std::giga::num * 8.
+            << " Gb/s";
+          rail_bytes[rail] = 0.;
+        }
+      }
+      if (waiter) {
+        LOG_INFO
+          << "Readout Unit - Sender thread "
+          << thread
+          << " blocked "
+          << waiter->blocks()
+          << " times waiting for completions";
+      }
+      active_time = 0;
+      t_tot = std::chrono::high_resolution_clock::now();
+    }
+  }
+}
+
 }
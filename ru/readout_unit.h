@@ -1,28 +1,123 @@
 #ifndef RU_READOUT_UNIT_H
 #define RU_READOUT_UNIT_H
 
+#include <atomic>
 #include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <cassert>
+#include <cstdint>
 
 #include <sys/uio.h>
 
 #include "ru/accumulator.h"
+#include "ru/assignment.h"
+#include "common/spsc_queue.h"
 
+#include "transport/completion_waiter.h"
 #include "transport/transport.h"
 #include "transport/endpoints.h"
 
 namespace lseb {
 
 class ReadoutUnit {
+ public:
+  // Settings of the Readout Unit, from the configuration
+  struct Options {
+    int credits = 0;
+    int id = 0;
+    bool shared_memory = false;
+    int signal_interval = 1;  // sends, one signaled in each
+    bool shared_completion_queue = false;
+    bool rdm_endpoints = false;
+    bool rdma_write = false;
+    int spin_time = 0;  // us, 0 to always poll
+    int rails = 1;
+    int datagram_size = 0;  // 0 for reliable connections
+    int sender_threads = 1;
+    int slot_time = 0;  // us, 0 to send as soon as credits allow
+    int assignment_epoch = 0;  // multievents, 0 to deal them in turn
+    int feedback_port_offset = 1000;  // from the port of the endpoint
+    int lookahead = 1;  // multievents acquired and not yet posted, by thread
+  };
+
+ private:
+  // Ring of a fixed size, emptied in the order in which it is filled
+  template<typename T>
+  struct Ring {
+    std::vector<T> ring;
+    uint64_t head;
+    uint64_t tail;
+
+    explicit Ring(size_t size)
+        : ring(size),
+          head(0),
+          tail(0) {
+    }
+    bool empty() const {
+      return head == tail;
+    }
+    void push(T const& value) {
+      assert(head - tail < ring.size());
+      ring[head++ % ring.size()] = value;
+    }
+    T pop() {
+      assert(tail != head);
+      return ring[tail++ % ring.size()];
+    }
+  };
+
+  // Destinations of a sender thread, which posts the multievents handed to
+  // it and hands back the sequences of the completed ones
+  struct Shard {
+    std::vector<int> ids;
+    SpscQueue<std::pair<int, MultiEventIov> > to_send;
+    SpscQueue<uint64_t> sent;
+    std::atomic<uint64_t> bytes;  // completed, summed by the reclaimer
+    Doorbell sender;  // rung after filling to_send
+    Doorbell reclaimer;  // rung after filling sent
+
+    explicit Shard(size_t size)
+        : to_send(size),
+          sent(size),
+          bytes(0) {
+    }
+  };
+
   Accumulator& m_accumulator;
-  std::map<int, std::unique_ptr<Socket> > m_connection_ids;
+  // Connections to each Builder Unit, one per rail if remote
+  std::map<int, std::vector<std::unique_ptr<Connection> > > m_connection_ids;
   int m_credits;
   int m_id;
+  bool m_shared_memory;
+  int m_signal_interval;
+  bool m_shared_completion_queue;
+  bool m_rdm_endpoints;
+  bool m_rdma_write;
+  int m_spin_time;  // us, 0 to always poll
+  int m_rails;
+  int m_datagram_size;  // 0 for reliable connections
+  int m_sender_threads;
+  int m_slot_time;  // us, 0 to send as soon as credits allow
+  int m_assignment_epoch;  // multievents, 0 to deal them in turn
+  int m_feedback_port_offset;
+  int m_lookahead;  // multievents acquired and not yet posted, by thread
+
+  // Completions of the remote connections, when they share a single queue
+  std::shared_ptr<CompletionQueue> m_cq;
+
+  // Destinations of the multievents, from the status of the Builder Units
+  std::unique_ptr<Assignment> m_assignment;
+
+  // With several sender threads, this thread acquires the multievents and
+  // releases the completed ones, while each shard is sent by its own thread
+  void run_sharded();
+  void send(Shard& shard, int thread);
 
  public:
-  ReadoutUnit(
-    Accumulator& accumulator,
-    int credits,
-    int id);
+  ReadoutUnit(Accumulator& accumulator, Options const& options);
   void connect(std::vector<Endpoint> const& endpoints);
   void run();
 };
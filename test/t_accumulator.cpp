@@ -0,0 +1,215 @@
+#include <chrono>
+#include <vector>
+
+#include <boost/detail/lightweight_test.hpp>
+
+#include "common/dataformat.h"
+#include "common/pointer_cast.h"
+#include "generator/generator.h"
+#include "generator/length_generator.h"
+#include "log/log.hpp"
+#include "ru/accumulator.h"
+
+using namespace lseb;
+
+// Multievents of one event each, from a ring of events small enough for the
+// multievents acquired and not yet released to span several words of the
+// bitmap of the accumulator, and to wrap around both of its rings
+
+static size_t const ring_events = 200;
+static size_t const event_size = 32;
+
+static std::vector<uint64_t> acquire(Accumulator& accumulator, int attempts) {
+  std::vector<uint64_t> sequences;
+  for (int i = 0; i < attempts; ++i) {
+    std::pair<MultiEventIov, bool> p = accumulator.get_multievent();
+    if (p.second) {
+      BOOST_TEST_EQ(p.first.count, 1);
+      EventHeader const& header =
+        *pointer_cast<EventHeader>(p.first.iov[0].iov_base);
+      BOOST_TEST_EQ(header.id, p.first.sequence % ring_events);
+      sequences.push_back(p.first.sequence);
+      i = 0;
+    }
+  }
+  return sequences;
+}
+
+static void release(Accumulator& accumulator, uint64_t sequence) {
+  accumulator.release_multievents(std::vector<uint64_t>(1, sequence));
+}
+
+// Multievents flushed before they have the events of a full one: they are
+// acquired until the generator is full, and must have the events of the
+// windows cut by a pacer with the same schedule. The next event is then the
+// first of the data of each.
+static std::vector<uint64_t> acquire_windows(
+  Accumulator& accumulator,
+  int attempts,
+  std::vector<uint64_t> const& windows,
+  size_t& window,
+  uint64_t& next_event) {
+  std::vector<uint64_t> sequences;
+  for (int i = 0; i < attempts; ++i) {
+    std::pair<MultiEventIov, bool> p = accumulator.get_multievent();
+    if (p.second) {
+      uint64_t const events = windows[window++];
+      uint64_t const first_slot = next_event % ring_events;
+      BOOST_TEST_EQ(p.first.count, first_slot + events > ring_events ? 2 : 1);
+      size_t length = 0;
+      for (int s = 0; s < p.first.count; ++s) {
+        length += p.first.iov[s].iov_len;
+      }
+      BOOST_TEST_EQ(length, events * event_size);
+      EventHeader const& header =
+        *pointer_cast<EventHeader>(p.first.iov[0].iov_base);
+      BOOST_TEST_EQ(header.id, first_slot);
+      next_event += events;
+      sequences.push_back(p.first.sequence);
+      i = 0;
+    }
+  }
+  return sequences;
+}
+
+int main() {
+
+  async_log::init();
+  async_log::add_console(async_log::severity_level::warning);
+
+  std::vector<EventMetaData> metadata(
+    ring_events,
+    EventMetaData(0, 0, 0));
+  std::vector<unsigned char> data(ring_events * event_size * 2);
+  MetaDataRange const metadata_range(
+    metadata.data(),
+    metadata.data() + metadata.size());
+  DataRange const data_range(data.data(), data.data() + data.size());
+
+  LengthGenerator const length_generator(event_size - sizeof(EventHeader));
+  Generator const generator(length_generator, metadata_range, data_range, 0);
+  Pacer const pacer(
+    ArrivalModel::CONSTANT,
+    1e9,
+    0,
+    false,
+    std::chrono::microseconds(0),
+    1);
+  Controller const controller(generator, metadata_range, pacer);
+  Accumulator accumulator(controller, metadata_range, data_range, 1);
+
+  int const attempts = 1000;
+
+  // The generator keeps an event free
+  std::vector<uint64_t> sequences = acquire(accumulator, attempts);
+  BOOST_TEST_EQ(sequences.size(), ring_events - 1);
+  BOOST_TEST_EQ(sequences.back(), ring_events - 2);
+
+  // All but the first released, in reverse order: nothing is given back to
+  // the generator until the first one is released too
+  for (uint64_t s = ring_events - 2; s > 0; --s) {
+    release(accumulator, s);
+  }
+  BOOST_TEST(acquire(accumulator, attempts).empty());
+  release(accumulator, 0);
+  sequences = acquire(accumulator, attempts);
+  BOOST_TEST_EQ(sequences.size(), ring_events - 1);
+  uint64_t const first = ring_events - 1;
+  uint64_t const last = first + ring_events - 2;
+  BOOST_TEST_EQ(sequences.front(), first);
+  BOOST_TEST_EQ(sequences.back(), last);
+
+  // The odd ones released first, the first of which is at the front: only
+  // that one is given back
+  for (uint64_t s = first; s <= last; s += 2) {
+    release(accumulator, s);
+  }
+  sequences = acquire(accumulator, attempts);
+  BOOST_TEST_EQ(sequences.size(), 1u);
+
+  // The even ones from the back, across the words of the bitmap: the one at
+  // the front holds all the others
+  for (uint64_t s = last - 1; s > first + 1; s -= 2) {
+    release(accumulator, s);
+  }
+  BOOST_TEST(acquire(accumulator, attempts).empty());
+  release(accumulator, first + 1);
+  sequences = acquire(accumulator, attempts);
+  BOOST_TEST_EQ(sequences.size(), ring_events - 2);
+  BOOST_TEST_EQ(sequences.front(), last + 2);
+
+  // Multievents of up to 4 events, flushed after 2 us, from events arriving
+  // at 1 MHz as a Poisson process: they are of any length from 1 to 4, and
+  // many wrap around the end of the rings
+  {
+    std::vector<EventMetaData> metadata(
+      ring_events,
+      EventMetaData(0, 0, 0));
+    std::vector<unsigned char> data(ring_events * event_size * 2);
+    MetaDataRange const metadata_range(
+      metadata.data(),
+      metadata.data() + metadata.size());
+    DataRange const data_range(data.data(), data.data() + data.size());
+    Generator const generator(length_generator, metadata_range, data_range, 0);
+
+    uint64_t const window = 4;
+    std::chrono::microseconds const flush_time(2);
+    Pacer const pacer(
+      ArrivalModel::POISSON,
+      1e6,
+      0,
+      false,
+      flush_time,
+      window);
+    Controller const controller(generator, metadata_range, pacer);
+    Accumulator accumulator(controller, metadata_range, data_range, window);
+
+    // The windows of the schedule of the first 10 ms
+    Pacer schedule(ArrivalModel::POISSON, 1e6, 0, false, flush_time, window);
+    uint64_t const arrived = schedule.fill(std::chrono::milliseconds(10));
+    std::vector<uint64_t> windows;
+    for (uint64_t first = 0; first + window <= arrived;) {
+      uint64_t const end = schedule.window_end(first);
+      windows.push_back(end - first);
+      first = end;
+    }
+
+    size_t next_window = 0;
+    uint64_t next_event = 0;
+    for (int round = 0; round < 6; ++round) {
+      // The generator is full once the next window does not fit in the
+      // events it keeps, less one, after the previous ones were released
+      size_t expected_window = next_window;
+      for (uint64_t events = 0;
+          events + windows[expected_window] < ring_events;
+          events += windows[expected_window++]) {
+      }
+      sequences = acquire_windows(
+        accumulator,
+        attempts,
+        windows,
+        next_window,
+        next_event);
+      BOOST_TEST_EQ(next_window, expected_window);
+      BOOST_TEST(!sequences.empty());
+
+      // Released in reverse order, or the odd ones first, so that they are
+      // given back to the generator together with the first one
+      if (round % 2) {
+        for (size_t i = 1; i < sequences.size(); i += 2) {
+          release(accumulator, sequences[i]);
+        }
+        for (size_t i = 0; i < sequences.size(); i += 2) {
+          release(accumulator, sequences[i]);
+        }
+      } else {
+        for (size_t i = sequences.size(); i > 0; --i) {
+          release(accumulator, sequences[i - 1]);
+        }
+      }
+    }
+    BOOST_TEST(next_event > 5 * ring_events);
+  }
+
+  return boost::report_errors();
+}
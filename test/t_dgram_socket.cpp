@@ -0,0 +1,124 @@
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <cstdint>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <boost/detail/lightweight_test.hpp>
+
+#include "transport/dgram/acceptor.h"
+
+using namespace lseb;
+
+// A source introduced and sending its fragments through a plain UDP socket,
+// some of them twice: each fragment must be counted once, and a multievent
+// delivered only when all of its fragments have arrived.
+
+static size_t const size = 100;
+static int const credits = 4;
+static uint32_t const source = 3;
+
+static void send(int fd, dgram::Header const& header, void const* data,
+    size_t len) {
+  std::vector<unsigned char> datagram(sizeof(header) + len);
+  std::memcpy(datagram.data(), &header, sizeof(header));
+  std::memcpy(datagram.data() + sizeof(header), data, len);
+  sockaddr_in to;
+  std::memset(&to, 0, sizeof(to));
+  to.sin_family = AF_INET;
+  to.sin_port = htons(7393);
+  to.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  sendto(fd, datagram.data(), datagram.size(), 0,
+      reinterpret_cast<sockaddr const*>(&to), sizeof(to));
+}
+
+static std::vector<iovec> poll(dgram::Socket& socket) {
+  std::vector<iovec> received;
+  for (int round = 0; round < 100; ++round) {
+    for (auto const& iov : socket.poll_completed_recv()) {
+      received.push_back(iov);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return received;
+}
+
+int main() {
+
+  dgram::Acceptor acceptor(credits, size);
+  acceptor.listen("127.0.0.1", "7393");
+
+  int const fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+  sockaddr_in name;
+  std::memset(&name, 0, sizeof(name));
+  name.sin_family = AF_INET;
+  name.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  BOOST_TEST_EQ(
+    bind(fd, reinterpret_cast<sockaddr const*>(&name), sizeof(name)), 0);
+  socklen_t len = sizeof(name);
+  getsockname(fd, reinterpret_cast<sockaddr*>(&name), &len);
+
+  dgram::Header header;
+  std::memset(&header, 0, sizeof(header));
+  header.type = dgram::Header::HELLO;
+  header.source = source;
+  header.length = sizeof(name);
+  send(fd, header, &name, sizeof(name));
+  std::unique_ptr<dgram::Socket> socket = acceptor.accept();
+
+  size_t const payload = size - sizeof(dgram::Header);
+  std::vector<unsigned char> buffers(credits * 3 * payload);
+  for (int b = 0; b < credits; ++b) {
+    socket->post_recv({ &buffers[b * 3 * payload], 3 * payload });
+  }
+
+  // A multievent of three fragments, the first one sent three times
+  std::vector<unsigned char> multievent(3 * payload - 10);
+  for (size_t i = 0; i < multievent.size(); ++i) {
+    multievent[i] = (i * 7) & 0xff;
+  }
+  auto const fragment = [&](uint32_t offset) {
+    header.type = dgram::Header::FRAGMENT;
+    header.sequence = 0;
+    header.length = multievent.size();
+    header.offset = offset;
+    send(fd, header, &multievent[offset],
+        std::min(payload, multievent.size() - offset));
+  };
+  fragment(0);
+  fragment(0);
+  fragment(payload);
+  fragment(0);
+  BOOST_TEST(poll(*socket).empty());
+  dgram::Statistics statistics = acceptor.statistics();
+  BOOST_TEST_EQ(statistics.duplicate_fragments, 2u);
+  BOOST_TEST_EQ(statistics.dropped_fragments, 0u);
+
+  // The last one completes it, and is then late
+  fragment(2 * payload);
+  std::vector<iovec> const received = poll(*socket);
+  BOOST_TEST_EQ(received.size(), 1u);
+  if (!received.empty()) {
+    BOOST_TEST_EQ(received.front().iov_len, multievent.size());
+    BOOST_TEST(!std::memcmp(
+      received.front().iov_base,
+      multievent.data(),
+      multievent.size()));
+  }
+  fragment(payload);
+  poll(*socket);
+  statistics = acceptor.statistics();
+  BOOST_TEST_EQ(statistics.late_fragments, 1u);
+  BOOST_TEST_EQ(statistics.duplicate_fragments, 0u);
+  BOOST_TEST_EQ(statistics.lost_multievents, 0u);
+
+  close(fd);
+  return boost::report_errors();
+}
@@ -0,0 +1,178 @@
+#include <chrono>
+#include <vector>
+
+#include <cstdint>
+
+#include <boost/detail/lightweight_test.hpp>
+
+#include "ru/pacer.h"
+
+using namespace lseb;
+
+// The pacers are filled at given times since their construction, so that
+// the schedules are checked over a virtual time, however long they take
+
+static ArrivalModel const models[] = { ArrivalModel::CONSTANT,
+  ArrivalModel::POISSON, ArrivalModel::BUNCHES };
+
+static Pacer make_pacer(ArrivalModel model, double frequency, uint64_t depth) {
+  return Pacer(model, frequency, depth, false, std::chrono::microseconds(0), 1);
+}
+
+// Tokens taken at each step of the virtual time, from a phase up to the end
+static std::vector<uint64_t> run(
+  Pacer& pacer,
+  std::chrono::nanoseconds step,
+  std::chrono::nanoseconds end,
+  std::chrono::nanoseconds phase = std::chrono::nanoseconds(0)) {
+  std::vector<uint64_t> tokens;
+  for (std::chrono::nanoseconds t = phase + step; t <= end; t += step) {
+    tokens.push_back(pacer.fill(t));
+    pacer.take(tokens.back());
+  }
+  return tokens;
+}
+
+static uint64_t sum(std::vector<uint64_t> const& tokens) {
+  uint64_t total = 0;
+  for (uint64_t t : tokens) {
+    total += t;
+  }
+  return total;
+}
+
+int main() {
+
+  ArrivalModel model;
+  BOOST_TEST(arrival_model_from_string("POISSON", model));
+  BOOST_TEST(model == ArrivalModel::POISSON);
+  BOOST_TEST(!arrival_model_from_string("poisson", model));
+
+  // The mean rate of each model over a second, within 1% of the requested
+  // one. A million events arrive, so that the random ones deviate by about
+  // 0.1%.
+  double const frequency = 1e6;
+  for (ArrivalModel m : models) {
+    Pacer pacer = make_pacer(m, frequency, 0);
+    uint64_t const arrived = sum(
+      run(pacer, std::chrono::microseconds(100), std::chrono::seconds(1)));
+    BOOST_TEST(arrived > frequency * 0.99 && arrived < frequency * 1.01);
+    BOOST_TEST_EQ(pacer.dropped(), 0u);
+  }
+  {
+    Pacer pacer = make_pacer(ArrivalModel::CONSTANT, frequency, 0);
+    BOOST_TEST_EQ(pacer.fill(std::chrono::milliseconds(1)), 1000u);
+  }
+
+  // The events beyond the depth of the bucket are dropped, and counted once
+  for (ArrivalModel m : models) {
+    uint64_t const depth = 100;
+    Pacer pacer = make_pacer(m, frequency, depth);
+    uint64_t dropped = 0;
+    uint64_t taken = 0;
+    for (int ms = 1; ms <= 10; ++ms) {
+      BOOST_TEST_EQ(pacer.fill(std::chrono::milliseconds(ms)), depth);
+      pacer.take(depth);
+      taken += depth;
+      dropped += pacer.dropped();
+    }
+    BOOST_TEST_EQ(pacer.dropped(), 0u);
+    uint64_t const arrived = taken + dropped;
+    BOOST_TEST(arrived > 9900 && arrived < 10100);
+    // An empty bucket does not drop
+    pacer.fill(std::chrono::microseconds(10050));
+    BOOST_TEST_EQ(pacer.dropped(), 0u);
+  }
+
+  // A bucket bounded by the room of the generator adds the arrivals beyond
+  // it later, and cuts the same windows
+  for (ArrivalModel m : models) {
+    uint64_t const window = 16;
+    uint64_t const room = 100;
+    std::chrono::microseconds const flush_time(10);
+    Pacer a(m, frequency, 0, false, flush_time, window);
+    Pacer b(m, frequency, 0, false, flush_time, window);
+    std::chrono::nanoseconds const end = std::chrono::milliseconds(1);
+    uint64_t const arrived = a.fill(end);
+    uint64_t taken = 0;
+    for (uint64_t tokens = b.fill(end, room); tokens;
+        tokens = b.fill(end, room)) {
+      BOOST_TEST(tokens <= room);
+      b.take(tokens);
+      taken += tokens;
+    }
+    BOOST_TEST_EQ(taken, arrived);
+    for (uint64_t first = 0; first + window <= arrived;) {
+      uint64_t const a_end = a.window_end(first);
+      BOOST_TEST_EQ(a_end, b.window_end(first));
+      first = a_end;
+    }
+  }
+
+  // The same seed gives the same schedule, whatever the steps it is read at
+  for (ArrivalModel m : models) {
+    Pacer a = make_pacer(m, frequency, 0);
+    Pacer b = make_pacer(m, frequency, 0);
+    Pacer c = make_pacer(m, frequency, 0);
+    std::chrono::nanoseconds const end = std::chrono::milliseconds(10);
+    std::vector<uint64_t> const fine = run(a, std::chrono::microseconds(1), end);
+    BOOST_TEST(fine == run(b, std::chrono::microseconds(1), end));
+    std::vector<uint64_t> const coarse = run(
+      c,
+      std::chrono::microseconds(1000),
+      end);
+    for (size_t i = 0; i < coarse.size(); ++i) {
+      uint64_t fine_sum = 0;
+      for (size_t j = i * 1000; j < (i + 1) * 1000; ++j) {
+        fine_sum += fine[j];
+      }
+      BOOST_TEST_EQ(coarse[i], fine_sum);
+    }
+  }
+
+  // Pacers read at different phases of the clock cut the same windows once
+  // they reach the same time: the events of a multievent, or fewer when the
+  // flush time has passed since their first arrival. The evenly spaced
+  // arrivals fill only 11 of the 16 events in the flush time.
+  for (ArrivalModel m : models) {
+    uint64_t const window = 16;
+    std::chrono::microseconds const flush_time(10);
+    Pacer a(m, frequency, 0, false, flush_time, window);
+    Pacer b(m, frequency, 0, false, flush_time, window);
+    std::chrono::nanoseconds const end = std::chrono::milliseconds(10);
+    uint64_t arrived = sum(run(a, std::chrono::microseconds(7), end));
+    arrived += a.fill(end);
+    a.take(a.fill(end));
+    run(b, std::chrono::microseconds(3), end, std::chrono::nanoseconds(500));
+    b.take(b.fill(end));
+    BOOST_TEST(arrived > 9900 && arrived < 10100);
+
+    int full = 0;
+    int flushed = 0;
+    uint64_t first = 0;
+    while (first + window <= arrived) {
+      uint64_t const a_end = a.window_end(first);
+      BOOST_TEST_EQ(a_end, b.window_end(first));
+      BOOST_TEST(a_end > first && a_end <= first + window);
+      ++(a_end == first + window ? full : flushed);
+      first = a_end;
+    }
+    BOOST_TEST(flushed > 0);
+    BOOST_TEST_EQ(full > 0, m != ArrivalModel::CONSTANT);
+  }
+
+  // A wait shorter than the sleeps of the kernel ends with the next arrival:
+  // at 1 MHz, taking the tokens two thousand times lasts far less than a
+  // sleep every other time
+  for (ArrivalModel m : models) {
+    Pacer pacer = make_pacer(m, frequency, 0);
+    auto const start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 2000; ++i) {
+      pacer.take(pacer.fill());
+    }
+    BOOST_TEST(
+      std::chrono::steady_clock::now() - start < std::chrono::milliseconds(25));
+  }
+
+  return boost::report_errors();
+}
@@ -0,0 +1,106 @@
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <cstdint>
+#include <cstring>
+
+#include <boost/detail/lightweight_test.hpp>
+
+#include "transport/transport.h"
+
+using namespace lseb;
+
+// More sources than the shared receive buffers can hold, each of them with
+// all its messages already sent. The receiver keeps the messages delivered,
+// as a Builder Unit waiting for the fragments of the other sources: each
+// source must get its share of the buffers, whatever the order in which
+// they are polled.
+
+static int const sources = 3;
+static int const pool = 6;
+static int const credits = 8;
+static size_t const length = 1000;
+
+static unsigned char content(int source, int message, size_t offset) {
+  return (source * 31 + message * 131 + offset * 7) & 0xff;
+}
+
+int main() {
+
+  Acceptor acceptor(credits);
+  acceptor.share_receive_queue(pool);
+  acceptor.listen("127.0.0.1", "7392");
+
+  std::vector<std::unique_ptr<Socket> > senders;
+  std::vector<std::unique_ptr<Socket> > receivers;
+  for (int s = 0; s < sources; ++s) {
+    std::thread accept_th([&]() {receivers.push_back(acceptor.accept());});
+    Connector connector(credits);
+    senders.push_back(connector.connect("127.0.0.1", "7392"));
+    accept_th.join();
+  }
+
+  std::vector<unsigned char> buffers(pool * length);
+  for (int b = 0; b < pool; ++b) {
+    receivers.front()->post_recv({ &buffers[b * length], length });
+  }
+
+  std::vector<std::vector<unsigned char> > messages(
+    sources * credits,
+    std::vector<unsigned char>(length));
+  for (int s = 0; s < sources; ++s) {
+    for (int m = 0; m < credits; ++m) {
+      std::vector<unsigned char>& message = messages[s * credits + m];
+      for (size_t i = 0; i < length; ++i) {
+        message[i] = content(s, m, i);
+      }
+      senders[s]->post_send({ message.data(), length });
+    }
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // Each source delivers its share of the buffers, and no more until they
+  // are posted again
+  std::vector<std::vector<iovec> > held(sources);
+  std::vector<int> received(sources, 0);
+  for (int round = 0; round < 100; ++round) {
+    for (int s = 0; s < sources; ++s) {
+      for (auto const& iov : receivers[s]->poll_completed_recv()) {
+        held[s].push_back(iov);
+      }
+    }
+  }
+  for (int s = 0; s < sources; ++s) {
+    BOOST_TEST_EQ(held[s].size(), size_t(pool / sources));
+  }
+
+  // Giving the buffers back, all the messages arrive in order
+  auto const end = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  bool done = false;
+  while (!done && std::chrono::steady_clock::now() < end) {
+    done = true;
+    for (int s = 0; s < sources; ++s) {
+      for (auto const& iov : held[s]) {
+        BOOST_TEST_EQ(iov.iov_len, length);
+        size_t wrong = 0;
+        for (size_t i = 0; i < iov.iov_len; ++i) {
+          wrong += static_cast<unsigned char*>(iov.iov_base)[i]
+            != content(s, received[s], i);
+        }
+        BOOST_TEST_EQ(wrong, 0u);
+        ++received[s];
+        receivers[s]->post_recv({ iov.iov_base, length });
+      }
+      held[s] = receivers[s]->poll_completed_recv();
+      senders[s]->poll_completed_send();
+      done = done && received[s] == credits;
+    }
+  }
+  for (int s = 0; s < sources; ++s) {
+    BOOST_TEST_EQ(received[s], credits);
+  }
+
+  return boost::report_errors();
+}
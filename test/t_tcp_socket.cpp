@@ -0,0 +1,169 @@
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <cstdint>
+#include <cstring>
+
+#include <boost/detail/lightweight_test.hpp>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "transport/transport.h"
+
+using namespace lseb;
+
+// Messages of varied lengths sent on a loopback connection whose socket
+// buffers are small, so that the writes and the reads are short and the
+// headers are split across reads. Half of them are gathered from two
+// segments, as a multievent that wraps around the end of the data ring.
+
+static size_t const lengths[] = { 1, 7, 8, 9, 100, 4095, 4096, 65537, 0,
+  300000, 24, 123457 };
+static size_t const n_lengths = sizeof(lengths) / sizeof(lengths[0]);
+static size_t const max_length = 300000;
+static int const credits = 4;
+static int const messages = 240;
+
+static unsigned char content(int message, size_t offset) {
+  return (message * 131 + offset * 7 + offset / 251) & 0xff;
+}
+
+static void shrink_buffer(Socket& socket, int option) {
+  int const size = 16384;
+  for (int fd : socket.wait_fds()) {
+    setsockopt(fd, SOL_SOCKET, option, &size, sizeof(size));
+  }
+}
+
+int main() {
+
+  Acceptor acceptor(credits);
+  acceptor.listen("127.0.0.1", "7390");
+  std::unique_ptr<Socket> receiver;
+  std::thread accept_th([&]() {receiver = acceptor.accept();});
+  Connector connector(credits);
+  std::unique_ptr<Socket> sender = connector.connect("127.0.0.1", "7390");
+  accept_th.join();
+
+  shrink_buffer(*sender, SO_SNDBUF);
+  shrink_buffer(*receiver, SO_RCVBUF);
+
+  // A send buffer and a receive buffer for each credit. The two segments of
+  // a gathered message are stored apart, in reverse order.
+  std::vector<std::vector<unsigned char> > send_buffers(
+    credits,
+    std::vector<unsigned char>(max_length + 64));
+  std::vector<std::vector<unsigned char> > recv_buffers(
+    credits,
+    std::vector<unsigned char>(max_length));
+  for (auto& buffer : recv_buffers) {
+    receiver->post_recv({buffer.data(), buffer.size()});
+  }
+
+  int sent = 0;
+  int send_completed = 0;
+  int received = 0;
+  while (received < messages) {
+    if (sent < messages && sender->available_send()) {
+      size_t const length = lengths[sent % n_lengths];
+      unsigned char* const buffer = send_buffers[sent % credits].data();
+      if (sent % 2 && length > 1) {
+        size_t const head = length / 3;
+        unsigned char* const second = buffer;
+        unsigned char* const first = buffer + (length - head) + 64;
+        for (size_t i = 0; i < length; ++i) {
+          (i < head ? first[i] : second[i - head]) = content(sent, i);
+        }
+        iovec const iov[2] = { { first, head }, { second, length - head } };
+        sender->post_sendv(iov, 2);
+      } else {
+        for (size_t i = 0; i < length; ++i) {
+          buffer[i] = content(sent, i);
+        }
+        sender->post_send(iovec { buffer, length });
+      }
+      ++sent;
+    }
+
+    for (auto const& iov : sender->poll_completed_send()) {
+      BOOST_TEST_EQ(iov.iov_len, lengths[send_completed % n_lengths]);
+      ++send_completed;
+    }
+
+    for (auto const& iov : receiver->poll_completed_recv()) {
+      size_t const length = lengths[received % n_lengths];
+      BOOST_TEST_EQ(iov.iov_len, length);
+      unsigned char const* const data =
+        static_cast<unsigned char const*>(iov.iov_base);
+      size_t wrong = 0;
+      for (size_t i = 0; i < iov.iov_len && i < length; ++i) {
+        wrong += data[i] != content(received, i);
+      }
+      BOOST_TEST_EQ(wrong, 0u);
+      receiver->post_recv({iov.iov_base, max_length});
+      ++received;
+    }
+  }
+
+  while (send_completed < messages) {
+    send_completed += sender->poll_completed_send().size();
+  }
+
+  // Messages framed by hand and written a few bytes at a time on a plain
+  // socket, so that the receiver reads each header in several pieces
+  Acceptor raw_acceptor(credits);
+  raw_acceptor.listen("127.0.0.1", "7391");
+  int const fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in address;
+  std::memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons(7391);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  BOOST_TEST_EQ(connect(fd, (sockaddr*) &address, sizeof(address)), 0);
+  int const no_delay = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+  std::unique_ptr<Socket> raw_receiver = raw_acceptor.accept();
+  for (auto& buffer : recv_buffers) {
+    raw_receiver->post_recv({buffer.data(), buffer.size()});
+  }
+
+  int const raw_messages = 24;
+  size_t const piece = 3;
+  int raw_received = 0;
+  for (int m = 0; m < raw_messages; ++m) {
+    uint64_t const length = lengths[m % 6];
+    std::vector<unsigned char> bytes(sizeof(length) + length);
+    std::memcpy(bytes.data(), &length, sizeof(length));
+    for (size_t i = 0; i < length; ++i) {
+      bytes[sizeof(length) + i] = content(m, i);
+    }
+    for (size_t offset = 0; offset < bytes.size(); offset += piece) {
+      size_t const n = std::min(piece, bytes.size() - offset);
+      BOOST_TEST_EQ(write(fd, bytes.data() + offset, n), ssize_t(n));
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+      for (auto const& iov : raw_receiver->poll_completed_recv()) {
+        BOOST_TEST_EQ(iov.iov_len, lengths[raw_received % 6]);
+        unsigned char const* const data =
+          static_cast<unsigned char const*>(iov.iov_base);
+        size_t wrong = 0;
+        for (size_t i = 0; i < iov.iov_len; ++i) {
+          wrong += data[i] != content(raw_received, i);
+        }
+        BOOST_TEST_EQ(wrong, 0u);
+        raw_receiver->post_recv({iov.iov_base, max_length});
+        ++raw_received;
+      }
+    }
+  }
+  BOOST_TEST_EQ(raw_received, raw_messages);
+  close(fd);
+
+  return boost::report_errors();
+}
@@ -0,0 +1,85 @@
+#include <vector>
+
+#include <cstdint>
+
+#include <boost/detail/lightweight_test.hpp>
+
+#include "transport/write_ring.h"
+
+using namespace lseb;
+
+// Messages written into a ring of four buffers and released by the receiver,
+// which must give back exactly the oldest one
+
+static size_t const chunk = 100;
+static int const buffers = 4;
+
+static bool release_throws(RingReceiver& receiver, iovec const& iov) {
+  try {
+    receiver.release(iov);
+  } catch (exception::socket::generic_error const&) {
+    return true;
+  }
+  return false;
+}
+
+int main() {
+
+  std::vector<unsigned char> memory(chunk * buffers);
+  std::vector<iovec> iov;
+  for (int b = 0; b < buffers; ++b) {
+    iov.push_back({ &memory[b * chunk], chunk });
+  }
+  RingReceiver receiver;
+  receiver.create(iov.data(), iov.size(), buffers * 2);
+
+  RingWriter writer;
+  writer.update(receiver.update());
+
+  // Messages that fill the ring up to near its end
+  std::vector<iovec> received;
+  auto const write = [&](uint64_t len) {
+    uint32_t immediate = 0;
+    uint64_t const addr = writer.place(len, immediate);
+    iovec const message = receiver.receive(immediate);
+    BOOST_TEST_EQ(message.iov_len, len);
+    BOOST_TEST_EQ(addr, uint64_t(
+      static_cast<unsigned char*>(message.iov_base) - memory.data()));
+    received.push_back(message);
+  };
+  for (uint64_t len : { 60u, 90u, 100u, 80u }) {
+    write(len);
+  }
+  BOOST_TEST(!writer.available());
+
+  // The first two given back, with the length of a buffer: the next message
+  // is placed again at the beginning of the ring
+  receiver.release({ received[0].iov_base, chunk });
+  receiver.release({ received[1].iov_base, chunk });
+  BOOST_TEST_EQ(receiver.update().consumed_bytes, 150u);
+  writer.update(receiver.update());
+  write(80);
+  BOOST_TEST(received.back().iov_base == memory.data());
+  BOOST_TEST_EQ(receiver.held(), 3u);
+
+  // Any buffer but the oldest one is refused: a later one, one placed before
+  // it in the ring, or one inside it
+  BOOST_TEST(release_throws(receiver, received[3]));
+  BOOST_TEST(release_throws(receiver, received[4]));
+  BOOST_TEST(release_throws(
+    receiver,
+    { static_cast<unsigned char*>(received[2].iov_base) + 1, chunk }));
+  BOOST_TEST(release_throws(receiver, received[1]));
+  BOOST_TEST_EQ(receiver.held(), 3u);
+  BOOST_TEST_EQ(receiver.update().consumed_bytes, 150u);
+
+  // The others in order, the last one past the skipped end of the ring
+  for (size_t i = 2; i < received.size(); ++i) {
+    receiver.release({ received[i].iov_base, chunk });
+  }
+  BOOST_TEST_EQ(receiver.held(), 0u);
+  BOOST_TEST_EQ(receiver.update().consumed_bytes, 480u);
+  BOOST_TEST(release_throws(receiver, received[0]));
+
+  return boost::report_errors();
+}
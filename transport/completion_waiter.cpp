@@ -0,0 +1,146 @@
+#include "transport/completion_waiter.h"
+
+#include <string>
+
+#include <cerrno>
+#include <cstring>
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "common/exception.h"
+
+namespace lseb {
+
+Doorbell::Doorbell()
+    : m_armed(false) {
+  m_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (m_fd == -1) {
+    throw exception::connection::generic_error(
+        "Error on eventfd: " + std::string(strerror(errno)));
+  }
+}
+
+Doorbell::~Doorbell() {
+  close(m_fd);
+}
+
+int Doorbell::fd() const {
+  return m_fd;
+}
+
+void Doorbell::arm() {
+  // Ordered before the last poll of the queue, as the ring after the push
+  m_armed.store(true);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+void Doorbell::ring() {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (m_armed.load(std::memory_order_relaxed) && m_armed.exchange(false)) {
+    uint64_t const one = 1;
+    if (write(m_fd, &one, sizeof(one)) == -1 && errno != EAGAIN) {
+      throw exception::connection::generic_error(
+          "Error on write: " + std::string(strerror(errno)));
+    }
+  }
+}
+
+CompletionWaiter::CompletionWaiter(
+    std::chrono::microseconds spin_time,
+    std::chrono::milliseconds timeout)
+    : m_spin_time(spin_time),
+      m_timeout(timeout.count()),
+      m_events(1),
+      m_idle_since(std::chrono::high_resolution_clock::now()),
+      m_armed(false),
+      m_blocks(0) {
+  m_epoll_fd = epoll_create1(0);
+  if (m_epoll_fd == -1) {
+    throw exception::connection::generic_error(
+        "Error on epoll_create1: " + std::string(strerror(errno)));
+  }
+}
+
+CompletionWaiter::~CompletionWaiter() {
+  close(m_epoll_fd);
+}
+
+void CompletionWaiter::add(Connection& connection) {
+  m_connections.push_back(&connection);
+  for (int fd : connection.wait_fds()) {
+    // Edge-triggered, so that a socket which stays writable does not wake
+    // the loop up again
+    epoll_event event;
+    event.events = EPOLLIN | EPOLLOUT | EPOLLET;
+    event.data.fd = fd;
+    // The connections sharing a completion queue share its descriptor
+    if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1
+        && errno != EEXIST) {
+      throw exception::connection::generic_error(
+          "Error on epoll_ctl: " + std::string(strerror(errno)));
+    }
+    m_events.resize(m_events.size() + 1);
+  }
+}
+
+void CompletionWaiter::add(Doorbell& doorbell) {
+  m_doorbells.push_back(&doorbell);
+  epoll_event event;
+  event.events = EPOLLIN | EPOLLET;
+  event.data.fd = doorbell.fd();
+  if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, doorbell.fd(), &event) == -1) {
+    throw exception::connection::generic_error(
+        "Error on epoll_ctl: " + std::string(strerror(errno)));
+  }
+  m_events.resize(m_events.size() + 1);
+}
+
+void CompletionWaiter::progress(bool active) {
+  auto const now = std::chrono::high_resolution_clock::now();
+  if (active) {
+    m_armed = false;
+    m_idle_since = now;
+    return;
+  }
+
+  if (!m_armed) {
+    if (now - m_idle_since < m_spin_time) {
+      return;
+    }
+    // The completions arrived before arming are not notified: the loop polls
+    // once more before blocking
+    m_armed = true;
+    for (auto doorbell : m_doorbells) {
+      doorbell->arm();
+    }
+    for (auto connection : m_connections) {
+      m_armed = connection->arm_wait() && m_armed;
+    }
+    if (!m_armed) {
+      m_idle_since = now;
+    }
+    return;
+  }
+
+  int ret = epoll_wait(
+      m_epoll_fd,
+      m_events.data(),
+      m_events.size(),
+      m_timeout);
+  if (ret == -1 && errno != EINTR) {
+    throw exception::connection::generic_error(
+        "Error on epoll_wait: " + std::string(strerror(errno)));
+  }
+  ++m_blocks;
+  m_armed = false;
+  m_idle_since = std::chrono::high_resolution_clock::now();
+}
+
+uint64_t CompletionWaiter::blocks() {
+  uint64_t const blocks = m_blocks;
+  m_blocks = 0;
+  return blocks;
+}
+
+}
@@ -0,0 +1,71 @@
+#ifndef TRANSPORT_COMPLETION_WAITER_H
+#define TRANSPORT_COMPLETION_WAITER_H
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+#include <sys/epoll.h>
+
+#include "transport/connection.h"
+
+namespace lseb {
+
+// Wakeup of a loop waiting with a CompletionWaiter by another thread, which
+// rings it after handing it some work through a queue. It costs a system
+// call only once the waiting loop has armed it, before its last poll.
+
+class Doorbell {
+  int m_fd;
+  std::atomic<bool> m_armed;
+
+ public:
+  Doorbell();
+  Doorbell(Doorbell const& other) = delete;  // non construction-copyable
+  Doorbell& operator=(Doorbell const&) = delete;  // non copyable
+  ~Doorbell();
+
+  int fd() const;
+  void arm();
+  void ring();
+};
+
+// Adaptive waiting of a polling loop: the loop keeps polling for spin_time
+// after its last activity, then it arms the connections and the doorbells,
+// polls them once more and blocks on all their descriptors together. The
+// connections that cannot be waited for, and the other sources of data, are
+// polled again at least every timeout.
+
+class CompletionWaiter {
+  std::chrono::microseconds m_spin_time;
+  int m_timeout;  // ms
+  int m_epoll_fd;
+  std::vector<Connection*> m_connections;
+  std::vector<Doorbell*> m_doorbells;
+  std::vector<epoll_event> m_events;  // one more than the descriptors
+  std::chrono::high_resolution_clock::time_point m_idle_since;
+  bool m_armed;
+  uint64_t m_blocks;
+
+ public:
+  CompletionWaiter(
+      std::chrono::microseconds spin_time,
+      std::chrono::milliseconds timeout = std::chrono::milliseconds(1));
+  CompletionWaiter(CompletionWaiter const& other) = delete;  // non construction-copyable
+  CompletionWaiter& operator=(CompletionWaiter const&) = delete;  // non copyable
+  ~CompletionWaiter();
+
+  void add(Connection& connection);
+  void add(Doorbell& doorbell);
+
+  // To be called at the end of each iteration of the loop, which has found
+  // something to do or not. It blocks only after an idle spin_time.
+  void progress(bool active);
+
+  // Return the number of times that the loop has blocked, and reset it
+  uint64_t blocks();
+};
+
+}
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef TRANSPORT_CONNECTION_H
+#define TRANSPORT_CONNECTION_H
+
+#include <vector>
+#include <string>
+
+#include <sys/uio.h>
+
+namespace lseb {
+
+// Segments that a single message sent with post_sendv can be gathered from
+static const size_t MAX_SEND_SGE = 2;
+
+// Interface shared by the network Socket of the selected transport layer and
+// by the intra-node transports, so that each peer can use a different one
+
+class Connection {
+ public:
+  virtual ~Connection() = default;
+
+  virtual void register_memory(void* buffer, size_t size) = 0;
+
+  // Store at most n completed work requests in iov and return their number.
+  // They do not allocate memory, so they can be used in the polling loops.
+  virtual size_t poll_completed_send(iovec* iov, size_t n) = 0;
+  virtual size_t poll_completed_recv(iovec* iov, size_t n) = 0;
+
+  // Return all the completed work requests
+  std::vector<iovec> poll_completed_send();
+  std::vector<iovec> poll_completed_recv();
+
+  virtual void post_send(iovec const& iov) = 0;
+  virtual void post_recv(iovec const& iov) = 0;
+
+  // Post n work requests at once, so that the transport can hand them over
+  // together. The default implementation posts them one by one.
+  virtual void post_send(iovec const* iov, size_t n);
+  virtual void post_recv(iovec const* iov, size_t n);
+
+  // Post a single message gathered from n segments, at most MAX_SEND_SGE,
+  // e.g. the two parts of a multievent that wraps around the end of the data
+  // ring. Its completion is reported as the first segment, with the length
+  // of the whole message.
+  virtual void post_sendv(iovec const* iov, size_t n) = 0;
+
+  virtual bool available_send() = 0;
+  virtual bool available_recv() = 0;
+
+  virtual std::vector<iovec> pending_send() = 0;
+  virtual std::vector<iovec> pending_recv() = 0;
+
+  virtual std::string peer_hostname() = 0;
+
+  // Store in iov the segments of a message completed by poll_completed_recv
+  // and return their number. A transport that delivers the segments of
+  // post_sendv in place reports the message as its first segment with the
+  // length of the whole message; the others deliver it contiguous, as a
+  // single segment.
+  virtual size_t received_segments(iovec const& message, iovec* iov);
+
+  // Waiting for completions instead of polling for them. The descriptors
+  // become readable when completions may be available, once the connection
+  // has been armed: arm_wait returns false if some are available already, so
+  // that they must be polled before blocking. A connection without
+  // descriptors cannot be waited for, it must be polled.
+  virtual std::vector<int> wait_fds();
+  virtual bool arm_wait();
+};
+
+namespace detail {
+template<typename F>
+std::vector<iovec> poll_all(F poll) {
+  static size_t const batch = 64;
+  std::vector<iovec> iov_vect;
+  iovec iov[batch];
+  size_t n;
+  do {
+    n = poll(iov, batch);
+    iov_vect.insert(std::end(iov_vect), iov, iov + n);
+  } while (n == batch);
+  return iov_vect;
+}
+}
+
+inline void Connection::post_send(iovec const* iov, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    post_send(iov[i]);
+  }
+}
+
+inline void Connection::post_recv(iovec const* iov, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    post_recv(iov[i]);
+  }
+}
+
+inline std::vector<int> Connection::wait_fds() {
+  return {};
+}
+
+inline bool Connection::arm_wait() {
+  return true;
+}
+
+inline size_t Connection::received_segments(
+    iovec const& message,
+    iovec* iov) {
+  iov[0] = message;
+  return 1;
+}
+
+inline std::vector<iovec> Connection::poll_completed_send() {
+  return detail::poll_all([this](iovec* iov, size_t n) {
+    return poll_completed_send(iov, n);
+  });
+}
+
+inline std::vector<iovec> Connection::poll_completed_recv() {
+  return detail::poll_all([this](iovec* iov, size_t n) {
+    return poll_completed_recv(iov, n);
+  });
+}
+
+}
+
+#endif
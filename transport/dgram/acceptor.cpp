@@ -0,0 +1,54 @@
+#include "transport/dgram/acceptor.h"
+
+#include <thread>
+
+#include "common/exception.h"
+
+namespace lseb {
+
+namespace dgram {
+
+Acceptor::Acceptor(int credits, size_t size)
+    : m_credits(credits),
+      m_size(size),
+      m_wait(false) {
+}
+
+void Acceptor::enable_wait() {
+  m_wait = true;
+}
+
+void Acceptor::listen(std::string const& hostname, std::string const& port) {
+  try {
+    m_channel = std::make_shared<Channel>(
+        hostname.c_str(),
+        port.c_str(),
+        m_size,
+        m_wait);
+  } catch (std::exception& e) {
+    throw exception::acceptor::generic_error(e.what());
+  }
+}
+
+std::unique_ptr<Socket> Acceptor::accept() {
+  // The source is welcomed once its socket receives its fragments
+  uint32_t source;
+  try {
+    while (!m_channel->introduced(source)) {
+      if (!m_channel->progress()) {
+        std::this_thread::yield();
+      }
+    }
+    return std::unique_ptr<Socket>(new Socket(m_channel, source, m_credits));
+  } catch (std::exception& e) {
+    throw exception::acceptor::generic_error(e.what());
+  }
+}
+
+Statistics Acceptor::statistics() {
+  return m_channel ? m_channel->statistics() : Statistics();
+}
+
+}
+
+}
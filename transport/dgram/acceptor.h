@@ -0,0 +1,40 @@
+#ifndef TRANSPORT_DGRAM_ACCEPTOR_H
+#define TRANSPORT_DGRAM_ACCEPTOR_H
+
+#include <memory>
+#include <string>
+
+#include "transport/dgram/socket.h"
+
+namespace lseb {
+
+namespace dgram {
+
+class Acceptor {
+
+  uint32_t m_credits;
+  size_t m_size;
+  bool m_wait;
+  std::shared_ptr<Channel> m_channel;
+
+ public:
+
+  // The multievents are received in datagrams up to size bytes
+  Acceptor(int credits, size_t size);
+  Acceptor(Acceptor const& other) = delete;  // non construction-copyable
+  Acceptor& operator=(Acceptor const&) = delete;  // non copyable
+  // The sockets accepted afterwards can be waited for, see
+  // Connection::wait_fds. It must be called before listen.
+  void enable_wait();
+  void listen(std::string const& hostname, std::string const& port);
+  std::unique_ptr<Socket> accept();
+
+  // Losses of all the accepted sockets since the last call
+  Statistics statistics();
+};
+
+}
+
+}
+
+#endif
@@ -0,0 +1,72 @@
+#include "transport/dgram/connector.h"
+
+#include <chrono>
+#include <thread>
+
+#include "common/exception.h"
+
+namespace lseb {
+
+namespace dgram {
+
+Connector::Connector(
+    int credits,
+    int source,
+    std::string const& hostname,
+    size_t size)
+    : m_credits(credits),
+      m_source(source),
+      m_hostname(hostname),
+      m_size(size),
+      m_wait(false) {
+}
+
+void Connector::enable_wait() {
+  m_wait = true;
+}
+
+std::unique_ptr<Socket> Connector::connect(
+    std::string const& hostname,
+    std::string const& port) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  try {
+    if (!m_channel) {
+      m_channel = std::make_shared<Channel>(
+          m_hostname.c_str(),
+          nullptr,
+          m_size,
+          m_wait);
+    }
+    std::string const address = hostname + ":" + port;
+    auto it = m_peers.find(address);
+    if (it == std::end(m_peers)) {
+      it = m_peers.emplace(
+          address,
+          m_channel->endpoint().resolve(hostname, port)).first;
+    }
+    Endpoint::Peer const peer = it->second;
+
+    m_channel->hello(peer, m_source);
+    auto const deadline = std::chrono::steady_clock::now()
+        + std::chrono::milliseconds(WELCOME_TIMEOUT_MS);
+    while (!m_channel->welcomed(peer)) {
+      if (std::chrono::steady_clock::now() > deadline) {
+        throw exception::connector::generic_error(
+            "Error on connect: introduction not answered");
+      }
+      if (!m_channel->progress()) {
+        std::this_thread::yield();
+      }
+    }
+    return std::unique_ptr<Socket>(
+        new Socket(m_channel, peer, m_source, m_credits));
+  } catch (exception::connector::generic_error&) {
+    throw;
+  } catch (std::exception& e) {
+    throw exception::connector::generic_error(e.what());
+  }
+}
+
+}
+
+}
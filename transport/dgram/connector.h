@@ -0,0 +1,50 @@
+#ifndef TRANSPORT_DGRAM_CONNECTOR_H
+#define TRANSPORT_DGRAM_CONNECTOR_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "transport/dgram/socket.h"
+
+namespace lseb {
+
+namespace dgram {
+
+class Connector {
+
+  uint32_t m_credits;
+  uint32_t m_source;
+  std::string m_hostname;
+  size_t m_size;
+  bool m_wait;
+  std::shared_ptr<Channel> m_channel;
+
+  // Peers resolved by hostname and port, so that an introduction sent again
+  // is answered to the same one
+  std::map<std::string, Endpoint::Peer> m_peers;
+  std::mutex m_mutex;
+
+ public:
+
+  // The multievents are sent in datagrams up to size bytes, from an endpoint
+  // bound to hostname, and introduced as coming from source
+  Connector(int credits, int source, std::string const& hostname, size_t size);
+  Connector(Connector const& other) = delete;  // non construction-copyable
+  Connector& operator=(Connector const&) = delete;  // non copyable
+  // The sockets connected afterwards can be waited for, see
+  // Connection::wait_fds. It must be called before connect.
+  void enable_wait();
+  // It can be called by several threads at the same time. It fails if the
+  // introduction is not answered within WELCOME_TIMEOUT_MS.
+  std::unique_ptr<Socket> connect(
+      std::string const& hostname,
+      std::string const& port);
+};
+
+}
+
+}
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef TRANSPORT_DGRAM_ENDPOINT_H
+#define TRANSPORT_DGRAM_ENDPOINT_H
+
+// Datagram endpoint of the selected transport layer: libfabric has its own,
+// the others use kernel UDP sockets
+#if defined(FI_VERBS) || defined(FI_TCP)
+#include "transport/libfabric/dgram_endpoint.h"
+#else
+#include "transport/dgram/udp_endpoint.h"
+#endif
+
+#endif
@@ -0,0 +1,460 @@
+#include "transport/dgram/socket.h"
+
+#include <algorithm>
+
+#include <cassert>
+#include <cstring>
+
+#include "common/exception.h"
+
+namespace lseb {
+
+namespace dgram {
+
+Channel::Channel(char const* hostname, char const* port, size_t size, bool wait)
+    : m_endpoint(hostname, port, size, DEPTH, wait),
+      m_size(size),
+      m_buffers(size * DEPTH),
+      m_name(m_endpoint.name()),
+      m_statistics(),
+      m_received(DEPTH),
+      m_sent(DEPTH) {
+  for (uint32_t i = 0; i < DEPTH; ++i) {
+    m_endpoint.post_recv(m_buffers.data() + i * m_size);
+  }
+}
+
+Endpoint& Channel::endpoint() {
+  return m_endpoint;
+}
+
+size_t Channel::payload() const {
+  return m_size - sizeof(Header);
+}
+
+bool Channel::progress() {
+  size_t const received = m_endpoint.poll_recv(
+      m_received.data(),
+      m_received.size());
+  for (size_t i = 0; i < received; ++i) {
+    receive(m_received[i].iov_base, m_received[i].iov_len);
+    m_endpoint.post_recv(m_received[i].iov_base);
+  }
+
+  // The introductions and their answers are sent without context
+  size_t const sent = m_endpoint.poll_sent(m_sent.data(), m_sent.size());
+  for (size_t i = 0; i < sent; ++i) {
+    if (m_sent[i]) {
+      ++static_cast<Socket*>(m_sent[i])->m_datagrams_done;
+    }
+  }
+  return received || sent;
+}
+
+void Channel::receive(void* buffer, size_t size) {
+  if (size < sizeof(Header)) {
+    ++m_statistics.dropped_fragments;
+    return;
+  }
+  Header header;
+  std::memcpy(&header, buffer, sizeof(header));
+  unsigned char const* payload = static_cast<unsigned char*>(buffer)
+      + sizeof(Header);
+  size -= sizeof(Header);
+
+  if (header.type == Header::FRAGMENT) {
+    auto it = m_sources.find(header.source);
+    if (it == std::end(m_sources) || !it->second.socket) {
+      ++m_statistics.dropped_fragments;
+      return;
+    }
+    it->second.socket->receive(header, payload, size);
+  } else if (header.type == Header::HELLO && header.length <= size) {
+    // The introduction is sent again until it is answered
+    auto it = m_sources.find(header.source);
+    if (it == std::end(m_sources)) {
+      Source& source = m_sources[header.source];
+      source.peer = m_endpoint.insert(payload, header.length);
+      std::memset(&source.welcome, 0, sizeof(Header));
+      source.welcome.type = Header::WELCOME;
+      source.welcome.sequence = header.sequence;
+      source.socket = nullptr;
+      m_introduced.push_back(header.source);
+    } else if (it->second.socket) {
+      welcome(it->second);
+    }
+  } else if (header.type == Header::WELCOME) {
+    m_welcomed.insert(header.sequence);
+  } else {
+    ++m_statistics.dropped_fragments;
+  }
+}
+
+void Channel::welcome(Source& source) {
+  // If it cannot be sent now, it is sent with the next introduction
+  iovec iov = { &source.welcome, sizeof(Header) };
+  m_endpoint.send(source.peer, &iov, 1, nullptr);
+}
+
+bool Channel::introduced(uint32_t& source) {
+  if (m_introduced.empty()) {
+    return false;
+  }
+  source = m_introduced.front();
+  m_introduced.erase(std::begin(m_introduced));
+  return true;
+}
+
+void Channel::attach(uint32_t source, Socket* socket) {
+  Source& s = m_sources.at(source);
+  s.socket = socket;
+  welcome(s);
+}
+
+void Channel::detach(uint32_t source) {
+  m_sources.at(source).socket = nullptr;
+}
+
+std::string Channel::hostname(uint32_t source) const {
+  return m_endpoint.hostname(m_sources.at(source).peer);
+}
+
+void Channel::hello(Endpoint::Peer peer, uint32_t source) {
+  std::memset(&m_hello, 0, sizeof(Header));
+  m_hello.type = Header::HELLO;
+  m_hello.source = source;
+  m_hello.sequence = peer;
+  m_hello.length = m_name.size();
+  iovec iov[2] = { { &m_hello, sizeof(Header) }, { m_name.data(), m_name
+      .size() } };
+  // If it cannot be sent now, it is sent again after the timeout
+  m_endpoint.send(peer, iov, 2, nullptr);
+}
+
+bool Channel::welcomed(Endpoint::Peer peer) const {
+  return m_welcomed.count(peer);
+}
+
+Statistics Channel::statistics() {
+  Statistics statistics = m_statistics;
+  m_statistics = Statistics();
+  return statistics;
+}
+
+Socket::Socket(
+    std::shared_ptr<Channel> const& channel,
+    uint32_t source,
+    uint32_t credits)
+    : m_channel(channel),
+      m_credits(credits),
+      m_sender(false),
+      m_peer(),
+      m_source(source),
+      m_window(std::min<uint64_t>(REORDER_WINDOW, credits)),
+      m_send_head(0),
+      m_send_next(0),
+      m_send_tail(0),
+      m_send_offset(0),
+      m_sequence(0),
+      m_datagrams_sent(0),
+      m_datagrams_done(0),
+      m_free(credits),
+      m_free_head(0),
+      m_free_tail(0),
+      m_assembly(credits),
+      m_next(0),
+      m_assembly_end(0),
+      m_done(credits),
+      m_done_head(0),
+      m_done_tail(0) {
+  m_channel->attach(m_source, this);
+}
+
+Socket::Socket(
+    std::shared_ptr<Channel> const& channel,
+    Endpoint::Peer peer,
+    uint32_t source,
+    uint32_t credits)
+    : m_channel(channel),
+      m_credits(credits),
+      m_sender(true),
+      m_peer(peer),
+      m_source(source),
+      m_window(std::min<uint64_t>(REORDER_WINDOW, credits)),
+      m_send_slots(credits),
+      m_send_head(0),
+      m_send_next(0),
+      m_send_tail(0),
+      m_send_offset(0),
+      m_sequence(0),
+      m_headers(DEPTH),
+      m_datagrams_sent(0),
+      m_datagrams_done(0),
+      m_free_head(0),
+      m_free_tail(0),
+      m_next(0),
+      m_assembly_end(0),
+      m_done_head(0),
+      m_done_tail(0) {
+}
+
+Socket::~Socket() {
+  if (m_sender) {
+    // The completions of the datagrams in flight refer to this socket
+    try {
+      while (m_datagrams_done != m_datagrams_sent) {
+        m_channel->progress();
+      }
+    } catch (std::exception&) {
+    }
+  } else {
+    m_channel->detach(m_source);
+  }
+}
+
+void Socket::register_memory(void* buffer, size_t size) {
+  // The datagrams are copied in and out of the buffers of the channel
+}
+
+uint32_t Socket::fragments(uint32_t length) const {
+  size_t const payload = m_channel->payload();
+  return std::max<size_t>(1, (length + payload - 1) / payload);
+}
+
+void Socket::progress_send() {
+  size_t const payload = m_channel->payload();
+  while (m_send_next != m_send_head) {
+    SendSlot& slot = m_send_slots[m_send_next % m_credits];
+    do {
+      if (m_datagrams_sent - m_datagrams_done == m_headers.size()) {
+        return;
+      }
+      Header& header = m_headers[m_datagrams_sent % m_headers.size()];
+      header.type = Header::FRAGMENT;
+      header.source = m_source;
+      header.sequence = slot.sequence;
+      header.length = slot.iov.iov_len;
+      header.offset = m_send_offset;
+      size_t const len = std::min(payload, slot.iov.iov_len - m_send_offset);
+
+      // A fragment can straddle two segments of the multievent
+      iovec iov[1 + MAX_SEND_SGE] = { { &header, sizeof(Header) } };
+      size_t n_iov = 1;
+      size_t offset = m_send_offset;
+      size_t remaining = len;
+      for (size_t s = 0; s < slot.n_sge && remaining; ++s) {
+        iovec const& sge = slot.sge[s];
+        if (offset >= sge.iov_len) {
+          offset -= sge.iov_len;
+          continue;
+        }
+        size_t const part = std::min(remaining, sge.iov_len - offset);
+        iov[n_iov++] = { static_cast<unsigned char*>(sge.iov_base) + offset,
+            part };
+        remaining -= part;
+        offset = 0;
+      }
+      if (!m_channel->endpoint().send(m_peer, iov, n_iov, this)) {
+        return;
+      }
+      ++m_datagrams_sent;
+      m_send_offset += len;
+    } while (m_send_offset < slot.iov.iov_len);
+    slot.end = m_datagrams_sent;
+    m_send_offset = 0;
+    ++m_send_next;
+  }
+}
+
+void Socket::receive(
+    Header const& header,
+    unsigned char const* payload,
+    size_t size) {
+  Statistics& statistics = m_channel->m_statistics;
+  uint64_t const sequence = header.sequence;
+  if (sequence < m_next) {
+    ++statistics.late_fragments;
+    return;
+  }
+
+  // The multievents overtaken by too many later ones are lost
+  while (sequence >= m_next + m_window && deliver(true)) {
+  }
+  if (sequence >= m_next + m_window) {
+    ++statistics.dropped_fragments;
+    return;
+  }
+  while (m_assembly_end <= sequence) {
+    if (!assign_buffer()) {
+      ++statistics.dropped_fragments;
+      return;
+    }
+  }
+
+  // A fragment starts at a multiple of the payload and fills it, but for the
+  // last one of the multievent
+  Assembly& a = m_assembly[sequence % m_credits];
+  size_t const payload_size = m_channel->payload();
+  if (header.length > a.buffer.iov_len
+      || header.offset >= std::max<uint32_t>(header.length, 1)
+      || header.offset % payload_size
+      || size != std::min<size_t>(payload_size, header.length - header.offset)
+      || (a.fragments && header.length != a.length)) {
+    ++statistics.dropped_fragments;
+    return;
+  }
+  uint64_t& word = a.arrived[header.offset / payload_size / 64];
+  uint64_t const bit = uint64_t(1) << (header.offset / payload_size % 64);
+  if (word & bit) {
+    ++statistics.duplicate_fragments;
+    return;
+  }
+  word |= bit;
+  a.length = header.length;
+  std::memcpy(
+      static_cast<unsigned char*>(a.buffer.iov_base) + header.offset,
+      payload,
+      size);
+  a.received += size;
+  ++a.fragments;
+
+  while (m_next != m_assembly_end) {
+    Assembly const& first = m_assembly[m_next % m_credits];
+    if (!first.fragments || first.received != first.length) {
+      break;
+    }
+    deliver(false);
+  }
+}
+
+bool Socket::assign_buffer() {
+  if (m_free_tail == m_free_head) {
+    return false;
+  }
+  Assembly& a = m_assembly[m_assembly_end % m_credits];
+  a.buffer = m_free[m_free_tail++ % m_credits];
+  a.length = 0;
+  a.received = 0;
+  a.fragments = 0;
+  a.arrived.assign((fragments(a.buffer.iov_len) + 63) / 64, 0);
+  ++m_assembly_end;
+  return true;
+}
+
+bool Socket::deliver(bool lost) {
+  if (m_next == m_assembly_end && !assign_buffer()) {
+    return false;
+  }
+  Assembly const& a = m_assembly[m_next % m_credits];
+  iovec iov = { a.buffer.iov_base, a.length };
+  if (lost) {
+    Statistics& statistics = m_channel->m_statistics;
+    ++statistics.lost_multievents;
+    if (a.fragments) {
+      statistics.lost_fragments += fragments(a.length) - a.fragments;
+    }
+    iov.iov_len = 0;
+  }
+  m_done[m_done_head++ % m_credits] = iov;
+  ++m_next;
+  return true;
+}
+
+size_t Socket::poll_completed_send(iovec* iov, size_t n) {
+  m_channel->progress();
+  progress_send();
+  size_t count = 0;
+  while (count < n && m_send_tail != m_send_next) {
+    SendSlot const& slot = m_send_slots[m_send_tail % m_credits];
+    if (slot.end > m_datagrams_done) {
+      break;
+    }
+    iov[count++] = slot.iov;
+    ++m_send_tail;
+  }
+  return count;
+}
+
+size_t Socket::poll_completed_recv(iovec* iov, size_t n) {
+  m_channel->progress();
+  size_t count = 0;
+  while (count < n && m_done_tail != m_done_head) {
+    iov[count++] = m_done[m_done_tail++ % m_credits];
+  }
+  return count;
+}
+
+void Socket::post_send(iovec const& iov) {
+  post_sendv(&iov, 1);
+}
+
+void Socket::post_sendv(iovec const* iov, size_t n) {
+  assert(m_sender && available_send() && n && n <= MAX_SEND_SGE);
+  SendSlot& slot = m_send_slots[m_send_head++ % m_credits];
+  slot.iov = { iov[0].iov_base, 0 };
+  for (size_t i = 0; i < n; ++i) {
+    slot.sge[i] = iov[i];
+    slot.iov.iov_len += iov[i].iov_len;
+  }
+  assert(slot.iov.iov_len);
+  slot.n_sge = n;
+  slot.sequence = m_sequence++;
+  slot.end = 0;
+  progress_send();
+}
+
+void Socket::post_recv(iovec const& iov) {
+  assert(!m_sender && available_recv());
+  m_free[m_free_head++ % m_credits] = iov;
+}
+
+bool Socket::available_send() {
+  return m_sender && m_send_head - m_send_tail < m_credits;
+}
+
+bool Socket::available_recv() {
+  // The buffers held by the assembly and the delivered ones are not posted
+  return !m_sender
+      && m_free_head - m_free_tail + m_assembly_end - m_next
+          + m_done_head - m_done_tail < m_credits;
+}
+
+std::vector<iovec> Socket::pending_send() {
+  std::vector<iovec> iov_vect;
+  for (uint64_t i = m_send_tail; i != m_send_head; ++i) {
+    iov_vect.push_back(m_send_slots[i % m_credits].iov);
+  }
+  return iov_vect;
+}
+
+std::vector<iovec> Socket::pending_recv() {
+  std::vector<iovec> iov_vect;
+  for (uint64_t i = m_next; i != m_assembly_end; ++i) {
+    iov_vect.push_back(m_assembly[i % m_credits].buffer);
+  }
+  for (uint64_t i = m_free_tail; i != m_free_head; ++i) {
+    iov_vect.push_back(m_free[i % m_credits]);
+  }
+  return iov_vect;
+}
+
+std::string Socket::peer_hostname() {
+  return m_sender ?
+      m_channel->endpoint().hostname(m_peer) : m_channel->hostname(m_source);
+}
+
+std::vector<int> Socket::wait_fds() {
+  return m_channel->endpoint().wait_fds();
+}
+
+bool Socket::arm_wait() {
+  // The datagrams read now are handed over by the next poll
+  if (m_channel->progress()) {
+    return false;
+  }
+  return m_channel->endpoint().arm_wait();
+}
+
+}
+
+}
@@ -0,0 +1,232 @@
+#ifndef TRANSPORT_DGRAM_SOCKET_H
+#define TRANSPORT_DGRAM_SOCKET_H
+
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+#include <string>
+
+#include <cstdint>
+
+#include <sys/uio.h>
+
+#include "transport/connection.h"
+#include "transport/dgram/endpoint.h"
+
+namespace lseb {
+
+namespace dgram {
+
+// Datagrams in flight in each direction of an endpoint, and receive buffers
+// posted to it
+static const uint32_t DEPTH = 256;
+// Time waited for the answer to an introduction, which is then sent again
+static const int WELCOME_TIMEOUT_MS = 100;
+// Multievents of a source that can overtake an incomplete one before it is
+// given up as lost, at most the credits
+static const uint64_t REORDER_WINDOW = 8;
+
+// Each datagram starts with a header. A multievent is sent as fragments of
+// at most the datagram size, after an introduction of the sender answered
+// by the receiver.
+struct Header {
+  enum : uint32_t {
+    HELLO = 0,  // followed by the address of the sender
+    WELCOME = 1,
+    FRAGMENT = 2
+  };
+  uint32_t type;
+  uint32_t source;  // id of the sending node
+  uint64_t sequence;  // of the multievent, counted by destination
+  uint32_t length;  // of the multievent, or of the address
+  uint32_t offset;  // of the fragment in the multievent
+};
+
+// Losses since the last report, summed over the sources
+struct Statistics {
+  uint64_t lost_multievents;  // delivered empty
+  uint64_t lost_fragments;  // missing from the multievents lost
+  uint64_t late_fragments;  // of multievents already delivered
+  uint64_t duplicate_fragments;  // received more than once
+  uint64_t dropped_fragments;  // without a receive buffer, or malformed
+};
+
+class Socket;
+
+// Endpoint shared by all the sockets of an acceptor or of a connector. It
+// hands the received fragments to the socket of their source, answers the
+// introductions and counts the sends completed by each socket.
+
+class Channel {
+
+  struct Source {
+    Endpoint::Peer peer;
+    Header welcome;
+    Socket* socket;  // null until accepted
+  };
+
+  Endpoint m_endpoint;
+  size_t m_size;
+  std::vector<unsigned char> m_buffers;  // receive buffers of m_size bytes
+
+  // Introduced sources, and the ones waiting to be accepted
+  std::map<uint32_t, Source> m_sources;
+  std::vector<uint32_t> m_introduced;
+
+  // Introductions of the connector, by sequence, and the answered ones
+  Header m_hello;
+  std::vector<unsigned char> m_name;
+  std::set<uint64_t> m_welcomed;
+
+  Statistics m_statistics;
+
+  // Used as temporary buffers for polling the endpoint
+  std::vector<iovec> m_received;
+  std::vector<void*> m_sent;
+
+  friend class Socket;
+
+  void receive(void* buffer, size_t size);
+  void welcome(Source& source);
+
+ public:
+  Channel(char const* hostname, char const* port, size_t size, bool wait);
+  Channel(Channel const& other) = delete;  // non construction-copyable
+  Channel& operator=(Channel const&) = delete;  // non copyable
+
+  Endpoint& endpoint();
+  // Longest fragment of a multievent
+  size_t payload() const;
+
+  // Hand the received datagrams and the completed sends to the sockets,
+  // return whether there were any
+  bool progress();
+
+  // Accepting side: return the id of a source introduced and not yet
+  // accepted, if any, and bind it to its socket
+  bool introduced(uint32_t& source);
+  void attach(uint32_t source, Socket* socket);
+  void detach(uint32_t source);
+  std::string hostname(uint32_t source) const;
+
+  // Connecting side: introduce the endpoint to peer, as source, and check
+  // for the answer
+  void hello(Endpoint::Peer peer, uint32_t source);
+  bool welcomed(Endpoint::Peer peer) const;
+
+  // Return the losses counted since the last call
+  Statistics statistics();
+};
+
+// A datagram socket only sends, to a peer, or only receives, from a source.
+// The sends complete once all the fragments of the multievent have been
+// sent, without acknowledgment. The receiver reassembles the fragments into
+// the posted buffers, each fragment once, and delivers the multievents in
+// order: once a later one is REORDER_WINDOW ahead, a missing one is
+// delivered with a zero length.
+
+class Socket : public Connection {
+
+  struct SendSlot {
+    iovec iov;  // as completed: the first segment, with the whole length
+    iovec sge[MAX_SEND_SGE];
+    size_t n_sge;
+    uint64_t sequence;
+    uint64_t end;  // datagrams sent up to its last fragment
+  };
+
+  struct Assembly {
+    iovec buffer;
+    uint32_t length;
+    uint32_t received;  // bytes
+    uint32_t fragments;
+    std::vector<uint64_t> arrived;  // a bit for each fragment, by offset
+  };
+
+  std::shared_ptr<Channel> m_channel;
+  uint32_t m_credits;
+  bool m_sender;
+  Endpoint::Peer m_peer;
+  uint32_t m_source;
+  uint64_t m_window;  // REORDER_WINDOW, bounded by the credits
+
+  // Sender: the multievents in a ring of m_credits slots, and the headers of
+  // the datagrams in flight
+  std::vector<SendSlot> m_send_slots;
+  uint64_t m_send_head;  // next slot to post
+  uint64_t m_send_next;  // first slot not entirely sent
+  uint64_t m_send_tail;  // first slot not completed
+  size_t m_send_offset;  // of the next fragment of m_send_next
+  uint64_t m_sequence;
+  std::vector<Header> m_headers;
+  uint64_t m_datagrams_sent;
+  uint64_t m_datagrams_done;
+
+  // Receiver: the posted buffers, the multievents being reassembled, by
+  // sequence, and the delivered ones, each in a ring of m_credits slots
+  std::vector<iovec> m_free;
+  uint64_t m_free_head;
+  uint64_t m_free_tail;
+  std::vector<Assembly> m_assembly;
+  uint64_t m_next;  // sequence of the first multievent being reassembled
+  uint64_t m_assembly_end;  // sequence of the first without a buffer
+  std::vector<iovec> m_done;
+  uint64_t m_done_head;
+  uint64_t m_done_tail;
+
+  friend class Channel;
+
+  void progress_send();
+  void receive(Header const& header, unsigned char const* payload, size_t size);
+  bool assign_buffer();
+  bool deliver(bool lost);
+  uint32_t fragments(uint32_t length) const;
+
+ public:
+
+  // Receiving from source
+  Socket(
+      std::shared_ptr<Channel> const& channel,
+      uint32_t source,
+      uint32_t credits);
+  // Sending to peer, as source
+  Socket(
+      std::shared_ptr<Channel> const& channel,
+      Endpoint::Peer peer,
+      uint32_t source,
+      uint32_t credits);
+  Socket(Socket const& other) = delete;  // non construction-copyable
+  Socket& operator=(Socket const&) = delete;  // non copyable
+  ~Socket() override;
+
+  void register_memory(void* buffer, size_t size) override;
+
+  using Connection::poll_completed_send;
+  using Connection::poll_completed_recv;
+  size_t poll_completed_send(iovec* iov, size_t n) override;
+  size_t poll_completed_recv(iovec* iov, size_t n) override;
+
+  using Connection::post_send;
+  using Connection::post_recv;
+  void post_send(iovec const& iov) override;
+  void post_recv(iovec const& iov) override;
+  void post_sendv(iovec const* iov, size_t n) override;
+
+  bool available_send() override;
+  bool available_recv() override;
+
+  std::vector<iovec> pending_send() override;
+  std::vector<iovec> pending_recv() override;
+
+  std::string peer_hostname() override;
+
+  std::vector<int> wait_fds() override;
+  bool arm_wait() override;
+};
+
+}
+
+}
+
+#endif
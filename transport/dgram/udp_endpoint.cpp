@@ -0,0 +1,215 @@
+#include "transport/dgram/udp_endpoint.h"
+
+#include <algorithm>
+
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+
+#include "common/exception.h"
+
+namespace lseb {
+
+namespace dgram {
+
+namespace {
+
+sockaddr_in resolve_address(char const* hostname, char const* port) {
+  addrinfo hints;
+  std::memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_DGRAM;
+  addrinfo* res;
+  int rc = getaddrinfo(hostname, port, &hints, &res);
+  if (rc) {
+    throw exception::socket::generic_error(
+        "Error on getaddrinfo: " + std::string(gai_strerror(rc)));
+  }
+  sockaddr_in addr;
+  std::memcpy(&addr, res->ai_addr, sizeof(addr));
+  freeaddrinfo(res);
+  return addr;
+}
+
+}
+
+Endpoint::Endpoint(
+    char const* hostname,
+    char const* port,
+    size_t size,
+    uint32_t depth,
+    bool wait)
+    : m_size(size),
+      m_depth(depth),
+      m_sent(depth),
+      m_sent_head(0),
+      m_sent_tail(0),
+      m_recv(depth),
+      m_recv_head(0),
+      m_recv_tail(0),
+      m_msgs(depth),
+      m_msg_iov(depth) {
+  // Largest UDP payload over IPv4
+  if (m_size > 65507) {
+    throw exception::socket::generic_error(
+        "Error on Endpoint: datagrams longer than 65507 bytes");
+  }
+
+  m_fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (m_fd == -1) {
+    throw exception::socket::generic_error(
+        "Error on socket: " + std::string(strerror(errno)));
+  }
+
+  // The kernel holds the datagrams received between two polls, and drops the
+  // ones beyond its buffer: make room for many times the posted buffers,
+  // up to net.core.rmem_max
+  int rcvbuf = m_size * m_depth * 16;
+  setsockopt(m_fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+  sockaddr_in addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  if (hostname) {
+    try {
+      addr = resolve_address(hostname, port);
+    } catch (std::exception&) {
+      close(m_fd);
+      throw;
+    }
+  }
+  if (bind(m_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr))) {
+    int err = errno;
+    close(m_fd);
+    throw exception::socket::generic_error(
+        "Error on bind: " + std::string(strerror(err)));
+  }
+}
+
+Endpoint::~Endpoint() {
+  close(m_fd);
+}
+
+std::vector<unsigned char> Endpoint::name() const {
+  sockaddr_in addr;
+  socklen_t len = sizeof(addr);
+  if (getsockname(m_fd, reinterpret_cast<sockaddr*>(&addr), &len)) {
+    throw exception::socket::generic_error(
+        "Error on getsockname: " + std::string(strerror(errno)));
+  }
+  unsigned char const* begin = reinterpret_cast<unsigned char const*>(&addr);
+  return std::vector<unsigned char>(begin, begin + sizeof(addr));
+}
+
+Endpoint::Peer Endpoint::insert(void const* address, size_t len) {
+  if (len != sizeof(sockaddr_in)) {
+    throw exception::socket::generic_error(
+        "Error on insert: wrong address length");
+  }
+  sockaddr_in addr;
+  std::memcpy(&addr, address, sizeof(addr));
+  m_peers.push_back(addr);
+  return m_peers.size() - 1;
+}
+
+Endpoint::Peer Endpoint::resolve(
+    std::string const& hostname,
+    std::string const& port) {
+  sockaddr_in addr = resolve_address(hostname.c_str(), port.c_str());
+  return insert(&addr, sizeof(addr));
+}
+
+std::string Endpoint::hostname(Peer peer) const {
+  char str[INET_ADDRSTRLEN];
+  if (!inet_ntop(AF_INET, &m_peers[peer].sin_addr, str, INET_ADDRSTRLEN)) {
+    return std::string();
+  }
+  return str;
+}
+
+bool Endpoint::send(Peer peer, iovec const* iov, size_t n, void* context) {
+  if (m_sent_head - m_sent_tail == m_depth) {
+    return false;
+  }
+  msghdr msg;
+  std::memset(&msg, 0, sizeof(msg));
+  msg.msg_name = &m_peers[peer];
+  msg.msg_namelen = sizeof(sockaddr_in);
+  msg.msg_iov = const_cast<iovec*>(iov);
+  msg.msg_iovlen = n;
+  if (sendmsg(m_fd, &msg, MSG_DONTWAIT) == -1) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+      return false;
+    }
+    // The peer may not be listening yet: the datagram is lost, as if it had
+    // been dropped on the way
+    if (errno != ECONNREFUSED) {
+      throw exception::socket::generic_error(
+          "Error on sendmsg: " + std::string(strerror(errno)));
+    }
+  }
+  m_sent[m_sent_head++ % m_depth] = context;
+  return true;
+}
+
+size_t Endpoint::poll_sent(void** context, size_t n) {
+  size_t count = 0;
+  while (count < n && m_sent_tail != m_sent_head) {
+    context[count++] = m_sent[m_sent_tail++ % m_depth];
+  }
+  return count;
+}
+
+void Endpoint::post_recv(void* buffer) {
+  if (m_recv_head - m_recv_tail == m_depth) {
+    throw exception::socket::generic_error(
+        "Error on post_recv: too many receive buffers");
+  }
+  m_recv[m_recv_head++ % m_depth] = buffer;
+}
+
+size_t Endpoint::poll_recv(iovec* iov, size_t n) {
+  size_t const count = std::min<size_t>(n, m_recv_head - m_recv_tail);
+  if (!count) {
+    return 0;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    m_msg_iov[i].iov_base = m_recv[(m_recv_tail + i) % m_depth];
+    m_msg_iov[i].iov_len = m_size;
+    std::memset(&m_msgs[i], 0, sizeof(mmsghdr));
+    m_msgs[i].msg_hdr.msg_iov = &m_msg_iov[i];
+    m_msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+  int ret = recvmmsg(m_fd, m_msgs.data(), count, MSG_DONTWAIT, nullptr);
+  if (ret == -1) {
+    // An ICMP error of an earlier send is reported on the next call
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ECONNREFUSED) {
+      return 0;
+    }
+    throw exception::socket::generic_error(
+        "Error on recvmmsg: " + std::string(strerror(errno)));
+  }
+  for (int i = 0; i < ret; ++i) {
+    iov[i].iov_base = m_msg_iov[i].iov_base;
+    iov[i].iov_len = m_msgs[i].msg_len;
+  }
+  m_recv_tail += ret;
+  return ret;
+}
+
+std::vector<int> Endpoint::wait_fds() const {
+  return {m_fd};
+}
+
+bool Endpoint::arm_wait() {
+  // The epoll set is edge-triggered: the datagrams arrived before are read
+  // by the poll that follows the arming
+  return true;
+}
+
+}
+
+}
@@ -0,0 +1,83 @@
+#ifndef TRANSPORT_DGRAM_UDP_ENDPOINT_H
+#define TRANSPORT_DGRAM_UDP_ENDPOINT_H
+
+#include <string>
+#include <vector>
+
+#include <cstdint>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+namespace lseb {
+
+namespace dgram {
+
+// Unreliable datagram endpoint on a kernel UDP socket, used by the transport
+// layers without datagram endpoints of their own. The sends are copied by the
+// kernel, so they complete as soon as they are handed to it.
+
+class Endpoint {
+
+  int m_fd;
+  size_t m_size;
+  uint32_t m_depth;
+  std::vector<sockaddr_in> m_peers;
+
+  // Contexts of the completed sends, in a ring of m_depth slots
+  std::vector<void*> m_sent;
+  uint64_t m_sent_head;
+  uint64_t m_sent_tail;
+
+  // Posted receive buffers, in a ring of m_depth slots
+  std::vector<void*> m_recv;
+  uint64_t m_recv_head;
+  uint64_t m_recv_tail;
+
+  // Used as temporary buffers for recvmmsg
+  std::vector<mmsghdr> m_msgs;
+  std::vector<iovec> m_msg_iov;
+
+ public:
+  typedef uint64_t Peer;
+
+  // Bound to hostname and port, if given, or to an ephemeral port. It sends
+  // and receives datagrams up to size bytes, at most depth at a time in each
+  // direction. The socket can always be waited for, wait is only needed by
+  // the endpoints of the other transport layers.
+  Endpoint(
+      char const* hostname,
+      char const* port,
+      size_t size,
+      uint32_t depth,
+      bool wait = false);
+  Endpoint(Endpoint const& other) = delete;  // non construction-copyable
+  Endpoint& operator=(Endpoint const&) = delete;  // non copyable
+  ~Endpoint();
+
+  // Address of the endpoint, to be inserted by the peers
+  std::vector<unsigned char> name() const;
+  Peer insert(void const* address, size_t len);
+  Peer resolve(std::string const& hostname, std::string const& port);
+  std::string hostname(Peer peer) const;
+
+  // Send the datagram gathered from iov, or return false if it cannot be
+  // queued now. The context is returned by poll_sent once it has been sent.
+  bool send(Peer peer, iovec const* iov, size_t n, void* context);
+  size_t poll_sent(void** context, size_t n);
+
+  // The buffers must hold size bytes. The received ones are returned with
+  // the length of their datagram.
+  void post_recv(void* buffer);
+  size_t poll_recv(iovec* iov, size_t n);
+
+  std::vector<int> wait_fds() const;
+  bool arm_wait();
+};
+
+}
+
+}
+
+#endif
@@ -19,11 +19,21 @@ namespace lseb {
 class Endpoint {
   std::string m_hostname;
   std::string m_port;
+  std::vector<std::string> m_rails;
 
  public:
-  Endpoint(std::string const& hostname, std::string const& port)
+  // The rails are the addresses of the network interfaces of the node, which
+  // all listen on the same port. Without rails the hostname is the only one.
+  Endpoint(
+      std::string const& hostname,
+      std::string const& port,
+      std::vector<std::string> const& rails = std::vector<std::string>())
       : m_hostname(hostname),
-        m_port(port) {
+        m_port(port),
+        m_rails(rails) {
+    if (m_rails.empty()) {
+      m_rails.push_back(m_hostname);
+    }
   }
   std::string hostname() const {
     return m_hostname;
@@ -31,18 +41,36 @@ class Endpoint {
   std::string port() const {
     return m_port;
   }
+  std::vector<std::string> const& rails() const {
+    return m_rails;
+  }
   friend std::ostream& operator<<(std::ostream& os, Endpoint const& endpoint) {
     os << endpoint.hostname() << ":" << endpoint.port();
     return os;
   }
 };
 
+// Endpoints on the same node can be connected through shared memory
+inline bool is_local(Endpoint const& lhs, Endpoint const& rhs) {
+  return lhs.hostname() == rhs.hostname();
+}
+
 #ifdef HAVE_HYDRA
 inline std::vector<Endpoint> get_endpoints(HydraLauncher & launcher) {
   std::vector<Endpoint> endpoints;
   int nodes = launcher.getWorldSize();
-  for (int i = 0; i < nodes; i++)
-  endpoints.emplace_back(launcher.get("ip",i),launcher.get("port",i));
+  for (int i = 0; i < nodes; i++) {
+    // The addresses of the rails are published separated by commas
+    std::vector<std::string> rails;
+    std::istringstream rails_is(launcher.get("rails", i));
+    for (std::string rail; std::getline(rails_is, rail, ',');) {
+      rails.push_back(rail);
+    }
+    endpoints.emplace_back(
+        launcher.get("ip", i),
+        launcher.get("port", i),
+        rails);
+  }
   return endpoints;
 }
 #else //HAVE_HYDRA
@@ -50,9 +78,17 @@ inline std::vector<Endpoint> get_endpoints(Configuration const& configuration) {
   std::vector<Endpoint> endpoints;
   for (Configuration::const_iterator it = std::begin(configuration), e =
       std::end(configuration); it != e; ++it) {
+    // RAILS is an optional array of addresses, one per network interface
+    std::vector<std::string> rails;
+    if (auto rails_child = it->second.get_child_optional("RAILS")) {
+      for (auto const& rail : *rails_child) {
+        rails.push_back(rail.second.get_value<std::string>());
+      }
+    }
     endpoints.emplace_back(
         it->second.get<std::string>("HOST"),
-        it->second.get<std::string>("PORT"));
+        it->second.get<std::string>("PORT"),
+        rails);
   }
   return endpoints;
 }
@@ -0,0 +1,381 @@
+#include "transport/feedback.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+
+#include "common/exception.h"
+
+namespace lseb {
+
+namespace feedback {
+
+namespace {
+
+// Listening backlog, enough for all the Readout Units at once
+int const LISTEN_BACKLOG = 1024;
+// Events read by a single poll
+int const MAX_EVENTS = 64;
+
+// Write as much as possible of what is pending
+void flush(Peer& peer) {
+  while (!peer.out.empty()) {
+    ssize_t const ret = send(
+        peer.fd,
+        peer.out.data(),
+        peer.out.size(),
+        MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (ret <= 0) {
+      // On errors, the next read finds the connection closed
+      return;
+    }
+    peer.out.erase(std::begin(peer.out), std::begin(peer.out) + ret);
+  }
+}
+
+// Read all that is available, return false if the connection is closed
+bool fill(Peer& peer) {
+  unsigned char buffer[1024];
+  while (true) {
+    ssize_t const ret = recv(peer.fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+    if (ret > 0) {
+      peer.in.insert(std::end(peer.in), buffer, buffer + ret);
+    } else if (ret == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      return true;
+    } else if (ret == -1 && errno == EINTR) {
+      continue;
+    } else {
+      return false;
+    }
+  }
+}
+
+template<typename T>
+void append(Peer& peer, T const& message) {
+  unsigned char const* bytes = reinterpret_cast<unsigned char const*>(
+      &message);
+  peer.out.insert(std::end(peer.out), bytes, bytes + sizeof(message));
+}
+
+template<typename T>
+bool extract(Peer& peer, T& message) {
+  if (peer.in.size() < sizeof(message)) {
+    return false;
+  }
+  std::memcpy(&message, peer.in.data(), sizeof(message));
+  peer.in.erase(std::begin(peer.in), std::begin(peer.in) + sizeof(message));
+  return true;
+}
+
+void set_nodelay(int fd) {
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+}
+
+Server::Server(
+    std::string const& hostname,
+    std::string const& port,
+    size_t clients)
+    : m_fd(-1),
+      m_epoll_fd(-1),
+      m_clients(clients),
+      m_taken(0),
+      m_status(0),
+      m_stop(false) {
+  addrinfo hints;
+  std::memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_PASSIVE;
+  addrinfo* res;
+  int ret = getaddrinfo(hostname.c_str(), port.c_str(), &hints, &res);
+  if (ret) {
+    throw exception::acceptor::generic_error(
+        "Error on getaddrinfo: " + std::string(gai_strerror(ret)));
+  }
+
+  m_fd = socket(res->ai_family, res->ai_socktype | SOCK_NONBLOCK, 0);
+  if (m_fd == -1) {
+    freeaddrinfo(res);
+    throw exception::acceptor::generic_error(
+        "Error on socket: " + std::string(strerror(errno)));
+  }
+
+  int one = 1;
+  setsockopt(m_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  ret = bind(m_fd, res->ai_addr, res->ai_addrlen);
+  freeaddrinfo(res);
+  if (ret) {
+    close(m_fd);
+    throw exception::acceptor::generic_error(
+        "Error on bind: " + std::string(strerror(errno)));
+  }
+
+  if (listen(m_fd, LISTEN_BACKLOG)) {
+    close(m_fd);
+    throw exception::acceptor::generic_error(
+        "Error on listen: " + std::string(strerror(errno)));
+  }
+
+  m_epoll_fd = epoll_create1(0);
+  if (m_epoll_fd == -1) {
+    close(m_fd);
+    throw exception::acceptor::generic_error(
+        "Error on epoll_create1: " + std::string(strerror(errno)));
+  }
+
+  epoll_event event;
+  std::memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN;
+  event.data.fd = m_fd;
+  if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_fd, &event)) {
+    close(m_epoll_fd);
+    close(m_fd);
+    throw exception::acceptor::generic_error(
+        "Error on epoll_ctl: " + std::string(strerror(errno)));
+  }
+
+  m_thread = std::thread(&Server::serve, this);
+}
+
+Server::~Server() {
+  m_stop = true;
+  m_thread.join();
+  for (auto& peer : m_peers) {
+    close(peer.first);
+  }
+  close(m_epoll_fd);
+  close(m_fd);
+}
+
+void Server::update(uint32_t free_buffers, uint32_t backlog) {
+  m_status.store(
+      uint64_t(free_buffers) << 32 | backlog,
+      std::memory_order_relaxed);
+}
+
+// The Readout Units request the epochs in order, so that the ones before
+// the last taken have all been taken: a request for one of them that is no
+// longer kept would get a status different from the other Readout Units.
+void Server::answer(Peer& peer, uint64_t epoch) {
+  auto snapshot = m_snapshots.find(epoch);
+  if (snapshot == std::end(m_snapshots)) {
+    if (epoch < m_taken) {
+      throw exception::socket::generic_error(
+          "Error on feedback: status of epoch " + std::to_string(epoch)
+              + " requested again after all the ru have fetched it");
+    }
+    uint64_t const status = m_status.load(std::memory_order_relaxed);
+    Status const taken { epoch, uint32_t(status >> 32), uint32_t(status) };
+    snapshot = m_snapshots.emplace(
+        epoch,
+        std::make_pair(taken, size_t(0))).first;
+    m_taken = epoch + 1;
+  }
+  append(peer, snapshot->second.first);
+  flush(peer);
+  if (++snapshot->second.second == m_clients) {
+    m_snapshots.erase(snapshot);
+  }
+}
+
+void Server::serve() {
+  epoll_event events[MAX_EVENTS];
+  while (!m_stop) {
+    int const n = epoll_wait(
+        m_epoll_fd,
+        events,
+        MAX_EVENTS,
+        STOP_CHECK.count());
+    for (int i = 0; i < n; ++i) {
+      int const fd = events[i].data.fd;
+      if (fd == m_fd) {
+        int peer_fd;
+        while ((peer_fd = accept4(m_fd, nullptr, nullptr, SOCK_NONBLOCK))
+            != -1) {
+          set_nodelay(peer_fd);
+          epoll_event event;
+          std::memset(&event, 0, sizeof(event));
+          event.events = EPOLLIN;
+          event.data.fd = peer_fd;
+          if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, peer_fd, &event)) {
+            close(peer_fd);
+            continue;
+          }
+          Peer& peer = m_peers[peer_fd];
+          peer.fd = peer_fd;
+        }
+        continue;
+      }
+
+      auto it = m_peers.find(fd);
+      if (it == std::end(m_peers)) {
+        continue;
+      }
+      Peer& peer = it->second;
+      bool const open = fill(peer);
+      uint64_t epoch;
+      while (extract(peer, epoch)) {
+        answer(peer, epoch);
+      }
+      if (!open) {
+        // The Readout Unit has gone, its requests are dropped with it
+        epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        m_peers.erase(it);
+      }
+    }
+
+    for (auto& peer : m_peers) {
+      flush(peer.second);
+    }
+  }
+}
+
+Client::Client(int nodes)
+    : m_epoll_fd(epoll_create1(0)),
+      m_peers(nodes),
+      m_stop(false) {
+  if (m_epoll_fd == -1) {
+    throw exception::connector::generic_error(
+        "Error on epoll_create1: " + std::string(strerror(errno)));
+  }
+  for (auto& peer : m_peers) {
+    peer.fd = -1;
+  }
+}
+
+Client::~Client() {
+  m_stop = true;
+  if (m_thread.joinable()) {
+    m_thread.join();
+  }
+  for (auto& peer : m_peers) {
+    if (peer.fd != -1) {
+      close(peer.fd);
+    }
+  }
+  close(m_epoll_fd);
+}
+
+void Client::connect(
+    int id,
+    std::string const& hostname,
+    std::string const& port) {
+  addrinfo hints;
+  std::memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* res;
+  int ret = getaddrinfo(hostname.c_str(), port.c_str(), &hints, &res);
+  if (ret) {
+    throw exception::connector::generic_error(
+        "Error on getaddrinfo: " + std::string(gai_strerror(ret)));
+  }
+
+  int fd = socket(res->ai_family, res->ai_socktype, 0);
+  if (fd == -1) {
+    freeaddrinfo(res);
+    throw exception::connector::generic_error(
+        "Error on socket: " + std::string(strerror(errno)));
+  }
+
+  ret = ::connect(fd, res->ai_addr, res->ai_addrlen);
+  freeaddrinfo(res);
+  if (ret) {
+    int const err = errno;
+    close(fd);
+    throw exception::connector::generic_error(
+        "Error on connect: " + std::string(strerror(err)));
+  }
+  set_nodelay(fd);
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+  epoll_event event;
+  std::memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN;
+  event.data.u32 = id;
+  if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &event)) {
+    int const err = errno;
+    close(fd);
+    throw exception::connector::generic_error(
+        "Error on epoll_ctl: " + std::string(strerror(err)));
+  }
+  m_peers[id].fd = fd;
+}
+
+void Client::request(uint64_t epoch) {
+  if (!m_thread.joinable()) {
+    m_thread = std::thread(&Client::receive, this);
+  }
+  for (auto& peer : m_peers) {
+    append(peer, epoch);
+    flush(peer);
+  }
+}
+
+// The thread only reads the sockets, and the polling loop only writes them
+void Client::receive() {
+  epoll_event events[MAX_EVENTS];
+  while (!m_stop) {
+    int const n = epoll_wait(
+        m_epoll_fd,
+        events,
+        MAX_EVENTS,
+        STOP_CHECK.count());
+    for (int i = 0; i < n; ++i) {
+      int const id = events[i].data.u32;
+      Peer& peer = m_peers[id];
+      if (!fill(peer)) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_error = "Error on feedback: connection closed by bu "
+            + std::to_string(id);
+        return;
+      }
+      Status answer;
+      while (extract(peer, answer)) {
+        auto& answers = m_answers[answer.epoch];
+        answers.resize(m_peers.size());
+        answers[id] = answer;
+        if (++m_answered[answer.epoch] == m_peers.size()) {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          m_complete[answer.epoch] = std::move(answers);
+          m_answers.erase(answer.epoch);
+          m_answered.erase(answer.epoch);
+        }
+      }
+    }
+  }
+}
+
+bool Client::answers(uint64_t epoch, std::vector<Status>& status) {
+  for (auto& peer : m_peers) {
+    flush(peer);
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (!m_error.empty()) {
+    throw exception::socket::generic_error(m_error);
+  }
+  auto const complete = m_complete.find(epoch);
+  if (complete == std::end(m_complete)) {
+    return false;
+  }
+  status = std::move(complete->second);
+  m_complete.erase(complete);
+  return true;
+}
+
+}
+
+}
@@ -0,0 +1,110 @@
+#ifndef TRANSPORT_FEEDBACK_H
+#define TRANSPORT_FEEDBACK_H
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cstdint>
+
+namespace lseb {
+
+namespace feedback {
+
+// Longest time that the threads of the channel block before checking
+// whether they must stop
+static const std::chrono::milliseconds STOP_CHECK(100);
+
+// Status of a Builder Unit, as advertised to the Readout Units for an epoch
+struct Status {
+  uint64_t epoch;
+  uint32_t free_buffers;  // receive buffers of a source not yet filled
+  uint32_t backlog;  // multievents of a source received and not yet built
+};
+
+// Reverse channel from the Builder Units to the Readout Units, on plain TCP
+// sockets whatever the transport layer of the data. Each Readout Unit asks
+// all the Builder Units for their status in an epoch. The first request for
+// an epoch takes the status of the Builder Unit, and all the Readout Units
+// get the same answer, so that they take the same decisions from it. Each
+// side reads its sockets from a thread of its own, blocked until they have
+// something: the polling loops of the units only publish the status, send
+// the requests and take the complete answers.
+
+struct Peer {
+  int fd;
+  std::vector<unsigned char> in;  // partial message
+  std::vector<unsigned char> out;  // not yet written
+};
+
+// Builder Unit side: accepts the Readout Units and answers them
+
+class Server {
+  int m_fd;
+  int m_epoll_fd;
+  size_t m_clients;  // Readout Units, each of which fetches every status
+  std::map<int, Peer> m_peers;  // by descriptor
+  // Status taken for each epoch, until all the Readout Units have fetched it,
+  // and the first epoch not taken yet
+  std::map<uint64_t, std::pair<Status, size_t> > m_snapshots;
+  uint64_t m_taken;
+  std::atomic<uint64_t> m_status;  // free buffers and backlog, packed
+  std::atomic<bool> m_stop;
+  std::thread m_thread;
+
+  void serve();
+  void answer(Peer& peer, uint64_t epoch);
+
+ public:
+  Server(std::string const& hostname, std::string const& port, size_t clients);
+  Server(Server const& other) = delete;  // non construction-copyable
+  Server& operator=(Server const&) = delete;  // non copyable
+  ~Server();
+
+  // Publish the current status, taken by the first request of each epoch
+  void update(uint32_t free_buffers, uint32_t backlog);
+};
+
+// Readout Unit side: connected to each Builder Unit, by id
+
+class Client {
+  int m_epoll_fd;
+  std::vector<Peer> m_peers;
+  // Read by the thread: the answers to the epochs not yet complete
+  std::map<uint64_t, std::vector<Status> > m_answers;  // by epoch
+  std::map<uint64_t, size_t> m_answered;  // Builder Units, by epoch
+  // Handed to the polling loop: the complete epochs, or why the thread
+  // stopped
+  std::map<uint64_t, std::vector<Status> > m_complete;
+  std::string m_error;
+  std::mutex m_mutex;
+  std::atomic<bool> m_stop;
+  std::thread m_thread;
+
+  void receive();
+
+ public:
+  explicit Client(int nodes);
+  Client(Client const& other) = delete;  // non construction-copyable
+  Client& operator=(Client const&) = delete;  // non copyable
+  ~Client();
+
+  void connect(int id, std::string const& hostname, std::string const& port);
+
+  // Ask all the Builder Units for their status in epoch. The first request
+  // starts reading the answers.
+  void request(uint64_t epoch);
+  // Move the status of all the Builder Units in epoch to status once they
+  // have all answered
+  bool answers(uint64_t epoch, std::vector<Status>& status);
+};
+
+}
+
+}
+
+#endif
@@ -2,6 +2,7 @@
 
 #include <iostream>
 #include <cstring>
+#include <thread>
 
 #include <rdma/fi_endpoint.h>
 #include <rdma/fi_errno.h>
@@ -14,22 +15,92 @@ namespace lseb {
 Acceptor::Acceptor(int credits)
     : m_credits(credits),
       m_pep(nullptr),
-      m_pep_eq(nullptr) {
+      m_pep_eq(nullptr),
+      m_domain(nullptr),
+      m_srq_size(0),
+      m_write_ring(false),
+      m_wait(false),
+      m_rdm_enabled(false) {
+}
+
+void Acceptor::share_receive_queue(int size) {
+  // The context is opened on the domain of the listening address
+  m_srq_size = size;
+}
+
+void Acceptor::share_completion_queue(
+    std::shared_ptr<CompletionQueue> const& cq) {
+  m_cq = cq;
+}
+
+void Acceptor::enable_wait() {
+  m_wait = true;
+}
+
+void Acceptor::enable_write_ring() {
+  m_write_ring = true;
+}
+
+void Acceptor::enable_rdm() {
+  m_rdm_enabled = true;
 }
 
 void Acceptor::listen(std::string const& hostname, std::string const& port) {
 
+  // The context of a receive identifies the socket which posted it, not the
+  // one which completed it, so a shared receive context cannot be polled
+  // through a shared completion queue
+  if (m_srq_size && m_cq) {
+    throw exception::acceptor::generic_error(
+        "Error on listen: shared receive context with shared completion"
+            " queue");
+  }
+
+  // The remote writes may be reported without the context of a receive,
+  // which would identify the socket in a shared completion queue
+  if (m_write_ring && m_cq) {
+    throw exception::acceptor::generic_error(
+        "Error on listen: write ring with shared completion queue");
+  }
+
+  if (m_rdm_enabled) {
+    if (!m_cq || m_srq_size) {
+      throw exception::acceptor::generic_error(
+          "Error on listen: unconnected endpoint without shared completion"
+              " queue or with shared receive context");
+    }
+    if (!m_rdm) {
+      try {
+        m_rdm = std::make_shared<RdmEndpoint>(
+            hostname.c_str(),
+            nullptr,
+            m_cq,
+            false);
+        m_greeter_ep = std::make_shared<RdmEndpoint>(
+            hostname.c_str(),
+            port.c_str(),
+            m_cq,
+            false);
+        m_greeter.reset(new Socket(m_greeter_ep, FI_ADDR_UNSPEC, 1));
+        m_hello.reset(new Hello);
+        m_greeter->register_memory(m_hello.get(), sizeof(Hello));
+      } catch (std::exception& e) {
+        throw exception::acceptor::generic_error(e.what());
+      }
+      m_domain = &m_rdm->domain();
+    }
+    return;
+  }
+
   if (!m_pep) {
 
     // NOTE: Works for verbs, not necessarily for psm: needs investigation.
     //       Probably works for psm only with FI_PSM_NAME_SERVER enabled.
 
-    Domain& d = Domain::get_instance();
-
     // Resolve hostname and port to fabric specific addresses
     fi_info* info_p;
     int rc = fi_getinfo(FI_VERSION(1, 3), hostname.c_str(), port.c_str(),
-    FI_SOURCE, d.get_hints(), &info_p);
+    FI_SOURCE, Domain::get_instance().get_hints(), &info_p);
 
     if (rc) {
       throw exception::acceptor::generic_error(
@@ -37,6 +108,24 @@ void Acceptor::listen(std::string const& hostname, std::string const& port) {
     }
 
     fabric_ptr<fi_info> info { info_p };
+
+    // The interface of the address determines the domain
+    Domain& d = Domain::get_instance(info->domain_attr->name);
+    if (m_cq) {
+      try {
+        m_cq->create(d);
+      } catch (std::exception& e) {
+        throw exception::acceptor::generic_error(e.what());
+      }
+    }
+    m_domain = &d;
+    if (m_srq_size) {
+      try {
+        m_srq = std::make_shared<SharedReceiveQueue>(d, m_srq_size);
+      } catch (std::exception& e) {
+        throw exception::acceptor::generic_error(e.what());
+      }
+    }
     fid_pep* pep;
     rc = fi_passive_ep(d.get_raw_fabric(), info.get(), &pep,
     NULL /* context */);
@@ -76,15 +165,51 @@ void Acceptor::listen(std::string const& hostname, std::string const& port) {
   }
 }
 
+std::unique_ptr<Socket> Acceptor::accept_rdm() {
+  iovec iov = { m_hello.get(), sizeof(Hello) };
+  m_greeter->post_recv(iov);
+  while (!m_greeter->poll_completed_recv(&iov, 1)) {
+    m_cq->poll();
+    std::this_thread::yield();
+  }
+  if (m_hello->size > rdm::ADDRESS_SIZE) {
+    throw exception::acceptor::generic_error(
+        "Error on accept: wrong introduction");
+  }
+  fi_addr_t const peer = m_rdm->insert(m_hello->address);
+
+  // The answer carries the address of the data endpoint
+  Socket answer(m_greeter_ep, m_greeter_ep->insert(m_hello->address), 1);
+  *m_hello = m_rdm->hello();
+  answer.register_memory(m_hello.get(), sizeof(Hello));
+  answer.post_send(iov);
+  while (!answer.poll_completed_send(&iov, 1)) {
+    m_cq->poll();
+  }
+  return make_unique<Socket>(m_rdm, peer, m_credits);
+}
+
 std::unique_ptr<Socket> Acceptor::accept() {
 
-  Domain& d = Domain::get_instance();
+  if (m_rdm) {
+    try {
+      return accept_rdm();
+    } catch (exception::acceptor::generic_error&) {
+      throw;
+    } catch (std::exception& e) {
+      throw exception::acceptor::generic_error(e.what());
+    }
+  }
+
+  Domain& d = *m_domain;
 
   fi_eq_cm_entry entry;
   read_event(m_pep_eq, &entry, FI_CONNREQ);
 
   fid_ep* ep_raw;
-  // Instead of NULL you can create a fi_srx_context and pass it in order to use shared receive queues
+  if (m_srq) {
+    entry.info->ep_attr->rx_ctx_cnt = FI_SHARED_CONTEXT;
+  }
   int rc = fi_endpoint(d.get_raw_domain(), entry.info, &ep_raw, NULL);
   fi_freeinfo(entry.info);
   if (rc) {
@@ -93,13 +218,34 @@ std::unique_ptr<Socket> Acceptor::accept() {
   }
   fabric_ptr<fid_ep> ep { ep_raw };
 
+  if (m_srq) {
+    rc = fi_ep_bind(ep.get(), &m_srq->srx.get()->fid, 0);
+    if (rc) {
+      throw exception::acceptor::generic_error(
+          "Error on fi_ep_bind: " + std::string(fi_strerror(-rc)));
+    }
+  }
+
   // Create completion queues
   fabric_ptr<fid_cq> rx_cq, tx_cq;
-  bind_completion_queues(ep, rx_cq, tx_cq, m_credits);
+  if (m_cq) {
+    bind_completion_queues(ep, m_cq->rx_cq(), m_cq->tx_cq());
+  } else {
+    // Each write into the ring generates a receive completion
+    bind_completion_queues(
+        ep,
+        d.get_raw_domain(),
+        rx_cq,
+        tx_cq,
+        m_write_ring ?
+            m_credits * write_ring::MESSAGES_PER_BUFFER : m_credits,
+        false,
+        m_wait);
+  }
 
   // Create event queues
   fabric_ptr<fid_eq> eq;
-  bind_event_queue(ep, eq);
+  bind_event_queue(ep, d.get_raw_fabric(), eq);
 
   rc = fi_accept(ep.get(), NULL, 0);
   if (rc) {
@@ -109,11 +255,24 @@ std::unique_ptr<Socket> Acceptor::accept() {
 
   read_event(eq, &entry, FI_CONNECTED);
 
-  return make_unique<Socket>(
+  auto socket = make_unique<Socket>(
+      d,
       ep.release(),
       rx_cq.release(),
       tx_cq.release(),
-      m_credits);
+      m_credits,
+      1,
+      m_srq,
+      m_cq,
+      m_wait);
+  if (m_write_ring) {
+    try {
+      socket->enable_write_ring(false);
+    } catch (std::exception& e) {
+      throw exception::acceptor::generic_error(e.what());
+    }
+  }
+  return socket;
 }
 
 }
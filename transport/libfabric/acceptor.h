@@ -23,6 +23,22 @@ class Acceptor {
   Acceptor(Acceptor&& other) = default;
   Acceptor& operator=(Acceptor&&) = default;
 
+  // The sockets accepted afterwards post their receives to a single queue of
+  // the given size. It must be called before listen.
+  void share_receive_queue(int size);
+  // The sockets accepted afterwards report their completions to cq. It must
+  // be called before listen.
+  void share_completion_queue(std::shared_ptr<CompletionQueue> const& cq);
+  // The sockets accepted afterwards can be waited for, see
+  // Connection::wait_fds. It must be called before listen.
+  void enable_wait();
+  // The sockets accepted afterwards receive the messages written into a ring,
+  // see Socket::enable_write_ring. It must be called before listen.
+  void enable_write_ring();
+  // The sockets accepted afterwards are peers of a single reliable
+  // unconnected endpoint, bound to the listening address, see RdmEndpoint.
+  // They must share a completion queue. It must be called before listen.
+  void enable_rdm();
   void listen(std::string const& hostname, std::string const& port);
   ~Acceptor() = default;
   std::unique_ptr<Socket> accept();
@@ -31,6 +47,23 @@ class Acceptor {
   uint32_t m_credits;
   pep_ptr m_pep;
   eq_ptr m_pep_eq;
+  Domain* m_domain;  // of the listening address
+  int m_srq_size;
+  std::shared_ptr<SharedReceiveQueue> m_srq;
+  std::shared_ptr<CompletionQueue> m_cq;
+  bool m_write_ring;
+  bool m_wait;
+  bool m_rdm_enabled;
+
+  // With unconnected endpoints, the introductions of the connectors are
+  // received from any peer by m_greeter, on an endpoint bound to the
+  // listening port, and answered with the address of m_rdm, which carries
+  // the data and only receives from known peers
+  std::shared_ptr<RdmEndpoint> m_rdm;
+  std::shared_ptr<RdmEndpoint> m_greeter_ep;
+  std::unique_ptr<Socket> m_greeter;
+  std::unique_ptr<Hello> m_hello;
+  std::unique_ptr<Socket> accept_rdm();
 
 };
 
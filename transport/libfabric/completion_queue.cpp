@@ -0,0 +1,95 @@
+#include "transport/libfabric/completion_queue.h"
+
+#include "socket.h"
+#include "domain.h"
+#include "common/exception.h"
+
+namespace lseb {
+
+CompletionQueue::CompletionQueue(uint32_t size, bool wait)
+    : m_size(size),
+      m_wait(wait),
+      m_domain(nullptr),
+      m_entries(size) {
+}
+
+void CompletionQueue::create(Domain& domain) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_domain) {
+    if (m_domain != &domain) {
+      throw exception::socket::generic_error(
+          "Error on create: completion queue bound to another domain");
+    }
+    return;
+  }
+  m_rx_cq = open_completion_queue(domain.get_raw_domain(), m_size, m_wait);
+  m_tx_cq = open_completion_queue(domain.get_raw_domain(), m_size, m_wait);
+  m_domain = &domain;
+}
+
+fid_cq* CompletionQueue::rx_cq() const {
+  return m_rx_cq.get();
+}
+
+fid_cq* CompletionQueue::tx_cq() const {
+  return m_tx_cq.get();
+}
+
+std::vector<int> CompletionQueue::wait_fds() const {
+  if (!m_wait || !m_domain) {
+    return {};
+  }
+  return lseb::wait_fds(m_rx_cq.get(), m_tx_cq.get());
+}
+
+bool CompletionQueue::arm_wait() {
+  return !m_wait || !m_domain || try_wait(
+      m_domain->get_raw_fabric(),
+      m_rx_cq.get(),
+      m_tx_cq.get());
+}
+
+uint32_t CompletionQueue::attach(Socket* socket) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_sockets.push_back(socket);
+  return m_sockets.size() - 1;
+}
+
+void CompletionQueue::detach(uint32_t tag) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_sockets[tag] = nullptr;
+}
+
+void CompletionQueue::poll() {
+  if (!m_domain) {
+    return;
+  }
+
+  size_t ret = read_completions(
+      m_tx_cq.get(),
+      m_entries.data(),
+      m_entries.size());
+  for (size_t i = 0; i < ret; ++i) {
+    uintptr_t const context =
+        reinterpret_cast<uintptr_t>(m_entries[i].op_context);
+    Socket* socket = m_sockets[context >> 32];
+    // Completions of a socket already closed are dropped
+    if (socket) {
+      socket->m_send_order.retire(static_cast<uint32_t>(context));
+    }
+  }
+
+  ret = read_completions(m_rx_cq.get(), m_entries.data(), m_entries.size());
+  for (size_t i = 0; i < ret; ++i) {
+    uintptr_t const context =
+        reinterpret_cast<uintptr_t>(m_entries[i].op_context);
+    Socket* socket = m_sockets[context >> 32];
+    if (socket) {
+      socket->m_recv_done.emplace_back(
+          static_cast<uint32_t>(context),
+          m_entries[i].len);
+    }
+  }
+}
+
+}
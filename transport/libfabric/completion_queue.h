@@ -0,0 +1,63 @@
+#ifndef TRANSPORT_LIBFABRIC_COMPLETION_QUEUE_H
+#define TRANSPORT_LIBFABRIC_COMPLETION_QUEUE_H
+
+#include <mutex>
+#include <vector>
+
+#include <cstdint>
+
+#include <rdma/fabric.h>
+#include "shared.h"
+
+namespace lseb {
+
+class Socket;
+class Domain;
+
+// Receive and transmit completion queues shared by all the endpoints bound to
+// it. A single fi_cq_read per direction reads the completions of all the
+// connections: the upper half of the context of an operation identifies the
+// socket which posted it, the lower half its slot.
+
+class CompletionQueue {
+ public:
+  // With wait, the queues are opened with FI_WAIT_FD, so that they can be
+  // waited for
+  explicit CompletionQueue(uint32_t size, bool wait = false);
+  CompletionQueue(CompletionQueue const& other) = delete;
+  CompletionQueue& operator=(CompletionQueue const&) = delete;
+  ~CompletionQueue() = default;
+
+  // The queues are opened once the domain of the endpoints bound to them is
+  // known, all the endpoints must belong to it
+  void create(Domain& domain);
+
+  fid_cq* rx_cq() const;
+  fid_cq* tx_cq() const;
+
+  std::vector<int> wait_fds() const;
+  bool arm_wait();
+
+  // Return the tag of the socket, to be stored in the context
+  uint32_t attach(Socket* socket);
+  void detach(uint32_t tag);
+
+  // Hand the completions to the sockets, which return them when polled
+  void poll();
+
+ private:
+  uint32_t m_size;
+  bool m_wait;
+  Domain* m_domain;
+  fabric_ptr<fid_cq> m_rx_cq;
+  fabric_ptr<fid_cq> m_tx_cq;
+  // The sockets are attached while connecting, possibly from several threads
+  std::mutex m_mutex;
+  std::vector<Socket*> m_sockets;  // indexed by tag
+  std::vector<fi_cq_data_entry> m_entries;
+
+};
+
+}
+
+#endif
@@ -1,5 +1,7 @@
 #include "transport/libfabric/connector.h"
 
+#include <algorithm>
+
 #include <rdma/fi_errno.h>
 #include "rdma/fi_endpoint.h"
 #include "rdma/fi_cm.h"
@@ -9,15 +11,100 @@
 
 namespace lseb {
 
-Connector::Connector(int credits)
-    : m_credits(credits) {
+Connector::Connector(int credits, int signal_interval)
+    : m_credits(credits),
+      m_signal_interval(signal_interval),
+      m_write_ring(false),
+      m_wait(false) {
+}
+
+void Connector::share_completion_queue(
+    std::shared_ptr<CompletionQueue> const& cq) {
+  m_cq = cq;
+}
+
+void Connector::enable_wait() {
+  m_wait = true;
+}
+
+void Connector::enable_write_ring() {
+  m_write_ring = true;
+}
+
+void Connector::enable_rdm() {
+  if (!m_cq) {
+    throw exception::connector::generic_error(
+        "Error on enable_rdm: unconnected endpoint without shared completion"
+            " queue");
+  }
+  try {
+    m_rdm = std::make_shared<RdmEndpoint>(
+        nullptr,
+        nullptr,
+        m_cq,
+        m_signal_interval > 1);
+  } catch (std::exception& e) {
+    throw exception::connector::generic_error(e.what());
+  }
+}
+
+std::unique_ptr<Socket> Connector::connect_rdm(
+    std::string const& hostname,
+    std::string const& port) {
+  // The queue is polled by a single introduction at a time
+  std::lock_guard<std::mutex> lock(m_rdm->mutex());
+
+  // The answer comes from the listening endpoint of the acceptor, and
+  // carries the address of the one to send the data to
+  Socket greeter(m_rdm, m_rdm->resolve(hostname, port), 1);
+  Hello hello = m_rdm->hello();
+  Hello answer;
+  greeter.register_memory(&hello, sizeof hello);
+  greeter.register_memory(&answer, sizeof answer);
+
+  iovec const answer_iov = { &answer, sizeof answer };
+  iovec const hello_iov = { &hello, sizeof hello };
+  greeter.post_recv(answer_iov);
+  greeter.post_send(hello_iov);
+
+  iovec iov;
+  bool sent = false;
+  bool answered = false;
+  while (!sent || !answered) {
+    m_cq->poll();
+    sent = sent || greeter.poll_completed_send(&iov, 1);
+    answered = answered || greeter.poll_completed_recv(&iov, 1);
+  }
+  if (answer.size > rdm::ADDRESS_SIZE) {
+    throw exception::connector::generic_error(
+        "Error on connect: wrong answer");
+  }
+
+  return make_unique<Socket>(
+      m_rdm,
+      m_rdm->insert(answer.address),
+      m_credits,
+      m_signal_interval);
 }
 
 std::unique_ptr<Socket> Connector::connect(
     std::string const& hostname,
     std::string const& port) {
 
-  Domain& d = Domain::get_instance();
+  if (m_rdm) {
+    try {
+      return connect_rdm(hostname, port);
+    } catch (exception::connector::generic_error&) {
+      throw;
+    } catch (std::exception& e) {
+      throw exception::connector::generic_error(e.what());
+    }
+  }
+
+  if (m_write_ring && m_cq) {
+    throw exception::connector::generic_error(
+        "Error on connect: write ring with shared completion queue");
+  }
 
   /* Resolve address to a fabric specific one */
   // TODO: Verify address correctness in info->dest_addrs
@@ -27,7 +114,7 @@ std::unique_ptr<Socket> Connector::connect(
       hostname.c_str(),
       port.c_str(),
       0,
-      d.get_hints(),
+      Domain::get_instance().get_hints(),
       &info_p);
 
   if (rc) {
@@ -37,6 +124,16 @@ std::unique_ptr<Socket> Connector::connect(
 
   fabric_ptr<fi_info> info { info_p };
 
+  // The interface which reaches the address determines the domain
+  Domain& d = Domain::get_instance(info->domain_attr->name);
+  if (m_cq) {
+    try {
+      m_cq->create(d);
+    } catch (std::exception& e) {
+      throw exception::connector::generic_error(e.what());
+    }
+  }
+
   fid_ep* ep_raw;
   rc = fi_endpoint(d.get_raw_domain(), info.get(), &ep_raw, NULL);
 
@@ -48,11 +145,28 @@ std::unique_ptr<Socket> Connector::connect(
 
   // Create completion queues
   fabric_ptr<fid_cq> rx_cq, tx_cq;
-  bind_completion_queues(ep, rx_cq, tx_cq, m_credits);
+  if (m_cq) {
+    bind_completion_queues(
+        ep,
+        m_cq->rx_cq(),
+        m_cq->tx_cq(),
+        m_signal_interval > 1);
+  } else {
+    // The receives are the updates of the ring
+    bind_completion_queues(
+        ep,
+        d.get_raw_domain(),
+        rx_cq,
+        tx_cq,
+        m_write_ring ?
+            std::max(m_credits, write_ring::UPDATES) : m_credits,
+        m_signal_interval > 1,
+        m_wait);
+  }
 
   // Create event queues
   fabric_ptr<fid_eq> eq;
-  bind_event_queue(ep, eq);
+  bind_event_queue(ep, d.get_raw_fabric(), eq);
 
   rc = fi_connect(ep.get(), info->dest_addr, NULL, 0);
   if (rc) {
@@ -63,11 +177,24 @@ std::unique_ptr<Socket> Connector::connect(
   fi_eq_cm_entry entry;
   read_event(eq, &entry, FI_CONNECTED);
 
-  return make_unique<Socket>(
+  auto socket = make_unique<Socket>(
+      d,
       ep.release(),
       rx_cq.release(),
       tx_cq.release(),
-      m_credits);
+      m_credits,
+      m_signal_interval,
+      nullptr,
+      m_cq,
+      m_wait);
+  if (m_write_ring) {
+    try {
+      socket->enable_write_ring(true);
+    } catch (std::exception& e) {
+      throw exception::connector::generic_error(e.what());
+    }
+  }
+  return socket;
 }
 
 }
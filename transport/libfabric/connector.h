@@ -10,19 +10,41 @@ namespace lseb {
 class Connector {
 
  public:
-  Connector(int credits);
+  Connector(int credits, int signal_interval = 1);
   Connector(Connector const& other) = delete;
   Connector& operator=(Connector const&) = delete;
   Connector(Connector&& other) = delete;
   Connector& operator=(Connector&&) = delete;
   ~Connector() = default;
 
+  // The sockets connected afterwards report their completions to cq
+  void share_completion_queue(std::shared_ptr<CompletionQueue> const& cq);
+  // The sockets connected afterwards can be waited for, see
+  // Connection::wait_fds
+  void enable_wait();
+  // The sockets connected afterwards write the messages into a ring of the
+  // peer, see Socket::enable_write_ring
+  void enable_write_ring();
+  // The sockets connected afterwards are peers of a single reliable
+  // unconnected endpoint, see RdmEndpoint. It must be called after
+  // share_completion_queue.
+  void enable_rdm();
+
   std::unique_ptr<Socket> connect(
       std::string const& hostname,
       std::string const& port);
 
  private:
   uint32_t m_credits;
+  int m_signal_interval;
+  std::shared_ptr<CompletionQueue> m_cq;
+  bool m_write_ring;
+  bool m_wait;
+  std::shared_ptr<RdmEndpoint> m_rdm;
+
+  std::unique_ptr<Socket> connect_rdm(
+      std::string const& hostname,
+      std::string const& port);
 
 };
 
@@ -0,0 +1,204 @@
+#include "transport/libfabric/dgram_endpoint.h"
+
+#include <algorithm>
+
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <rdma/fi_cm.h>
+#include <rdma/fi_endpoint.h>
+#include <rdma/fi_errno.h>
+
+#include "common/exception.h"
+
+namespace lseb {
+
+namespace dgram {
+
+Endpoint::Endpoint(
+    char const* hostname,
+    char const* port,
+    size_t size,
+    uint32_t depth,
+    bool wait)
+    : m_domain(nullptr),
+      m_size(size),
+      m_comp(depth) {
+
+  fi_info* info_p;
+  int rc = fi_getinfo(
+      FI_VERSION(1, 3),
+      hostname,
+      port,
+      hostname ? FI_SOURCE : 0,
+      Domain::get_instance(std::string(), FI_EP_DGRAM).get_hints(),
+      &info_p);
+  if (rc) {
+    throw exception::socket::generic_error(
+        "Error on fi_getinfo: " + std::string(fi_strerror(-rc)));
+  }
+  fabric_ptr<fi_info> info { info_p };
+  if (info->ep_attr->max_msg_size < m_size) {
+    throw exception::socket::generic_error(
+        "Error on Endpoint: datagrams longer than "
+            + std::to_string(info->ep_attr->max_msg_size) + " bytes");
+  }
+
+  m_domain = &Domain::get_instance(info->domain_attr->name, FI_EP_DGRAM);
+
+  fid_ep* ep_raw;
+  rc = fi_endpoint(m_domain->get_raw_domain(), info.get(), &ep_raw, NULL);
+  if (rc) {
+    throw exception::socket::generic_error(
+        "Error on fi_endpoint: " + std::string(fi_strerror(-rc)));
+  }
+  fabric_ptr<fid_ep> ep { ep_raw };
+
+  bind_completion_queues(
+      ep,
+      m_domain->get_raw_domain(),
+      m_rx_cq,
+      m_tx_cq,
+      depth,
+      false,
+      wait);
+
+  fi_av_attr av_attr;
+  std::memset(&av_attr, 0, sizeof av_attr);
+  av_attr.type = FI_AV_TABLE;
+  fid_av* av_raw;
+  rc = fi_av_open(m_domain->get_raw_domain(), &av_attr, &av_raw, NULL);
+  if (rc) {
+    throw exception::socket::generic_error(
+        "Error on fi_av_open: " + std::string(fi_strerror(-rc)));
+  }
+  m_av.reset(av_raw);
+
+  rc = fi_ep_bind(ep.get(), &m_av->fid, 0);
+  if (rc) {
+    throw exception::socket::generic_error(
+        "Error on fi_ep_bind av: " + std::string(fi_strerror(-rc)));
+  }
+
+  rc = fi_enable(ep.get());
+  if (rc) {
+    throw exception::socket::generic_error(
+        "Error on fi_enable: " + std::string(fi_strerror(-rc)));
+  }
+  m_ep = std::move(ep);
+}
+
+std::vector<unsigned char> Endpoint::name() const {
+  std::vector<unsigned char> address(64);
+  size_t size = address.size();
+  int rc = fi_getname(&m_ep->fid, address.data(), &size);
+  if (rc) {
+    throw exception::socket::generic_error(
+        "Error on fi_getname: " + std::string(fi_strerror(-rc)));
+  }
+  address.resize(size);
+  return address;
+}
+
+Endpoint::Peer Endpoint::insert(void const* address, size_t len) {
+  fi_addr_t peer;
+  int rc = fi_av_insert(m_av.get(), address, 1, &peer, 0, NULL);
+  if (rc != 1) {
+    throw exception::socket::generic_error(
+        "Error on fi_av_insert: "
+            + std::string(rc < 0 ? fi_strerror(-rc) : "address not inserted"));
+  }
+  return peer;
+}
+
+Endpoint::Peer Endpoint::resolve(
+    std::string const& hostname,
+    std::string const& port) {
+  fi_info* info_p;
+  int rc = fi_getinfo(
+      FI_VERSION(1, 3),
+      hostname.c_str(),
+      port.c_str(),
+      0,
+      m_domain->get_hints(),
+      &info_p);
+  if (rc) {
+    throw exception::socket::generic_error(
+        "Error on fi_getinfo: " + std::string(fi_strerror(-rc)));
+  }
+  fabric_ptr<fi_info> info { info_p };
+  return insert(info->dest_addr, info->dest_addrlen);
+}
+
+std::string Endpoint::hostname(Peer peer) const {
+  sockaddr_in addr;
+  size_t len = sizeof addr;
+  char str[INET_ADDRSTRLEN];
+  if (fi_av_lookup(m_av.get(), peer, &addr, &len)
+      || !inet_ntop(AF_INET, &addr.sin_addr, str, INET_ADDRSTRLEN)) {
+    return std::string();
+  }
+  return str;
+}
+
+bool Endpoint::send(Peer peer, iovec const* iov, size_t n, void* context) {
+  ssize_t rc = fi_sendv(m_ep.get(), iov, nullptr, n, peer, context);
+  if (rc == -FI_EAGAIN) {
+    return false;
+  }
+  if (rc) {
+    throw exception::socket::generic_error(
+        "Error on fi_sendv: " + std::string(fi_strerror(-rc)));
+  }
+  return true;
+}
+
+size_t Endpoint::poll_sent(void** context, size_t n) {
+  size_t const count = read_completions(
+      m_tx_cq.get(),
+      m_comp.data(),
+      std::min(n, m_comp.size()));
+  for (size_t i = 0; i < count; ++i) {
+    context[i] = m_comp[i].op_context;
+  }
+  return count;
+}
+
+void Endpoint::post_recv(void* buffer) {
+  ssize_t rc = fi_recv(
+      m_ep.get(),
+      buffer,
+      m_size,
+      nullptr,
+      FI_ADDR_UNSPEC,
+      buffer /* context */);
+  if (rc) {
+    throw exception::socket::generic_error(
+        "Error on fi_recv: " + std::string(fi_strerror(-rc)));
+  }
+}
+
+size_t Endpoint::poll_recv(iovec* iov, size_t n) {
+  size_t const count = read_completions(
+      m_rx_cq.get(),
+      m_comp.data(),
+      std::min(n, m_comp.size()));
+  for (size_t i = 0; i < count; ++i) {
+    iov[i].iov_base = m_comp[i].op_context;
+    iov[i].iov_len = m_comp[i].len;
+  }
+  return count;
+}
+
+std::vector<int> Endpoint::wait_fds() const {
+  return lseb::wait_fds(m_rx_cq.get(), m_tx_cq.get());
+}
+
+bool Endpoint::arm_wait() {
+  return try_wait(m_domain->get_raw_fabric(), m_rx_cq.get(), m_tx_cq.get());
+}
+
+}
+
+}
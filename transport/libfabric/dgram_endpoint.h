@@ -0,0 +1,78 @@
+#ifndef TRANSPORT_LIBFABRIC_DGRAM_ENDPOINT_H
+#define TRANSPORT_LIBFABRIC_DGRAM_ENDPOINT_H
+
+#include <string>
+#include <vector>
+
+#include <cstdint>
+
+#include <sys/uio.h>
+
+#include <rdma/fabric.h>
+#include <rdma/fi_domain.h>
+
+#include "shared.h"
+#include "domain.h"
+
+namespace lseb {
+
+namespace dgram {
+
+// Unreliable datagram endpoint (FI_EP_DGRAM). The peers are inserted into its
+// address vector. The receives are posted without descriptors, so only the
+// providers that do not need registered buffers for messages are used.
+
+class Endpoint {
+
+  // NOTE: Declarations sorted by deconstruction requirements
+  Domain* m_domain;
+  size_t m_size;
+  fabric_ptr<fid_cq> m_rx_cq;
+  fabric_ptr<fid_cq> m_tx_cq;
+  fabric_ptr<fid_av> m_av;
+  fabric_ptr<fid_ep> m_ep;
+
+  // Used as temporary buffer for reading completions from rx/tx queues
+  std::vector<fi_cq_data_entry> m_comp;
+
+ public:
+  typedef fi_addr_t Peer;
+
+  // Bound to hostname and port, if given, or to an ephemeral port. It sends
+  // and receives datagrams up to size bytes, at most depth at a time in each
+  // direction. With wait, the queues are opened with FI_WAIT_FD.
+  Endpoint(
+      char const* hostname,
+      char const* port,
+      size_t size,
+      uint32_t depth,
+      bool wait = false);
+  Endpoint(Endpoint const& other) = delete;
+  Endpoint& operator=(Endpoint const&) = delete;
+  ~Endpoint() = default;
+
+  // Address of the endpoint, to be inserted by the peers
+  std::vector<unsigned char> name() const;
+  Peer insert(void const* address, size_t len);
+  Peer resolve(std::string const& hostname, std::string const& port);
+  std::string hostname(Peer peer) const;
+
+  // Send the datagram gathered from iov, or return false if it cannot be
+  // queued now. The context is returned by poll_sent once it has been sent.
+  bool send(Peer peer, iovec const* iov, size_t n, void* context);
+  size_t poll_sent(void** context, size_t n);
+
+  // The buffers must hold size bytes. The received ones are returned with
+  // the length of their datagram.
+  void post_recv(void* buffer);
+  size_t poll_recv(iovec* iov, size_t n);
+
+  std::vector<int> wait_fds() const;
+  bool arm_wait();
+};
+
+}
+
+}
+
+#endif
@@ -3,31 +3,59 @@
 #include <string>
 #include <cassert>
 #include <iostream>
+#include <utility>
+#include <vector>
 
 #include <string.h>
 #include <rdma/fi_errno.h>
 #include <rdma/fi_domain.h>
 
 #include "common/exception.h"
+#include "transport/connection.h"
 
 namespace lseb {
-Domain::Domain()
-    : m_fabric(nullptr),
+Domain::Domain(std::string const& name, fi_ep_type type)
+    : m_name(name),
+      m_fabric(nullptr),
       m_domain(nullptr),
-      m_hints(nullptr) {
+      m_hints(nullptr),
+      m_mr_key(0),
+      m_mr_basic(false),
+      m_rx_cq_data(false) {
 
-  // TODO: Add support for FI_DGRAM
   m_hints.reset(fi_allocinfo());
-  m_hints->caps = FI_MSG;
-  m_hints->mode = FI_LOCAL_MR;
-  m_hints->ep_attr->type = FI_EP_MSG;
+  m_hints->caps = FI_MSG | FI_RMA;
+  m_hints->mode = FI_LOCAL_MR | FI_RX_CQ_DATA;
+  m_hints->ep_attr->type = type;
+  if (type == FI_EP_RDM) {
+    // The receives of a peer are posted with its address
+    m_hints->caps |= FI_DIRECTED_RECV;
+  }
+  if (type == FI_EP_DGRAM) {
+    // Plain messages, sent and received without descriptors
+    m_hints->caps = FI_MSG;
+    m_hints->mode = 0;
+  }
+  // The multievents that wrap around the end of the data ring are gathered
+  // from two segments, after the header of the datagram with FI_EP_DGRAM
+  m_hints->tx_attr->iov_limit =
+      (type == FI_EP_DGRAM) ? 1 + MAX_SEND_SGE : MAX_SEND_SGE;
   m_hints->domain_attr->threading = FI_THREAD_COMPLETION;
   m_hints->domain_attr->data_progress = FI_PROGRESS_MANUAL;
+  // The datagrams go through the kernel UDP stack with any transport layer,
+  // the datagram endpoints of the verbs provider need a prefix on each
+  // message and registered buffers
 #ifdef FI_VERBS
-  m_hints->fabric_attr->prov_name = strdup("verbs");
+  m_hints->fabric_attr->prov_name = strdup(
+      type == FI_EP_RDM ? "verbs;ofi_rxm" :
+      type == FI_EP_DGRAM ? "udp" : "verbs");
 #else // FI_TCP
-  m_hints->fabric_attr->prov_name = strdup("sockets");
+  m_hints->fabric_attr->prov_name = strdup(
+      type == FI_EP_DGRAM ? "udp" : "sockets");
 #endif
+  if (!m_name.empty()) {
+    m_hints->domain_attr->name = strdup(m_name.c_str());
+  }
 
   fi_info* info_p;
   int rc = fi_getinfo(
@@ -44,6 +72,9 @@ Domain::Domain()
     throw lseb::exception::connection::generic_error(
         "Error on Domain fi_info: " + std::string(fi_strerror(-rc)));
   }
+  m_name = info->domain_attr->name;
+  m_mr_basic = info->domain_attr->mr_mode == FI_MR_BASIC;
+  m_rx_cq_data = info->mode & FI_RX_CQ_DATA;
 
   fid_fabric* fabric;
   rc = fi_fabric(info->fabric_attr, &fabric, nullptr);
@@ -62,9 +93,21 @@ Domain::Domain()
   m_domain.reset(domain);
 }
 
-Domain& Domain::get_instance() {
-  static Domain instance;
-  return instance;
+Domain& Domain::get_instance(std::string const& name, fi_ep_type type) {
+  static std::mutex mutex;
+  static std::vector<std::unique_ptr<Domain> > instances;
+  // The first domain is found also by its actual name
+  static std::map<std::pair<fi_ep_type, std::string>, Domain*> names;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = names.find(std::make_pair(type, name));
+  if (it != std::end(names)) {
+    return *it->second;
+  }
+  instances.emplace_back(new Domain(name, type));
+  Domain* const domain = instances.back().get();
+  names[std::make_pair(type, name)] = domain;
+  names.emplace(std::make_pair(type, domain->get_name()), domain);
+  return *domain;
 }
 
 const Domain::domain_ptr& Domain::get_domain() const {
@@ -86,4 +129,81 @@ fi_info* Domain::get_hints() const {
   return m_hints.get();
 }
 
+std::string const& Domain::get_name() const {
+  return m_name;
+}
+
+fid_mr* Domain::acquire_memory_region(void* buffer, size_t size) {
+  std::lock_guard<std::mutex> lock(m_mr_mutex);
+  fid_mr* const* cached = m_mrs.find(buffer, size);
+  if (cached) {
+    ++m_mr_references[*cached];
+    return *cached;
+  }
+  fid_mr* mr;
+  int rc = fi_mr_reg(m_domain.get(),
+      buffer,
+      size,
+      FI_SEND | FI_RECV | FI_WRITE,
+      0 /* offset, must be 0 */,
+      0 /* requested key */,
+      0 /* flags, must be 0 */,
+      &mr,
+      0 /* context */);
+  if (rc) {
+    throw lseb::exception::socket::generic_error(
+        "Error on fi_mr_reg: " + std::string(fi_strerror(-rc)));
+  }
+  m_mrs.insert(buffer, size, mr);
+  m_mr_references[mr] = 1;
+  return mr;
+}
+
+void Domain::release_memory_region(fid_mr* mr) {
+  std::lock_guard<std::mutex> lock(m_mr_mutex);
+  auto it = m_mr_references.find(mr);
+  if (it == std::end(m_mr_references) || --it->second) {
+    return;
+  }
+  m_mr_references.erase(it);
+  m_mrs.erase(mr);
+  fi_close(&mr->fid);
+}
+
+fabric_ptr<fid_mr> Domain::register_memory(
+    void* buffer,
+    size_t size,
+    uint64_t access) {
+  uint64_t key;
+  {
+    std::lock_guard<std::mutex> lock(m_mr_mutex);
+    // The key 0 is left to the cached registrations
+    key = ++m_mr_key;
+  }
+  fid_mr* mr;
+  int rc = fi_mr_reg(m_domain.get(),
+      buffer,
+      size,
+      access,
+      0 /* offset, must be 0 */,
+      key,
+      0 /* flags, must be 0 */,
+      &mr,
+      0 /* context */);
+  if (rc) {
+    throw lseb::exception::socket::generic_error(
+        "Error on fi_mr_reg: " + std::string(fi_strerror(-rc)));
+  }
+  return fabric_ptr<fid_mr> { mr };
+}
+
+uint64_t Domain::remote_address(void* buffer) const {
+  // With FI_MR_SCALABLE the address is an offset into the registration
+  return m_mr_basic ? reinterpret_cast<uint64_t>(buffer) : 0;
+}
+
+bool Domain::rx_cq_data() const {
+  return m_rx_cq_data;
+}
+
 }
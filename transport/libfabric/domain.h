@@ -1,13 +1,17 @@
 #ifndef LSEB_DOMAIN_HPP
 #define LSEB_DOMAIN_HPP
 
+#include <map>
 #include <memory>
+#include <mutex>
+#include <string>
 #include "rdma/fabric.h"
 #include "shared.h"
+#include "transport/memory_regions.h"
 
 namespace lseb {
 
-/* Singleton class */
+/* One instance for each domain (network interface), opened on first use */
 
 /* NOTE: Already opened fabric and domain can be retrieved with fi_getinfo */
 
@@ -18,7 +22,15 @@ class Domain {
   typedef fabric_ptr<fid_domain> domain_ptr;
   typedef fabric_ptr<fi_info> info_ptr;
 
-  static Domain& get_instance();
+  // The empty name is the first domain of the provider. The endpoints must
+  // be opened on the domain named in the fi_info of their address, so that
+  // the several interfaces of a node are used through their own domains.
+  // The domains of reliable unconnected endpoints (FI_EP_RDM) are distinct,
+  // since they may come from a utility provider layered on the core one, and
+  // so are those of the datagram endpoints (FI_EP_DGRAM).
+  static Domain& get_instance(
+      std::string const& name = std::string(),
+      fi_ep_type type = FI_EP_MSG);
   Domain(Domain const&) = delete;             // Copy construct
   Domain(Domain&&) = delete;                  // Move construct
   Domain& operator=(Domain const&) = delete;  // Copy assign
@@ -29,15 +41,43 @@ class Domain {
   fab_ptr const& get_fabric() const;
   fid_fabric* get_raw_fabric() const;
   fi_info* get_hints() const;
+  std::string const& get_name() const;
+
+  // Memory registrations are shared by all the endpoints of the domain, so
+  // that a buffer used with many peers is registered only once. They are
+  // reference counted and closed together with the last endpoint.
+  fid_mr* acquire_memory_region(void* buffer, size_t size);
+  void release_memory_region(fid_mr* mr);
+
+  // Registrations owned by the caller, not cached. Each one gets its own key,
+  // which identifies the region with FI_MR_SCALABLE.
+  fabric_ptr<fid_mr> register_memory(
+      void* buffer,
+      size_t size,
+      uint64_t access);
+  // Address used by a peer to access buffer, the beginning of a registration
+  uint64_t remote_address(void* buffer) const;
+  // Whether the immediate data of a remote write consumes a receive
+  bool rx_cq_data() const;
 
  private:
-  Domain();
+  Domain(std::string const& name, fi_ep_type type);
   ~Domain() = default;
+  friend struct std::default_delete<Domain>;
 
+  std::string m_name;
   fab_ptr m_fabric;
   domain_ptr m_domain;
   info_ptr m_hints;
 
+  std::mutex m_mr_mutex;
+  MemoryRegions<fid_mr*> m_mrs;
+  std::map<fid_mr*, int> m_mr_references;
+  uint64_t m_mr_key;
+
+  bool m_mr_basic;
+  bool m_rx_cq_data;
+
 };
 
 }
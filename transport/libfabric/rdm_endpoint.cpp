@@ -0,0 +1,149 @@
+#include "transport/libfabric/rdm_endpoint.h"
+
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <rdma/fi_cm.h>
+#include <rdma/fi_endpoint.h>
+#include <rdma/fi_errno.h>
+
+#include "common/exception.h"
+
+namespace lseb {
+
+RdmEndpoint::RdmEndpoint(
+    char const* hostname,
+    char const* port,
+    std::shared_ptr<CompletionQueue> const& cq,
+    bool selective_completion)
+    : m_domain(nullptr),
+      m_cq(cq) {
+
+  fi_info* info_p;
+  int rc = fi_getinfo(
+      FI_VERSION(1, 3),
+      hostname,
+      port,
+      hostname ? FI_SOURCE : 0,
+      Domain::get_instance(std::string(), FI_EP_RDM).get_hints(),
+      &info_p);
+  if (rc) {
+    throw exception::connection::generic_error(
+        "Error on fi_getinfo: " + std::string(fi_strerror(-rc)));
+  }
+  fabric_ptr<fi_info> info { info_p };
+
+  m_domain = &Domain::get_instance(info->domain_attr->name, FI_EP_RDM);
+
+  fid_ep* ep_raw;
+  rc = fi_endpoint(m_domain->get_raw_domain(), info.get(), &ep_raw, NULL);
+  if (rc) {
+    throw exception::connection::generic_error(
+        "Error on fi_endpoint: " + std::string(fi_strerror(-rc)));
+  }
+  fabric_ptr<fid_ep> ep { ep_raw };
+
+  m_cq->create(*m_domain);
+  bind_completion_queues(
+      ep,
+      m_cq->rx_cq(),
+      m_cq->tx_cq(),
+      selective_completion);
+
+  fi_av_attr av_attr;
+  std::memset(&av_attr, 0, sizeof av_attr);
+  av_attr.type = FI_AV_TABLE;
+  fid_av* av_raw;
+  rc = fi_av_open(m_domain->get_raw_domain(), &av_attr, &av_raw, NULL);
+  if (rc) {
+    throw exception::connection::generic_error(
+        "Error on fi_av_open: " + std::string(fi_strerror(-rc)));
+  }
+  m_av.reset(av_raw);
+
+  rc = fi_ep_bind(ep.get(), &m_av->fid, 0);
+  if (rc) {
+    throw exception::connection::generic_error(
+        "Error on fi_ep_bind av: " + std::string(fi_strerror(-rc)));
+  }
+
+  rc = fi_enable(ep.get());
+  if (rc) {
+    throw exception::connection::generic_error(
+        "Error on fi_enable: " + std::string(fi_strerror(-rc)));
+  }
+  m_ep = std::move(ep);
+}
+
+Domain& RdmEndpoint::domain() const {
+  return *m_domain;
+}
+
+fid_ep* RdmEndpoint::ep() const {
+  return m_ep.get();
+}
+
+std::shared_ptr<CompletionQueue> const& RdmEndpoint::cq() const {
+  return m_cq;
+}
+
+Hello RdmEndpoint::hello() const {
+  Hello hello;
+  std::memset(&hello, 0, sizeof hello);
+  size_t size = sizeof hello.address;
+  int rc = fi_getname(&m_ep->fid, hello.address, &size);
+  if (rc) {
+    throw exception::connection::generic_error(
+        "Error on fi_getname: " + std::string(fi_strerror(-rc)));
+  }
+  hello.size = size;
+  return hello;
+}
+
+fi_addr_t RdmEndpoint::insert(void const* address) {
+  fi_addr_t peer;
+  int rc = fi_av_insert(m_av.get(), address, 1, &peer, 0, NULL);
+  if (rc != 1) {
+    throw exception::connection::generic_error(
+        "Error on fi_av_insert: "
+            + std::string(rc < 0 ? fi_strerror(-rc) : "address not inserted"));
+  }
+  return peer;
+}
+
+fi_addr_t RdmEndpoint::resolve(
+    std::string const& hostname,
+    std::string const& port) {
+  fi_info* info_p;
+  int rc = fi_getinfo(
+      FI_VERSION(1, 3),
+      hostname.c_str(),
+      port.c_str(),
+      0,
+      m_domain->get_hints(),
+      &info_p);
+  if (rc) {
+    throw exception::connection::generic_error(
+        "Error on fi_getinfo: " + std::string(fi_strerror(-rc)));
+  }
+  fabric_ptr<fi_info> info { info_p };
+  return insert(info->dest_addr);
+}
+
+std::string RdmEndpoint::hostname(fi_addr_t peer) const {
+  sockaddr_in addr;
+  size_t len = sizeof addr;
+  char str[INET_ADDRSTRLEN];
+  if (fi_av_lookup(m_av.get(), peer, &addr, &len)
+      || !inet_ntop(AF_INET, &addr.sin_addr, str, INET_ADDRSTRLEN)) {
+    return std::string();
+  }
+  return str;
+}
+
+std::mutex& RdmEndpoint::mutex() {
+  return m_mutex;
+}
+
+}
@@ -0,0 +1,77 @@
+#ifndef TRANSPORT_LIBFABRIC_RDM_ENDPOINT_H
+#define TRANSPORT_LIBFABRIC_RDM_ENDPOINT_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <cstdint>
+
+#include <rdma/fabric.h>
+#include <rdma/fi_domain.h>
+
+#include "shared.h"
+#include "domain.h"
+#include "transport/libfabric/completion_queue.h"
+
+namespace lseb {
+
+namespace rdm {
+// Longest address of an endpoint
+static const size_t ADDRESS_SIZE = 64;
+}
+
+// Introduction of a connector to an acceptor, which does not know its
+// address, and answer of the acceptor once it can receive from it
+struct Hello {
+  uint64_t size;
+  unsigned char address[rdm::ADDRESS_SIZE];
+};
+
+// Reliable unconnected endpoint (FI_EP_RDM) shared by all the sockets of an
+// acceptor or of a connector: the peers are inserted into its address vector
+// and the completions of all of them are reported to a single queue, so that
+// the resources of a node do not grow with the number of peers.
+
+class RdmEndpoint {
+ public:
+  // Bound to hostname and port, if given, so that the peers can resolve its
+  // address. With a signal interval greater than one, the transmit queue is
+  // bound with FI_SELECTIVE_COMPLETION.
+  RdmEndpoint(
+      char const* hostname,
+      char const* port,
+      std::shared_ptr<CompletionQueue> const& cq,
+      bool selective_completion);
+  RdmEndpoint(RdmEndpoint const& other) = delete;
+  RdmEndpoint& operator=(RdmEndpoint const&) = delete;
+  ~RdmEndpoint() = default;
+
+  Domain& domain() const;
+  fid_ep* ep() const;
+  std::shared_ptr<CompletionQueue> const& cq() const;
+
+  // Introduction carrying the address of this endpoint
+  Hello hello() const;
+
+  // Insert a peer into the address vector, either by its address or by the
+  // hostname and port of its bound endpoint
+  fi_addr_t insert(void const* address);
+  fi_addr_t resolve(std::string const& hostname, std::string const& port);
+  std::string hostname(fi_addr_t peer) const;
+
+  // Serializes the introductions of the connectors sharing the endpoint
+  std::mutex& mutex();
+
+ private:
+  // NOTE: Declarations sorted by deconstruction requirements
+  Domain* m_domain;
+  std::shared_ptr<CompletionQueue> m_cq;
+  fabric_ptr<fid_av> m_av;
+  fabric_ptr<fid_ep> m_ep;
+  std::mutex m_mutex;
+};
+
+}
+
+#endif
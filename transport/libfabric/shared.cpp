@@ -4,7 +4,6 @@
 
 #include "rdma/fi_errno.h"
 
-#include "domain.h"
 #include "common/exception.h"
 
 namespace lseb {
@@ -51,59 +50,80 @@ void read_event(
 
 void bind_completion_queues(
     fabric_ptr<fid_ep> const& ep,
+    fid_domain* domain,
     fabric_ptr<fid_cq>& rx,
     fabric_ptr<fid_cq>& tx,
-    uint32_t size) {
+    uint32_t size,
+    bool selective_completion,
+    bool wait) {
 
-  lseb::Domain& d = lseb::Domain::get_instance();
+  /* Create Completion queues */
+  rx = open_completion_queue(domain, size, wait);
+  tx = open_completion_queue(domain, size, wait);
+
+  bind_completion_queues(ep, rx.get(), tx.get(), selective_completion);
+}
+
+fabric_ptr<fid_cq> open_completion_queue(
+    fid_domain* domain,
+    uint32_t size,
+    bool wait) {
 
   fi_cq_attr cq_attr;
   std::memset(&cq_attr, 0, sizeof cq_attr);
 
-  cq_attr.format = FI_CQ_FORMAT_CONTEXT; // see https://ofiwg.github.io/libfabric/master/man/fi_cq.3.html for other formats (with more informations)
-  cq_attr.wait_obj = FI_WAIT_NONE;
+  // The data format carries the immediate data of the remote writes and,
+  // like the message format, the length of the received messages
+  cq_attr.format = FI_CQ_FORMAT_DATA; // see https://ofiwg.github.io/libfabric/master/man/fi_cq.3.html for other formats (with more informations)
+  cq_attr.wait_obj = wait ? FI_WAIT_FD : FI_WAIT_NONE;
   cq_attr.size = size;
 
-  /* Create Completion queues */
-  fid_cq *rx_raw, *tx_raw;
-  int rc = fi_cq_open(d.get_raw_domain(), &cq_attr, &rx_raw, NULL);
+  fid_cq* cq_raw;
+  int rc = fi_cq_open(domain, &cq_attr, &cq_raw, NULL);
   if (rc) {
     throw lseb::exception::connection::generic_error(
-        "Error on fi_cq_open rx: " + std::string(fi_strerror(-rc)));
+        "Error on fi_cq_open: " + std::string(fi_strerror(-rc)));
   }
-  rx.reset(rx_raw);
+  return fabric_ptr<fid_cq> { cq_raw };
+}
 
-  rc = fi_cq_open(d.get_raw_domain(), &cq_attr, &tx_raw, NULL);
-  if (rc) {
-    throw lseb::exception::connection::generic_error(
-        "Error on fi_cq_open tx: " + std::string(fi_strerror(-rc)));
-  }
-  tx.reset(tx_raw);
+void bind_completion_queues(
+    fabric_ptr<fid_ep> const& ep,
+    fid_cq* rx,
+    fid_cq* tx,
+    bool selective_completion) {
 
   /* Bind Completion queues */
-  rc = fi_ep_bind(ep.get(), &rx->fid, FI_RECV);
+  int rc = fi_ep_bind(ep.get(), &rx->fid, FI_RECV);
   if (rc) {
     throw lseb::exception::connection::generic_error(
         "Error on fi_ep_bind rx: " + std::string(fi_strerror(-rc)));
   }
 
-  rc = fi_ep_bind(ep.get(), &tx->fid, FI_SEND);
+  // With selective completion only the sends posted with FI_COMPLETION
+  // generate an entry in the transmit queue
+  uint64_t tx_flags = FI_SEND;
+  if (selective_completion) {
+    tx_flags |= FI_SELECTIVE_COMPLETION;
+  }
+  rc = fi_ep_bind(ep.get(), &tx->fid, tx_flags);
   if (rc) {
     throw lseb::exception::connection::generic_error(
         "Error on fi_ep_bind tx: " + std::string(fi_strerror(-rc)));
   }
 }
 
-void bind_event_queue(fabric_ptr<fid_ep> const& ep, fabric_ptr<fid_eq>& eq) {
-
-  lseb::Domain& d = lseb::Domain::get_instance();
+void bind_event_queue(
+    fabric_ptr<fid_ep> const& ep,
+    fid_fabric* fabric,
+    fabric_ptr<fid_eq>& eq) {
 
   fi_eq_attr cm_attr;
   std::memset(&cm_attr, 0, sizeof cm_attr);
   cm_attr.wait_obj = FI_WAIT_FD;
 
   fid_eq* eq_raw;
-  int rc = fi_eq_open(d.get_raw_fabric(), &cm_attr, &eq_raw, NULL);
+  int rc = fi_eq_open(fabric, &cm_attr, &eq_raw, NULL);
   if (rc) {
     throw lseb::exception::connection::generic_error(
         "Error on fi_eq_open: " + std::string(fi_strerror(-rc)));
@@ -117,5 +137,46 @@ void bind_event_queue(fabric_ptr<fid_ep> const& ep, fabric_ptr<fid_eq>& eq) {
   }
 }
 
+std::vector<int> wait_fds(fid_cq* rx, fid_cq* tx) {
+  std::vector<int> fds;
+  for (fid_cq* cq : {rx, tx}) {
+    int fd;
+    int rc = fi_control(&cq->fid, FI_GETWAIT, &fd);
+    if (rc) {
+      throw lseb::exception::connection::generic_error(
+          "Error on fi_control: " + std::string(fi_strerror(-rc)));
+    }
+    fds.push_back(fd);
+  }
+  return fds;
+}
+
+bool try_wait(fid_fabric* fabric, fid_cq* rx, fid_cq* tx) {
+  fid* fids[] = { &rx->fid, &tx->fid };
+  int rc = fi_trywait(fabric, fids, 2);
+  if (rc && rc != -FI_EAGAIN) {
+    throw lseb::exception::connection::generic_error(
+        "Error on fi_trywait: " + std::string(fi_strerror(-rc)));
+  }
+  return !rc;
 }
 
+size_t read_completions(fid_cq* cq, fi_cq_data_entry* entries, size_t count) {
+  auto ret = fi_cq_read(cq, entries, count);
+  if (ret >= 0 || ret == -FI_EAGAIN) {
+    return ret < 0 ? 0 : ret;
+  }
+
+  fi_cq_err_entry cq_err;
+  const char *err = nullptr;
+  if (ret == -FI_EAVAIL) {
+    fi_cq_readerr(cq, &cq_err, 0 /* flags not documented */);
+    err = fi_cq_strerror(cq, cq_err.err, cq_err.err_data, nullptr, 0);
+  } else {
+    err = fi_strerror(static_cast<int>(-ret));
+  }
+  throw lseb::exception::socket::generic_error(
+      "Error on fi_cq_read: " + std::string(err));
+}
+
+}
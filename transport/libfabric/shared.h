@@ -3,6 +3,7 @@
 
 #include <type_traits>
 #include <memory>
+#include <vector>
 #include <rdma/fabric.h>
 #include <rdma/fi_domain.h>
 #include <rdma/fi_endpoint.h>
@@ -43,12 +44,38 @@ void read_event(
     fabric_ptr<fid_eq> const& eq,
     fi_eq_cm_entry *entry,
     uint32_t event);
+// The queues are opened on the domain of the endpoint. With wait, they are
+// opened with FI_WAIT_FD.
 void bind_completion_queues(
     fabric_ptr<fid_ep> const& ep,
+    fid_domain* domain,
     fabric_ptr<fid_cq>& rx,
     fabric_ptr<fid_cq>& tx,
-    uint32_t size);
-void bind_event_queue(fabric_ptr<fid_ep> const& ep, fabric_ptr<fid_eq>& eq);
+    uint32_t size,
+    bool selective_completion = false,
+    bool wait = false);
+// Completion queues shared by several endpoints are opened once and then
+// bound to each of them
+fabric_ptr<fid_cq> open_completion_queue(
+    fid_domain* domain,
+    uint32_t size,
+    bool wait = false);
+void bind_completion_queues(
+    fabric_ptr<fid_ep> const& ep,
+    fid_cq* rx,
+    fid_cq* tx,
+    bool selective_completion = false);
+void bind_event_queue(
+    fabric_ptr<fid_ep> const& ep,
+    fid_fabric* fabric,
+    fabric_ptr<fid_eq>& eq);
+// Descriptors of completion queues opened with FI_WAIT_FD
+std::vector<int> wait_fds(fid_cq* rx, fid_cq* tx);
+// Whether the queues can be waited for, after which they notify the next
+// completion, or some completions are available already
+bool try_wait(fid_fabric* fabric, fid_cq* rx, fid_cq* tx);
+// Read the available completions, throwing on an error entry
+size_t read_completions(fid_cq* cq, fi_cq_data_entry* entries, size_t count);
 
 }
 
@@ -3,64 +3,243 @@
 #include <algorithm>
 #include <array>
 #include <cassert>
+#include <cstring>
 #include <arpa/inet.h>
 #include <rdma/fi_cm.h>
 #include <rdma/fi_errno.h>
+#include <rdma/fi_rma.h>
 #include "common/exception.h"
 #include "domain.h"
 
-#ifdef FI_VERBS
-namespace {
-  bool is_in_mr(iovec const& iov, lseb::Socket::memory_region const& mr) {
-    return
-    mr.begin <= iov.iov_base
-    && mr.end >= static_cast<unsigned char *>(iov.iov_base) + iov.iov_len;
-  }
-}
-#endif
-
 namespace lseb {
-#ifdef FI_VERBS
-MemoryRegion::MemoryRegion(void* buffer, size_t size)
-: begin(static_cast<unsigned char*>(buffer)), end(begin + size) {
-  fid_mr* mr_raw;
-  auto ret = fi_mr_reg(Domain::get_instance().get_raw_domain(),
-      buffer,
-      size,
-      FI_SEND | FI_RECV,
-      0 /* offset, must be 0 */,
-      0 /* requested key */,
-      0 /* flags, must be 0 */,
-      &mr_raw,
-      0 /* context */);
-  if (ret) {
+
+SharedReceiveQueue::SharedReceiveQueue(Domain& domain, uint32_t size)
+    : pending(size) {
+  fi_rx_attr attr;
+  std::memset(&attr, 0, sizeof attr);
+  attr.size = size;
+  attr.iov_limit = 1;
+  fid_ep* srx_raw;
+  int rc = fi_srx_context(
+      domain.get_raw_domain(),
+      &attr,
+      &srx_raw,
+      NULL);
+  if (rc) {
     throw exception::socket::generic_error(
-        "Error on fi_mr_reg: "
-        + std::string(fi_strerror(static_cast<int>(-ret))));
+        "Error on fi_srx_context: " + std::string(fi_strerror(-rc)));
   }
-  mr.reset(mr_raw);
+  srx.reset(srx_raw);
 }
-#endif
 
-Socket::Socket(fid_ep* ep, fid_cq* rx_cq, fid_cq* tx_cq, uint32_t credits)
-    : m_ep(ep),
+Socket::Socket(
+    Domain& domain,
+    fid_ep* ep,
+    fid_cq* rx_cq,
+    fid_cq* tx_cq,
+    uint32_t credits,
+    int signal_interval,
+    std::shared_ptr<SharedReceiveQueue> const& srq,
+    std::shared_ptr<CompletionQueue> const& cq,
+    bool wait)
+    : m_domain(&domain),
+      m_srq(srq),
+      m_cq(cq),
+      m_ep(ep),
+      m_peer(0),
       m_rx_cq(rx_cq),
       m_tx_cq(tx_cq),
       m_credits(credits),
+      m_wait(wait),
+      m_pending_send(m_credits),
+      m_pending_recv(m_credits),
+      m_signal_interval(signal_interval),
+      m_unsignaled(0),
+      m_send_order(m_credits),
       m_comp_send(m_credits),
-      m_comp_recv(m_credits) {
+      m_comp_recv(m_credits),
+      m_tag(0),
+      m_updates_sent(0),
+      m_updates_done(0),
+      m_update_pending(false) {
+  if (m_cq) {
+    m_recv_done.reserve(m_srq ? m_srq->pending.capacity() : m_credits);
+    m_tag = m_cq->attach(this);
+  }
+}
+
+Socket::Socket(
+    std::shared_ptr<RdmEndpoint> const& rdm,
+    fi_addr_t peer,
+    uint32_t credits,
+    int signal_interval)
+    : Socket(
+        rdm->domain(),
+        nullptr,
+        nullptr,
+        nullptr,
+        credits,
+        signal_interval,
+        nullptr,
+        rdm->cq()) {
+  m_rdm = rdm;
+  m_peer = peer;
+}
+
+Socket::~Socket() {
+  // The receives still posted to a shared endpoint would complete into
+  // buffers no longer owned by the socket
+  if (m_rdm) {
+    for (uint32_t i = 0; i < m_pending_recv.capacity(); ++i) {
+      fi_cancel(&m_rdm->ep()->fid, context(i));
+    }
+  }
+  if (m_cq) {
+    m_cq->detach(m_tag);
+  }
+#ifdef FI_VERBS
+  m_mrs.for_each([this](fid_mr* mr) {
+    m_domain->release_memory_region(mr);
+  });
+#endif
+}
+
+void* Socket::context(uint32_t index) const {
+  // The tag identifies the socket in a shared completion queue
+  return reinterpret_cast<void*>(
+      (static_cast<uintptr_t>(m_tag) << 32) | index);
+}
+
+fid_ep* Socket::endpoint() const {
+  return m_rdm ? m_rdm->ep() : m_ep.get();
+}
+
+void Socket::enable_write_ring(bool writer) {
+  if (m_cq) {
+    throw exception::socket::generic_error(
+        "Error on enable_write_ring: shared completion queue");
+  }
+  m_updates.resize(write_ring::UPDATES);
+  m_updates_mr = m_domain->register_memory(
+      m_updates.data(),
+      m_updates.size() * sizeof(RingUpdate),
+      FI_SEND | FI_RECV);
+
+  if (writer) {
+    m_ring_writer.reset(new RingWriter);
+    for (uint32_t i = 0; i < m_updates.size(); ++i) {
+      post_update_recv(i);
+    }
+  } else {
+    m_ring_receiver.reset(new RingReceiver);
+  }
+}
+
+void Socket::post_write_recvs(size_t n) {
+  // With FI_RX_CQ_DATA a write with remote CQ data consumes a receive,
+  // posted without buffers
+  if (!m_domain->rx_cq_data()) {
+    return;
+  }
+  for (size_t i = 0; i < n; ++i) {
+    fi_msg msg;
+    msg.msg_iov = nullptr;
+    msg.desc = nullptr;
+    msg.iov_count = 0;
+    msg.addr = m_peer; /* src_address */
+    msg.context = context(0);
+    msg.data = 0;
+    auto ret = fi_recvmsg(endpoint(), &msg, (i + 1 < n) ? FI_MORE : 0);
+    if (ret) {
+      throw exception::socket::generic_error(
+          "Error on fi_recvmsg: "
+              + std::string(fi_strerror(static_cast<int>(-ret))));
+    }
+  }
+}
+
+void Socket::post_update_recv(uint32_t index) {
+  void* desc = fi_mr_desc(m_updates_mr.get());
+  auto ret = fi_recv(
+      endpoint(),
+      &m_updates[index],
+      sizeof(RingUpdate),
+      desc,
+      m_peer /* src_address */,
+      context(index));
+  if (ret) {
+    throw exception::socket::generic_error(
+        "Error on fi_recv: "
+            + std::string(fi_strerror(static_cast<int>(-ret))));
+  }
+}
+
+void Socket::send_update() {
+  // Only the latest update matters: if all are in flight, it is sent as soon
+  // as one of them completes
+  if (m_updates_sent - m_updates_done == m_updates.size()) {
+    m_update_pending = true;
+    return;
+  }
+  m_update_pending = false;
+  uint32_t const index = m_updates_sent % m_updates.size();
+  m_updates[index] = m_ring_receiver->update();
+
+  void* desc = fi_mr_desc(m_updates_mr.get());
+  auto ret = fi_send(
+      endpoint(),
+      &m_updates[index],
+      sizeof(RingUpdate),
+      desc,
+      m_peer /* dest_address */,
+      context(index));
+  if (ret) {
+    throw exception::socket::generic_error(
+        "Error on fi_send: "
+            + std::string(fi_strerror(static_cast<int>(-ret))));
+  }
+  ++m_updates_sent;
 }
 
 void Socket::register_memory(void* buffer, size_t size) {
 #ifdef FI_VERBS
-  m_mrs.emplace_back(buffer, size);  // it implicitly calls the constructor of MemoryRegion
+  if (!m_mrs.find(buffer, size)) {
+    m_mrs.insert(
+        buffer,
+        size,
+        m_domain->acquire_memory_region(buffer, size));
+  }
 #endif
 }
 
-std::vector<iovec> Socket::poll_completed_send() {
-  std::vector<iovec> iov_vect;
+size_t Socket::poll_completed_send(iovec* iov, size_t n) {
+  // The writer gets the updates of the ring while polling its writes
+  if (m_ring_writer) {
+    size_t const ret = read_completions(
+        m_rx_cq.get(),
+        m_comp_recv.data(),
+        m_comp_recv.size());
+    for (size_t i = 0; i < ret; ++i) {
+      uint32_t const index = static_cast<uint32_t>(
+          reinterpret_cast<uintptr_t>(m_comp_recv[i].op_context));
+      m_ring_writer->update(m_updates[index]);
+      post_update_recv(index);
+    }
+  }
+
+  // A completion can retire more sends than the space left in iov, the
+  // remaining ones are handed back in the next call
+  size_t count = 0;
+  uint32_t index;
+  while (count < n && m_send_order.pop(index)) {
+    iov[count++] = m_pending_send.release(index);
+  }
+  if (count == n || m_cq) {
+    return count;
+  }
 
-  auto ret = fi_cq_read(m_tx_cq.get(), m_comp_send.data(), m_comp_send.size());
+  auto ret = fi_cq_read(m_tx_cq.get(), m_comp_send.data(),
+      std::min(n - count, m_comp_send.size()));
 
   fi_cq_err_entry cq_err;
   const char *err = nullptr;
@@ -68,7 +247,7 @@ std::vector<iovec> Socket::poll_completed_send() {
   if (ret < 0) {
     switch (ret) {
       case -FI_EAGAIN:
-        return iov_vect;
+        return count;
       case -FI_EAVAIL:
         fi_cq_readerr(m_tx_cq.get(), &cq_err, 0 /* flags not documented */);
         err = fi_cq_strerror(
@@ -86,28 +265,59 @@ std::vector<iovec> Socket::poll_completed_send() {
         "Error on fi_cq_read: " + std::string(err));
   }
 
-  iov_vect.reserve(static_cast<decltype(iov_vect)::size_type>(ret));
-
-  // Note: Is safe to store the map_end iterator because the erase function
-  //       invalidates only references and iterators to the erased element
-  auto map_end = std::end(m_pending_send);
-  for (auto it = std::begin(m_comp_send), end = it + ret; it != end; ++it) {
-    auto map_it = m_pending_send.find(it->op_context);
-    if (map_it == map_end) {
-      throw exception::socket::generic_error(
-          "Error on find: key element not exists");
-    }
-    iov_vect.push_back( { map_it->first, map_it->second });
-    m_pending_send.erase(map_it);
+  for (ssize_t i = 0; i < ret; ++i) {
+    m_send_order.retire(static_cast<uint32_t>(
+        reinterpret_cast<uintptr_t>(m_comp_send[i].op_context)));
   }
 
-  return iov_vect;
+  while (count < n && m_send_order.pop(index)) {
+    iov[count++] = m_pending_send.release(index);
+  }
+  return count;
 }
 
-std::vector<iovec> Socket::poll_completed_recv() {
-  std::vector<iovec> iov_vect;
+size_t Socket::poll_completed_recv(iovec* iov, size_t n) {
+  if (m_ring_receiver) {
+    // The updates are the only sends of the receiver
+    m_updates_done += read_completions(
+        m_tx_cq.get(),
+        m_comp_send.data(),
+        m_comp_send.size());
+    if (m_update_pending) {
+      send_update();
+    }
+
+    size_t const ret = read_completions(
+        m_rx_cq.get(),
+        m_comp_recv.data(),
+        std::min(n, m_comp_recv.size()));
+    for (size_t i = 0; i < ret; ++i) {
+      if (!(m_comp_recv[i].flags & FI_REMOTE_CQ_DATA)) {
+        throw exception::socket::generic_error(
+            "Error on poll_completed_recv: write without remote CQ data");
+      }
+      iov[i] = m_ring_receiver->receive(
+          static_cast<uint32_t>(m_comp_recv[i].data));
+    }
+    post_write_recvs(ret);
+    return ret;
+  }
 
-  auto ret = fi_cq_read(m_rx_cq.get(), m_comp_recv.data(), m_comp_recv.size());
+  SlotArray& pending = m_srq ? m_srq->pending : m_pending_recv;
+  if (m_cq) {
+    size_t const count = std::min(n, m_recv_done.size());
+    for (size_t i = 0; i < count; ++i) {
+      iov[i] = pending.release(m_recv_done[i].first);
+      iov[i].iov_len = m_recv_done[i].second;
+    }
+    m_recv_done.erase(
+        std::begin(m_recv_done),
+        std::begin(m_recv_done) + count);
+    return count;
+  }
+
+  auto ret = fi_cq_read(m_rx_cq.get(), m_comp_recv.data(),
+      std::min(n, m_comp_recv.size()));
 
   fi_cq_err_entry cq_err;
   const char *err = nullptr;
@@ -115,7 +325,7 @@ std::vector<iovec> Socket::poll_completed_recv() {
   if (ret < 0) {
     switch (ret) {
       case -FI_EAGAIN:
-        return iov_vect;
+        return 0;
       case -FI_EAVAIL:
         fi_cq_readerr(m_rx_cq.get(), &cq_err, 0 /* flags not documented */);
         err = fi_cq_strerror(
@@ -133,137 +343,237 @@ std::vector<iovec> Socket::poll_completed_recv() {
         "Error on fi_cq_read: " + std::string(err));
   }
 
-  iov_vect.reserve(static_cast<decltype(iov_vect)::size_type>(ret));
-
-  // Note: Is safe to store the map_end iterator because the erase function
-  //       invalidates only references and iterators to the erased element
-  auto map_end = std::end(m_pending_recv);
-  for (auto it = std::begin(m_comp_recv), end = it + ret; it != end; ++it) {
-    auto map_it = m_pending_recv.find(it->op_context);
-    if (map_it == map_end) {
-      throw exception::socket::generic_error(
-          "Error on find: key element not exists");
-    }
-    iov_vect.push_back( { map_it->first, map_it->second });
-    m_pending_recv.erase(map_it);
+  // The buffer is reported with the length of the message received in it
+  for (ssize_t i = 0; i < ret; ++i) {
+    iov[i] = pending.release(static_cast<uint32_t>(
+        reinterpret_cast<uintptr_t>(m_comp_recv[i].op_context)));
+    iov[i].iov_len = m_comp_recv[i].len;
   }
 
-  return iov_vect;
+  return ret;
 }
 
 void Socket::post_send(iovec const& iov) {
-  if (!available_send()) {
+  // Sent with fi_sendmsg, which can request the completion of single sends
+  post_send(&iov, 1);
+}
+
+void Socket::post_recv(iovec const& iov) {
+  post_recv(&iov, 1);
+}
+
+void Socket::post_send(iovec const* iov, size_t n) {
+  if (m_pending_send.size() + n > m_credits) {
     throw exception::socket::generic_error(
         "Error on post_send: no credits available");
   }
-#ifdef FI_VERBS
-  auto mr_it = std::find_if(std::begin(m_mrs),
-      std::end(m_mrs),
-      [&iov](decltype(m_mrs)
-          ::const_reference m) -> bool {
-        return is_in_mr(iov, m);
-      });
-
-  assert(mr_it!=std::end(m_mrs)
-      && "Error on find_if: no valid memory region found");
-
-  auto ret = fi_send(m_ep.get(),
-      iov.iov_base,
-      iov.iov_len,
-      fi_mr_desc(mr_it->mr.get()),
-      0, /* dest_address */
-      iov.iov_base);/* context */
-#else // FI_TCP
-  auto ret = fi_send(m_ep.get(), iov.iov_base, iov.iov_len, nullptr, 0, /* dest_address */
-  iov.iov_base);/* context */
-#endif
 
-  if (ret) {
-    throw exception::socket::generic_error(
-        "Error on fi_recv: "
-            + std::string(fi_strerror(static_cast<int>(-ret))));
+  for (size_t i = 0; i < n; ++i) {
+    void* desc = memory_descriptor(iov[i]);
+    // FI_MORE tells the provider that other requests follow, so that it can
+    // defer the doorbell until the last one
+    post_message(&iov[i], &desc, 1, iov[i], (i + 1 < n) ? FI_MORE : 0);
   }
+}
 
-  auto p = m_pending_send.emplace(iov.iov_base, iov.iov_len);
-  if (!p.second) {
+void Socket::post_sendv(iovec const* iov, size_t n) {
+  if (m_pending_send.full()) {
     throw exception::socket::generic_error(
-        "Error on insert: key element already exists");
+        "Error on post_sendv: no credits available");
   }
-}
-
-void Socket::post_recv(iovec const& iov) {
-  if (!available_recv()) {
+  if (!n || n > MAX_SEND_SGE) {
     throw exception::socket::generic_error(
-        "Error on post_recv: no credits available");
+        "Error on post_sendv: wrong number of segments");
   }
 
-#ifdef FI_VERBS
+  void* desc[MAX_SEND_SGE];
+  iovec message = { iov[0].iov_base, 0 };
+  for (size_t i = 0; i < n; ++i) {
+    desc[i] = memory_descriptor(iov[i]);
+    message.iov_len += iov[i].iov_len;
+  }
+  post_message(iov, desc, n, message, 0);
+}
 
-  auto mr_it = std::find_if(std::begin(m_mrs),
-      std::end(m_mrs),
-      [&iov](decltype(m_mrs)
-          ::const_reference m) -> bool {
-        return is_in_mr(iov, m);
-      });
-
-  assert(mr_it!=std::end(m_mrs)
-      && "Error on find_if: no valid memory region found");
-
-  auto ret = fi_recv(m_ep.get(),
-      iov.iov_base,
-      iov.iov_len,
-      fi_mr_desc(mr_it->mr.get()),
-      0, /* src_address */
-      iov.iov_base);/* context */
+void* Socket::memory_descriptor(iovec const& iov) const {
+#ifdef FI_VERBS
+  fid_mr* const* mr = m_mrs.find(iov.iov_base, iov.iov_len);
+  assert(mr && "Error on find: no valid memory region found");
+  return fi_mr_desc(*mr);
 #else // FI_TCP
-  auto ret = fi_recv(m_ep.get(), iov.iov_base, iov.iov_len, nullptr, 0, /* src_address */
-  iov.iov_base);/* context */
+  return nullptr;
 #endif
+}
+
+void Socket::post_message(
+    iovec const* iov,
+    void** desc,
+    size_t n,
+    iovec const& message,
+    uint64_t flags) {
+  uint32_t const index = m_pending_send.acquire(message);
+
+  if (++m_unsignaled == m_signal_interval) {
+    flags |= FI_COMPLETION;
+    m_unsignaled = 0;
+  }
+  m_send_order.push(index);
+
+  ssize_t ret;
+  if (m_ring_writer) {
+    uint32_t immediate;
+    fi_rma_iov rma_iov;
+    rma_iov.addr = m_ring_writer->place(message.iov_len, immediate);
+    rma_iov.len = message.iov_len;
+    rma_iov.key = m_ring_writer->key();
+
+    fi_msg_rma msg;
+    msg.msg_iov = iov;
+    msg.desc = desc;
+    msg.iov_count = n;
+    msg.addr = m_peer; /* dest_address */
+    msg.rma_iov = &rma_iov;
+    msg.rma_iov_count = 1;
+    msg.context = context(index);
+    msg.data = immediate;
+    ret = fi_writemsg(endpoint(), &msg, flags | FI_REMOTE_CQ_DATA);
+  } else {
+    fi_msg msg;
+    msg.msg_iov = iov;
+    msg.desc = desc;
+    msg.iov_count = n;
+    msg.addr = m_peer; /* dest_address */
+    msg.context = context(index);
+    msg.data = 0;
+    ret = fi_sendmsg(endpoint(), &msg, flags);
+  }
   if (ret) {
+    m_pending_send.release(index);
+    m_send_order.rewind(1);
     throw exception::socket::generic_error(
-        "Error on fi_recv: "
+        (m_ring_writer ? "Error on fi_writemsg: " : "Error on fi_sendmsg: ")
             + std::string(fi_strerror(static_cast<int>(-ret))));
   }
+}
 
-  auto p = m_pending_recv.emplace(iov.iov_base, iov.iov_len);
-  if (!p.second) {
+void Socket::post_recv(iovec const* iov, size_t n) {
+  if (m_ring_receiver) {
+    if (m_ring_receiver->created()) {
+      for (size_t i = 0; i < n; ++i) {
+        m_ring_receiver->release(iov[i]);
+      }
+    } else {
+      if (n > m_credits) {
+        throw exception::socket::generic_error(
+            "Error on post_recv: no credits available");
+      }
+      size_t const slots = n * write_ring::MESSAGES_PER_BUFFER;
+      m_ring_receiver->create(iov, n, slots);
+      Domain& d = *m_domain;
+      m_ring_mr = d.register_memory(
+          m_ring_receiver->base(),
+          m_ring_receiver->size(),
+          FI_RECV | FI_REMOTE_WRITE);
+      m_ring_receiver->update().addr =
+          d.remote_address(m_ring_receiver->base());
+      m_ring_receiver->update().key = fi_mr_key(m_ring_mr.get());
+      post_write_recvs(slots);
+    }
+    send_update();
+    return;
+  }
+
+  SlotArray& pending = m_srq ? m_srq->pending : m_pending_recv;
+  fid_ep* const ep = m_srq ? m_srq->srx.get() : endpoint();
+  if (pending.size() + n > pending.capacity()) {
     throw exception::socket::generic_error(
-        "Error on insert: key element already exists");
+        "Error on post_recv: no credits available");
   }
 
+  for (size_t i = 0; i < n; ++i) {
+#ifdef FI_VERBS
+    fid_mr* const* mr = m_mrs.find(iov[i].iov_base, iov[i].iov_len);
+    assert(mr && "Error on find: no valid memory region found");
+    void* desc = fi_mr_desc(*mr);
+#else // FI_TCP
+    void* desc = nullptr;
+#endif
+    uint32_t const index = pending.acquire(iov[i]);
+
+    fi_msg msg;
+    msg.msg_iov = &iov[i];
+    msg.desc = &desc;
+    msg.iov_count = 1;
+    msg.addr = m_peer; /* src_address */
+    msg.context = context(index);
+    msg.data = 0;
+
+    // FI_MORE tells the provider that other requests follow, so that it can
+    // defer the doorbell until the last one
+    auto ret = fi_recvmsg(ep, &msg, (i + 1 < n) ? FI_MORE : 0);
+    if (ret) {
+      pending.release(index);
+      throw exception::socket::generic_error(
+          "Error on fi_recvmsg: "
+              + std::string(fi_strerror(static_cast<int>(-ret))));
+    }
+  }
 }
 
 bool Socket::available_send() {
-  return m_pending_send.size() < m_credits;
+  return !m_pending_send.full()
+      && (!m_ring_writer || m_ring_writer->available());
 }
 
 bool Socket::available_recv() {
-  return m_pending_recv.size() < m_credits;
+  if (m_ring_receiver) {
+    return !m_ring_receiver->created() || m_ring_receiver->held();
+  }
+  return !(m_srq ? m_srq->pending : m_pending_recv).full();
 }
 
 std::vector<iovec> Socket::pending_send() {
-  std::vector<iovec> iov_vect;
-  iov_vect.reserve(m_pending_send.size());
-  for (auto const& pair : m_pending_send) {
-    iov_vect.push_back( { pair.first, pair.second });
-  }
-  return iov_vect;
+  return m_pending_send.pending();
 }
 
 std::vector<iovec> Socket::pending_recv() {
-  std::vector<iovec> iov_vect;
-  iov_vect.reserve(m_pending_recv.size());
-  for (auto const& pair : m_pending_recv) {
-    iov_vect.push_back( { pair.first, pair.second });
+  if (m_ring_receiver) {
+    if (!m_ring_receiver->created()) {
+      return {};
+    }
+    return { {m_ring_receiver->base(), m_ring_receiver->size()} };
+  }
+  return (m_srq ? m_srq->pending : m_pending_recv).pending();
+}
+
+std::vector<int> Socket::wait_fds() {
+  if (m_cq) {
+    return m_cq->wait_fds();
   }
-  return iov_vect;
+  if (!m_wait) {
+    return {};
+  }
+  return lseb::wait_fds(m_rx_cq.get(), m_tx_cq.get());
+}
+
+bool Socket::arm_wait() {
+  if (m_cq) {
+    return m_cq->arm_wait();
+  }
+  return !m_wait || try_wait(
+      m_domain->get_raw_fabric(),
+      m_rx_cq.get(),
+      m_tx_cq.get());
 }
 
 std::string Socket::peer_hostname() {
+  if (m_rdm) {
+    return m_rdm->hostname(m_peer);
+  }
   char str[INET_ADDRSTRLEN];
   size_t len = sizeof(sockaddr_in);
   sockaddr_in addr[1];
-  fi_getpeer(m_ep.get(), reinterpret_cast<void *>(addr), &len);
+  fi_getpeer(endpoint(), reinterpret_cast<void *>(addr), &len);
   inet_ntop(AF_INET, &(addr->sin_addr), str, INET_ADDRSTRLEN);
   return str;
 }
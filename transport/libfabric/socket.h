@@ -2,76 +2,173 @@
 #define TRANSPORT_VERBS_SOCKET_H
 
 #include <memory>
-#include <unordered_map>
 #include <vector>
 #include <string>
 #include <tuple>
+#include <utility>
 
 #include <cstdint>
 
 #include <rdma/fabric.h>
 #include "shared.h"
+#include "domain.h"
+#include "transport/connection.h"
+#include "transport/libfabric/completion_queue.h"
+#include "transport/libfabric/rdm_endpoint.h"
+#include "transport/memory_regions.h"
+#include "transport/retire_queue.h"
+#include "transport/slot_array.h"
+#include "transport/write_ring.h"
 
 namespace lseb {
-#ifdef FI_VERBS
-struct MemoryRegion {
-  fabric_ptr<fid_mr> mr = nullptr;
-  unsigned char* begin;
-  unsigned char* end;
-  MemoryRegion(void* buffer, size_t size);
+
+// Receive context shared by all the endpoints of an acceptor, so that the
+// buffers are consumed by the peers that are sending instead of being reserved
+// to each one. The completions are still reported to the CQ of each endpoint.
+struct SharedReceiveQueue {
+  fabric_ptr<fid_ep> srx;
+  SlotArray pending;  // the index of the slot is used as context
+
+  SharedReceiveQueue(Domain& domain, uint32_t size);
 };
-#endif
 
-class Socket {
+class Socket : public Connection {
  public:
-#ifdef FI_VERBS
-  typedef MemoryRegion memory_region;
-#endif
-  Socket(fid_ep* ep, fid_cq* rx_cq, fid_cq* tx_cq, uint32_t credits);
+  // With a signal interval greater than one, the transmit CQ must be bound
+  // with FI_SELECTIVE_COMPLETION. Receives are posted to srq, if given,
+  // which ep must be bound to. If cq is given, ep must be bound to its
+  // queues, and rx_cq and tx_cq are null. With wait, rx_cq and tx_cq have
+  // been opened with FI_WAIT_FD. All of them belong to domain.
+  Socket(
+      Domain& domain,
+      fid_ep* ep,
+      fid_cq* rx_cq,
+      fid_cq* tx_cq,
+      uint32_t credits,
+      int signal_interval = 1,
+      std::shared_ptr<SharedReceiveQueue> const& srq = nullptr,
+      std::shared_ptr<CompletionQueue> const& cq = nullptr,
+      bool wait = false);
+  // Peer of a reliable unconnected endpoint: the operations are addressed to
+  // peer, or FI_ADDR_UNSPEC to receive from any, and the completions are
+  // handed over by the queue of rdm.
+  Socket(
+      std::shared_ptr<RdmEndpoint> const& rdm,
+      fi_addr_t peer,
+      uint32_t credits,
+      int signal_interval = 1);
   Socket(Socket const& other) = delete;
   Socket &operator=(Socket const&) = delete;
   Socket(Socket &&other) = default;
   Socket &operator=(Socket &&) = default;
-  ~Socket() = default;
+  ~Socket() override;
 
-  void register_memory(void* buffer, size_t size);
+  // One-sided mode: the messages are written with fi_writemsg and remote CQ
+  // data into a ring of the receiver, made of the buffers of its first
+  // post_recv, which must be contiguous. The following post_recv give back
+  // the space of the received messages, in the order in which they have been
+  // received. It must be called on both sides, before any other operation,
+  // and the sockets cannot share a completion queue.
+  void enable_write_ring(bool writer);
 
-  std::vector<iovec> poll_completed_send();
-  std::vector<iovec> poll_completed_recv();
+  void register_memory(void* buffer, size_t size) override;
 
-  void post_send(iovec const& iov);
-  void post_recv(iovec const& iov);
+  using Connection::poll_completed_send;
+  using Connection::poll_completed_recv;
+  size_t poll_completed_send(iovec* iov, size_t n) override;
+  size_t poll_completed_recv(iovec* iov, size_t n) override;
 
-  bool available_send();
-  bool available_recv();
+  void post_send(iovec const& iov) override;
+  void post_recv(iovec const& iov) override;
+  void post_send(iovec const* iov, size_t n) override;
+  void post_recv(iovec const* iov, size_t n) override;
+  void post_sendv(iovec const* iov, size_t n) override;
 
-  std::vector<iovec> pending_send();
-  std::vector<iovec> pending_recv();
+  bool available_send() override;
+  bool available_recv() override;
 
-  std::string peer_hostname();
+  std::vector<iovec> pending_send() override;
+  std::vector<iovec> pending_recv() override;
+
+  std::string peer_hostname() override;
+
+  std::vector<int> wait_fds() override;
+  bool arm_wait() override;
 
  private:
   // NOTE: Declarations sorted by deconstruction requirements
 
-  // Endpoint
+  // Domain of the endpoint, which outlives it
+  Domain* m_domain;
+
+  // Shared receive context and completion queues, closed after the
+  // endpoints bound to them
+  std::shared_ptr<SharedReceiveQueue> m_srq;
+  std::shared_ptr<CompletionQueue> m_cq;
+
+  // Endpoint, owned or shared with the other peers of rdm
+  std::shared_ptr<RdmEndpoint> m_rdm;
   fabric_ptr<fid_ep> m_ep;
+  fi_addr_t m_peer;
 
   // Completion Queues
   fabric_ptr<fid_cq> m_rx_cq;  // Receive CQ
   fabric_ptr<fid_cq> m_tx_cq;  // Transmit CQ
 
   uint32_t m_credits;  // CQ Depth
+  bool m_wait;
 #ifdef FI_VERBS
-  std::vector<memory_region> m_mrs;
+  MemoryRegions<fid_mr*> m_mrs;  // owned by the domain
 #endif
-  // TODO: Remove the unordered_map because we let the application store the
-  //       length of the registered buffers. Maybe an unordered_set is needed
-  std::unordered_map<void*, size_t> m_pending_send;
-  std::unordered_map<void*, size_t> m_pending_recv;
+  // The index of the slot is used as context of the operation
+  SlotArray m_pending_send;
+  SlotArray m_pending_recv;
+
+  // Only one send every m_signal_interval generates a completion
+  int m_signal_interval;
+  int m_unsignaled;
+  RetireQueue m_send_order;
 
   // Used as temporary buffer for reading completions from rx/tx queues
-  std::vector<fi_cq_entry> m_comp_send;
-  std::vector<fi_cq_entry> m_comp_recv;
+  std::vector<fi_cq_data_entry> m_comp_send;
+  std::vector<fi_cq_data_entry> m_comp_recv;
+
+  // With a shared completion queue, the completions are handed over by it:
+  // the sends are retired in m_send_order, the receives queued here with the
+  // length received
+  uint32_t m_tag;
+  std::vector<std::pair<uint32_t, size_t> > m_recv_done;
+
+  // With the write ring, only one of the two is set. The updates of the ring
+  // are sent from, or received into, the registered m_updates.
+  std::unique_ptr<RingWriter> m_ring_writer;
+  std::unique_ptr<RingReceiver> m_ring_receiver;
+  fabric_ptr<fid_mr> m_ring_mr;
+  std::vector<RingUpdate> m_updates;
+  fabric_ptr<fid_mr> m_updates_mr;
+  uint64_t m_updates_sent;
+  uint64_t m_updates_done;
+  bool m_update_pending;
+
+  friend class CompletionQueue;
+
+  void* context(uint32_t index) const;
+  fid_ep* endpoint() const;
+
+  void post_write_recvs(size_t n);
+  void post_update_recv(uint32_t index);
+  void send_update();
+
+  // Descriptor of the registered memory that holds iov, if needed
+  void* memory_descriptor(iovec const& iov) const;
+  // Send, or write into the ring, a message gathered from the n segments of
+  // iov, described by desc: message is what it reports on completion
+  void post_message(
+      iovec const* iov,
+      void** desc,
+      size_t n,
+      iovec const& message,
+      uint64_t flags);
 
 };
 
@@ -0,0 +1,46 @@
+#include "transport/local/acceptor.h"
+
+#include "common/exception.h"
+#include "transport/local/listeners.h"
+
+namespace lseb {
+
+namespace local {
+
+Acceptor::Acceptor(int credits)
+    : m_credits(credits) {
+}
+
+Acceptor::~Acceptor() {
+  if (!m_port.empty()) {
+    Listeners& l = Listeners::get_instance();
+    std::lock_guard<std::mutex> lock(l.mutex);
+    l.pending.erase(m_port);
+  }
+}
+
+void Acceptor::listen(std::string const& hostname, std::string const& port) {
+  Listeners& l = Listeners::get_instance();
+  std::lock_guard<std::mutex> lock(l.mutex);
+  if (!l.pending.emplace(port, std::deque<std::shared_ptr<Channel> >()).second) {
+    throw exception::acceptor::generic_error(
+        "Error on listen: port " + port + " already in use");
+  }
+  m_port = port;
+}
+
+std::unique_ptr<Socket> Acceptor::accept() {
+  Listeners& l = Listeners::get_instance();
+  std::unique_lock<std::mutex> lock(l.mutex);
+  auto& queue = l.pending.at(m_port);
+  l.cond.wait(lock, [&queue] {return !queue.empty();});
+  std::shared_ptr<Channel> channel = queue.front();
+  queue.pop_front();
+
+  std::unique_ptr<Socket> socket_ptr(new Socket(channel, m_credits, 1));
+  return socket_ptr;
+}
+
+}
+
+}
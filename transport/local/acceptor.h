@@ -0,0 +1,32 @@
+#ifndef TRANSPORT_LOCAL_ACCEPTOR_H
+#define TRANSPORT_LOCAL_ACCEPTOR_H
+
+#include <memory>
+#include <string>
+
+#include "transport/local/socket.h"
+
+namespace lseb {
+
+namespace local {
+
+class Acceptor {
+
+  uint32_t m_credits;
+  std::string m_port;
+
+ public:
+
+  Acceptor(int credits);
+  Acceptor(Acceptor const& other) = delete;  // non construction-copyable
+  Acceptor& operator=(Acceptor const&) = delete;  // non copyable
+  void listen(std::string const& hostname, std::string const& port);
+  ~Acceptor();
+  std::unique_ptr<Socket> accept();
+};
+
+}
+
+}
+
+#endif
@@ -0,0 +1,37 @@
+#include "transport/local/connector.h"
+
+#include "common/exception.h"
+#include "transport/local/listeners.h"
+
+namespace lseb {
+
+namespace local {
+
+Connector::Connector(int credits)
+    : m_credits(credits) {
+}
+
+std::unique_ptr<Socket> Connector::connect(
+    std::string const& hostname,
+    std::string const& port) {
+  std::shared_ptr<Channel> channel = std::make_shared<Channel>(m_credits);
+
+  Listeners& l = Listeners::get_instance();
+  {
+    std::lock_guard<std::mutex> lock(l.mutex);
+    auto it = l.pending.find(port);
+    if (it == std::end(l.pending)) {
+      throw exception::connector::generic_error(
+          "Error on connect: nobody listening on port " + port);
+    }
+    it->second.push_back(channel);
+  }
+  l.cond.notify_all();
+
+  std::unique_ptr<Socket> socket_ptr(new Socket(channel, m_credits, 0));
+  return socket_ptr;
+}
+
+}
+
+}
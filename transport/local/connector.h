@@ -0,0 +1,31 @@
+#ifndef TRANSPORT_LOCAL_CONNECTOR_H
+#define TRANSPORT_LOCAL_CONNECTOR_H
+
+#include <memory>
+#include <string>
+
+#include "transport/local/socket.h"
+
+namespace lseb {
+
+namespace local {
+
+class Connector {
+
+  uint32_t m_credits;
+
+ public:
+
+  Connector(int credits);
+  Connector(Connector const& other) = delete;  // non construction-copyable
+  Connector& operator=(Connector const&) = delete;  // non copyable
+  std::unique_ptr<Socket> connect(
+      std::string const& hostname,
+      std::string const& port);
+};
+
+}
+
+}
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef TRANSPORT_LOCAL_LISTENERS_H
+#define TRANSPORT_LOCAL_LISTENERS_H
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "transport/local/socket.h"
+
+namespace lseb {
+
+namespace local {
+
+// Process-wide table of the listening acceptors, indexed by port, with the
+// channels created by the connectors and not yet accepted
+
+struct Listeners {
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::map<std::string, std::deque<std::shared_ptr<Channel> > > pending;
+
+  static Listeners& get_instance() {
+    static Listeners instance;
+    return instance;
+  }
+};
+
+}
+
+}
+
+#endif
@@ -0,0 +1,166 @@
+#include "transport/local/socket.h"
+
+#include <algorithm>
+
+#include "common/exception.h"
+
+namespace lseb {
+
+namespace local {
+
+Channel::Channel(uint32_t credits) {
+  for (int i = 0; i < 2; ++i) {
+    sent[i].reset(new SpscQueue<Message>(credits));
+    returned[i].reset(new SpscQueue<iovec>(credits));
+  }
+}
+
+Socket::Socket(
+    std::shared_ptr<Channel> const& channel,
+    uint32_t credits,
+    int side)
+    : m_channel(channel),
+      m_credits(credits),
+      m_send_queue(*m_channel->sent[side]),
+      m_send_returned(*m_channel->returned[side]),
+      m_recv_queue(*m_channel->sent[1 - side]),
+      m_recv_returned(*m_channel->returned[1 - side]),
+      m_send_slots(m_credits),
+      m_send_head(0),
+      m_send_tail(0),
+      m_recv_slots(m_credits),
+      m_recv_head(0),
+      m_recv_tail(0),
+      m_delivered(m_credits),
+      m_delivered_head(0),
+      m_delivered_tail(0) {
+}
+
+void Socket::register_memory(void* buffer, size_t size) {
+  // Nothing to do: the memory is already shared by the two threads
+}
+
+size_t Socket::poll_completed_send(iovec* iov, size_t n) {
+  size_t i = 0;
+  iovec returned;
+  while (i < n && m_send_returned.pop(returned)) {
+    // Messages are given back in order, with the length of a receive buffer
+    iovec const& sent = m_send_slots[m_send_tail % m_credits];
+    if (sent.iov_base != returned.iov_base) {
+      throw exception::socket::generic_error(
+          "Error on poll_completed_send: message given back out of order");
+    }
+    iov[i++] = sent;
+    ++m_send_tail;
+  }
+  return i;
+}
+
+size_t Socket::poll_completed_recv(iovec* iov, size_t n) {
+  size_t i = 0;
+  Message message;
+  while (i < n && m_recv_tail != m_recv_head && m_recv_queue.pop(message)) {
+    ++m_recv_tail;
+    m_delivered[m_delivered_head++ % m_credits] = message;
+    iov[i] = { message.iov[0].iov_base, 0 };
+    for (size_t s = 0; s < message.n; ++s) {
+      iov[i].iov_len += message.iov[s].iov_len;
+    }
+    ++i;
+  }
+  return i;
+}
+
+void Socket::post_send(iovec const& iov) {
+  post_sendv(&iov, 1);
+}
+
+void Socket::post_sendv(iovec const* iov, size_t n) {
+  if (!n || n > MAX_SEND_SGE) {
+    throw exception::socket::generic_error(
+        "Error on post_sendv: wrong number of segments");
+  }
+  if (!available_send()) {
+    throw exception::socket::generic_error(
+        "Error on post_sendv: no credits available");
+  }
+
+  Message message;
+  iovec& slot = m_send_slots[m_send_head % m_credits];
+  slot = { iov[0].iov_base, 0 };
+  for (size_t i = 0; i < n; ++i) {
+    message.iov[i] = iov[i];
+    slot.iov_len += iov[i].iov_len;
+  }
+  message.n = n;
+  if (!m_send_queue.push(message)) {
+    throw exception::socket::generic_error(
+        "Error on push: send queue full");
+  }
+  ++m_send_head;
+}
+
+void Socket::post_recv(iovec const& iov) {
+  if (!available_recv()) {
+    throw exception::socket::generic_error(
+        "Error on post_recv: no credits available");
+  }
+
+  // Posting again a delivered message gives it back to the sender
+  if (m_delivered_tail != m_delivered_head
+      && m_delivered[m_delivered_tail % m_credits].iov[0].iov_base
+          == iov.iov_base) {
+    ++m_delivered_tail;
+    if (!m_recv_returned.push(iov)) {
+      throw exception::socket::generic_error(
+          "Error on push: return queue full");
+    }
+  }
+
+  m_recv_slots[m_recv_head++ % m_credits] = iov;
+}
+
+bool Socket::available_send() {
+  return m_send_head - m_send_tail < m_credits;
+}
+
+bool Socket::available_recv() {
+  return m_recv_head - m_recv_tail < m_credits;
+}
+
+std::vector<iovec> Socket::pending_send() {
+  std::vector<iovec> iov_vect;
+  iov_vect.reserve(m_send_head - m_send_tail);
+  for (uint64_t i = m_send_tail; i != m_send_head; ++i) {
+    iov_vect.push_back(m_send_slots[i % m_credits]);
+  }
+  return iov_vect;
+}
+
+std::vector<iovec> Socket::pending_recv() {
+  std::vector<iovec> iov_vect;
+  iov_vect.reserve(m_recv_head - m_recv_tail);
+  for (uint64_t i = m_recv_tail; i != m_recv_head; ++i) {
+    iov_vect.push_back(m_recv_slots[i % m_credits]);
+  }
+  return iov_vect;
+}
+
+std::string Socket::peer_hostname() {
+  return "localhost";
+}
+
+size_t Socket::received_segments(iovec const& message, iovec* iov) {
+  for (uint64_t i = m_delivered_tail; i != m_delivered_head; ++i) {
+    Message const& delivered = m_delivered[i % m_credits];
+    if (delivered.iov[0].iov_base == message.iov_base) {
+      std::copy(delivered.iov, delivered.iov + delivered.n, iov);
+      return delivered.n;
+    }
+  }
+  return Connection::received_segments(message, iov);
+}
+
+}
+
+}
@@ -0,0 +1,98 @@
+#ifndef TRANSPORT_LOCAL_SOCKET_H
+#define TRANSPORT_LOCAL_SOCKET_H
+
+#include <memory>
+#include <vector>
+#include <string>
+
+#include <cstdint>
+
+#include <sys/uio.h>
+
+#include "common/spsc_queue.h"
+#include "transport/connection.h"
+
+namespace lseb {
+
+namespace local {
+
+// Connection between two threads of the same process. Messages are not
+// copied: the receiver gets the segments posted by the sender and gives them
+// back by posting the message again as a receive, which completes the send.
+// A message gathered from several segments is delivered as its first one
+// with the whole length, see Connection::received_segments.
+
+struct Message {
+  iovec iov[MAX_SEND_SGE];
+  size_t n;
+};
+
+struct Channel {
+  // Indexed by direction: 0 from the connector, 1 from the acceptor
+  std::unique_ptr<SpscQueue<Message> > sent[2];
+  std::unique_ptr<SpscQueue<iovec> > returned[2];
+
+  explicit Channel(uint32_t credits);
+};
+
+class Socket : public Connection {
+
+  std::shared_ptr<Channel> m_channel;
+  uint32_t m_credits;
+  SpscQueue<Message>& m_send_queue;
+  SpscQueue<iovec>& m_send_returned;
+  SpscQueue<Message>& m_recv_queue;
+  SpscQueue<iovec>& m_recv_returned;
+
+  // As reported to the sender: the first segment, with the whole length
+  std::vector<iovec> m_send_slots;
+  uint64_t m_send_head;
+  uint64_t m_send_tail;
+
+  // Posted buffers are never filled, they only count as credits
+  std::vector<iovec> m_recv_slots;
+  uint64_t m_recv_head;
+  uint64_t m_recv_tail;
+
+  // Messages delivered and not yet given back to the sender
+  std::vector<Message> m_delivered;
+  uint64_t m_delivered_head;
+  uint64_t m_delivered_tail;
+
+ public:
+
+  // The connector uses side 0, the acceptor side 1
+  Socket(std::shared_ptr<Channel> const& channel, uint32_t credits, int side);
+  Socket(Socket const& other) = delete;  // non construction-copyable
+  Socket& operator=(Socket const&) = delete;  // non copyable
+  ~Socket() override = default;
+
+  void register_memory(void* buffer, size_t size) override;
+
+  using Connection::poll_completed_send;
+  using Connection::poll_completed_recv;
+  size_t poll_completed_send(iovec* iov, size_t n) override;
+  size_t poll_completed_recv(iovec* iov, size_t n) override;
+
+  using Connection::post_send;
+  using Connection::post_recv;
+  void post_send(iovec const& iov) override;
+  void post_recv(iovec const& iov) override;
+  void post_sendv(iovec const* iov, size_t n) override;
+
+  bool available_send() override;
+  bool available_recv() override;
+
+  std::vector<iovec> pending_send() override;
+  std::vector<iovec> pending_recv() override;
+
+  std::string peer_hostname() override;
+
+  size_t received_segments(iovec const& message, iovec* iov) override;
+};
+
+}
+
+}
+
+#endif
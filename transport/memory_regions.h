@@ -0,0 +1,97 @@
+#ifndef TRANSPORT_MEMORY_REGIONS_H
+#define TRANSPORT_MEMORY_REGIONS_H
+
+#include <algorithm>
+#include <vector>
+
+#include <cstdint>
+
+namespace lseb {
+
+// Registered memory regions sorted by address, so that the region containing
+// a buffer is found with a binary search. The region found last is checked
+// first, since consecutive buffers usually belong to the same region.
+
+template<typename T>
+class MemoryRegions {
+
+  struct Region {
+    uintptr_t begin;
+    uintptr_t end;
+    T handle;
+  };
+
+  std::vector<Region> m_regions;
+  mutable size_t m_last;
+
+  static bool contains(Region const& r, uintptr_t begin, uintptr_t end) {
+    return r.begin <= begin && end <= r.end;
+  }
+
+ public:
+  MemoryRegions()
+      : m_last(0) {
+  }
+
+  T const* find(void const* buffer, size_t size) const {
+    uintptr_t const begin = reinterpret_cast<uintptr_t>(buffer);
+    uintptr_t const end = begin + size;
+    if (m_last < m_regions.size() && contains(m_regions[m_last], begin, end)) {
+      return &m_regions[m_last].handle;
+    }
+    // First region starting after the buffer: the candidate is the previous
+    // one, unless regions overlap
+    auto it = std::upper_bound(
+        std::begin(m_regions),
+        std::end(m_regions),
+        begin,
+        [](uintptr_t addr, Region const& r) {return addr < r.begin;});
+    while (it != std::begin(m_regions)) {
+      --it;
+      if (contains(*it, begin, end)) {
+        m_last = it - std::begin(m_regions);
+        return &it->handle;
+      }
+    }
+    return nullptr;
+  }
+
+  void insert(void const* buffer, size_t size, T const& handle) {
+    uintptr_t const begin = reinterpret_cast<uintptr_t>(buffer);
+    Region const r = { begin, begin + size, handle };
+    auto it = std::upper_bound(
+        std::begin(m_regions),
+        std::end(m_regions),
+        begin,
+        [](uintptr_t addr, Region const& r) {return addr < r.begin;});
+    m_regions.insert(it, r);
+  }
+
+  bool erase(T const& handle) {
+    auto it = std::find_if(
+        std::begin(m_regions),
+        std::end(m_regions),
+        [&handle](Region const& r) {return r.handle == handle;});
+    if (it == std::end(m_regions)) {
+      return false;
+    }
+    m_regions.erase(it);
+    m_last = 0;
+    return true;
+  }
+
+  template<typename F>
+  void for_each(F f) const {
+    for (auto const& r : m_regions) {
+      f(r.handle);
+    }
+  }
+
+  bool empty() const {
+    return m_regions.empty();
+  }
+};
+
+}
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef TRANSPORT_RETIRE_QUEUE_H
+#define TRANSPORT_RETIRE_QUEUE_H
+
+#include <vector>
+
+#include <cstdint>
+
+#include "common/exception.h"
+
+namespace lseb {
+
+// Slot indexes of the sends in posting order. When only one send every few
+// is signaled, its completion retires also the sends posted before it, which
+// complete in order on a reliable connection.
+
+class RetireQueue {
+  std::vector<uint32_t> m_ring;
+  uint64_t m_head;  // next position to post
+  uint64_t m_done;  // first position not retired
+  uint64_t m_tail;  // first position not handed back
+
+ public:
+  explicit RetireQueue(uint32_t size)
+      : m_ring(size),
+        m_head(0),
+        m_done(0),
+        m_tail(0) {
+  }
+
+  void push(uint32_t index) {
+    m_ring[m_head++ % m_ring.size()] = index;
+  }
+
+  // Undo the last n pushes, for the sends that could not be posted
+  void rewind(size_t n) {
+    m_head -= n;
+  }
+
+  void retire(uint32_t index) {
+    while (m_done != m_head) {
+      if (m_ring[m_done++ % m_ring.size()] == index) {
+        return;
+      }
+    }
+    throw exception::socket::generic_error(
+        "Error on retire: completion of a send not pending");
+  }
+
+  bool pop(uint32_t& index) {
+    if (m_tail == m_done) {
+      return false;
+    }
+    index = m_ring[m_tail++ % m_ring.size()];
+    return true;
+  }
+};
+
+}
+
+#endif
@@ -0,0 +1,75 @@
+#include "transport/shm/acceptor.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "common/exception.h"
+
+namespace lseb {
+
+namespace shm {
+
+Acceptor::Acceptor(int credits)
+    : m_credits(credits),
+      m_fd(-1) {
+}
+
+Acceptor::~Acceptor() {
+  if (m_fd != -1) {
+    close(m_fd);
+  }
+}
+
+void Acceptor::listen(std::string const& hostname, std::string const& port) {
+  // The peers are on the same node, so the port is enough to find us
+  m_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  if (m_fd == -1) {
+    throw exception::acceptor::generic_error(
+        "Error on socket: " + std::string(strerror(errno)));
+  }
+
+  socklen_t len;
+  sockaddr_un addr = control_address(port, len);
+  if (bind(m_fd, reinterpret_cast<sockaddr*>(&addr), len)) {
+    throw exception::acceptor::generic_error(
+        "Error on bind: " + std::string(strerror(errno)));
+  }
+
+  if (::listen(m_fd, 128)) {
+    throw exception::acceptor::generic_error(
+        "Error on listen: " + std::string(strerror(errno)));
+  }
+}
+
+std::unique_ptr<Socket> Acceptor::accept() {
+  int fd = accept4(m_fd, nullptr, nullptr, SOCK_CLOEXEC);
+  if (fd == -1) {
+    throw exception::acceptor::generic_error(
+        "Error on accept4: " + std::string(strerror(errno)));
+  }
+
+  Announcement ann;
+  int control_fd;
+  try {
+    recv_announcement(fd, ann, control_fd, true);
+  } catch (std::exception& e) {
+    close(fd);
+    throw exception::acceptor::generic_error(e.what());
+  }
+  if (ann.type != Announcement::CONTROL_BLOCK || ann.base != m_credits) {
+    close(control_fd);
+    close(fd);
+    throw exception::acceptor::generic_error(
+        "Error on accept: unexpected control block");
+  }
+
+  std::unique_ptr<Socket> socket_ptr(new Socket(fd, control_fd, m_credits, 1));
+  return socket_ptr;
+}
+
+}
+
+}
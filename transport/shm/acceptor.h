@@ -0,0 +1,32 @@
+#ifndef TRANSPORT_SHM_ACCEPTOR_H
+#define TRANSPORT_SHM_ACCEPTOR_H
+
+#include <memory>
+#include <string>
+
+#include "transport/shm/socket.h"
+
+namespace lseb {
+
+namespace shm {
+
+class Acceptor {
+
+  uint32_t m_credits;
+  int m_fd;
+
+ public:
+
+  Acceptor(int credits);
+  Acceptor(Acceptor const& other) = delete;  // non construction-copyable
+  Acceptor& operator=(Acceptor const&) = delete;  // non copyable
+  void listen(std::string const& hostname, std::string const& port);
+  ~Acceptor();
+  std::unique_ptr<Socket> accept();
+};
+
+}
+
+}
+
+#endif
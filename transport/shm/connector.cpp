@@ -0,0 +1,69 @@
+#include "transport/shm/connector.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+
+#include "common/exception.h"
+
+namespace lseb {
+
+namespace shm {
+
+Connector::Connector(int credits)
+    : m_credits(credits) {
+}
+
+std::unique_ptr<Socket> Connector::connect(
+    std::string const& hostname,
+    std::string const& port) {
+  int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  if (fd == -1) {
+    throw exception::connector::generic_error(
+        "Error on socket: " + std::string(strerror(errno)));
+  }
+
+  socklen_t len;
+  sockaddr_un addr = control_address(port, len);
+  if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), len)) {
+    close(fd);
+    throw exception::connector::generic_error(
+        "Error on connect: " + std::string(strerror(errno)));
+  }
+
+  // Create the (zero-filled) control block and hand it to the acceptor
+  int control_fd = memfd_create("lseb-control", MFD_CLOEXEC);
+  if (control_fd == -1) {
+    close(fd);
+    throw exception::connector::generic_error(
+        "Error on memfd_create: " + std::string(strerror(errno)));
+  }
+  if (ftruncate(control_fd, Socket::control_size(m_credits))) {
+    close(control_fd);
+    close(fd);
+    throw exception::connector::generic_error(
+        "Error on ftruncate: " + std::string(strerror(errno)));
+  }
+
+  Announcement ann;
+  ann.type = Announcement::CONTROL_BLOCK;
+  ann.base = m_credits;
+  ann.size = Socket::control_size(m_credits);
+  try {
+    send_announcement(fd, ann, control_fd);
+  } catch (std::exception& e) {
+    close(control_fd);
+    close(fd);
+    throw exception::connector::generic_error(e.what());
+  }
+
+  std::unique_ptr<Socket> socket_ptr(new Socket(fd, control_fd, m_credits, 0));
+  return socket_ptr;
+}
+
+}
+
+}
@@ -0,0 +1,81 @@
+#ifndef TRANSPORT_SHM_QUEUE_H
+#define TRANSPORT_SHM_QUEUE_H
+
+#include <atomic>
+
+#include <cstdint>
+#include <cstddef>
+
+namespace lseb {
+
+namespace shm {
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "Lock-free 64 bit atomics required");
+
+struct Descriptor {
+  uint64_t addr;
+  uint64_t len;
+};
+
+// Single-producer single-consumer queue of descriptors living in memory
+// shared by two processes. The memory must be zero-initialized.
+
+class DescriptorQueue {
+
+  struct Indexes {
+    alignas(64) std::atomic<uint64_t> head;  // written by the producer
+    alignas(64) std::atomic<uint64_t> tail;  // written by the consumer
+  };
+
+  Indexes* m_indexes;
+  Descriptor* m_ring;
+  uint32_t m_size;
+
+ public:
+
+  DescriptorQueue()
+      : m_indexes(nullptr),
+        m_ring(nullptr),
+        m_size(0) {
+  }
+  DescriptorQueue(void* memory, uint32_t size)
+      : m_indexes(static_cast<Indexes*>(memory)),
+        m_ring(reinterpret_cast<Descriptor*>(m_indexes + 1)),
+        m_size(size) {
+  }
+
+  static size_t footprint(uint32_t size) {
+    return sizeof(Indexes) + size * sizeof(Descriptor);
+  }
+
+  bool push(Descriptor const& desc) {
+    uint64_t const head = m_indexes->head.load(std::memory_order_relaxed);
+    if (head - m_indexes->tail.load(std::memory_order_acquire) == m_size) {
+      return false;
+    }
+    m_ring[head % m_size] = desc;
+    m_indexes->head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(Descriptor& desc) {
+    uint64_t const tail = m_indexes->tail.load(std::memory_order_relaxed);
+    if (tail == m_indexes->head.load(std::memory_order_acquire)) {
+      return false;
+    }
+    desc = m_ring[tail % m_size];
+    m_indexes->tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool empty() const {
+    return m_indexes->tail.load(std::memory_order_relaxed)
+        == m_indexes->head.load(std::memory_order_acquire);
+  }
+};
+
+}
+
+}
+
+#endif
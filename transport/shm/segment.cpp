@@ -0,0 +1,112 @@
+#include "transport/shm/segment.h"
+
+#include <map>
+#include <mutex>
+#include <string>
+
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "common/exception.h"
+
+namespace lseb {
+
+namespace shm {
+
+namespace {
+
+// Registry of the live segments, sorted by address
+std::mutex registry_mutex;
+std::map<unsigned char const*, Segment const*> registry;
+
+}
+
+Segment::Segment(size_t size, MemoryPlacement const& placement)
+    : m_fd(-1),
+      m_begin(nullptr),
+      m_size(size),
+      m_huge(false) {
+  // The huge pages are reserved by mmap, which fails if there are not
+  // enough of them: then the default pages are used
+  void* addr = MAP_FAILED;
+  if (placement.page_size) {
+    m_fd = memfd_create(
+        "lseb",
+        MFD_CLOEXEC | MFD_HUGETLB
+            | huge_pages::size_flags(placement.page_size));
+    if (m_fd != -1) {
+      m_size = huge_pages::round_up(size, placement.page_size);
+      if (!ftruncate(m_fd, m_size)) {
+        addr = mmap(
+            nullptr,
+            m_size,
+            PROT_READ | PROT_WRITE,
+            MAP_SHARED,
+            m_fd,
+            0);
+      }
+      if (addr == MAP_FAILED) {
+        close(m_fd);
+        m_size = size;
+      }
+    }
+    m_huge = addr != MAP_FAILED;
+  }
+
+  if (!m_huge) {
+    m_fd = memfd_create("lseb", MFD_CLOEXEC);
+    if (m_fd == -1) {
+      throw exception::memory::generic_error(
+          "Error on memfd_create: " + std::string(strerror(errno)));
+    }
+    if (ftruncate(m_fd, m_size)) {
+      close(m_fd);
+      throw exception::memory::generic_error(
+          "Error on ftruncate: " + std::string(strerror(errno)));
+    }
+    addr = mmap(
+        nullptr,
+        m_size,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED,
+        m_fd,
+        0);
+    if (addr == MAP_FAILED) {
+      close(m_fd);
+      throw exception::memory::generic_error(
+          "Error on mmap: " + std::string(strerror(errno)));
+    }
+  }
+  m_begin = static_cast<unsigned char*>(addr);
+  huge_pages::place(m_begin, m_size, placement, m_huge);
+
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  registry.emplace(m_begin, this);
+}
+
+Segment::~Segment() {
+  {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    registry.erase(m_begin);
+  }
+  munmap(m_begin, m_size);
+  close(m_fd);
+}
+
+Segment const* Segment::find(void const* buffer, size_t size) {
+  auto begin = static_cast<unsigned char const*>(buffer);
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  auto it = registry.upper_bound(begin);
+  if (it == std::begin(registry)) {
+    return nullptr;
+  }
+  Segment const* segment = (--it)->second;
+  return (begin + size <= segment->end()) ? segment : nullptr;
+}
+
+}
+
+}
@@ -0,0 +1,58 @@
+#ifndef TRANSPORT_SHM_SEGMENT_H
+#define TRANSPORT_SHM_SEGMENT_H
+
+#include <cstddef>
+
+#include "common/huge_pages.h"
+
+namespace lseb {
+
+namespace shm {
+
+// Memory backed by an anonymous file (memfd) that other processes of the same
+// node can map. Only memory allocated with a Segment can be used to receive
+// data from a shared-memory connection. With huge pages in placement, the
+// file is created on hugetlbfs and its size rounded up to whole pages.
+
+class Segment {
+
+  int m_fd;
+  unsigned char* m_begin;
+  size_t m_size;
+  bool m_huge;
+
+ public:
+
+  explicit Segment(
+      size_t size,
+      MemoryPlacement const& placement = MemoryPlacement());
+  Segment(Segment const& other) = delete;  // non construction-copyable
+  Segment& operator=(Segment const&) = delete;  // non copyable
+  ~Segment();
+
+  unsigned char* begin() const {
+    return m_begin;
+  }
+  unsigned char* end() const {
+    return m_begin + m_size;
+  }
+  size_t size() const {
+    return m_size;
+  }
+  int fd() const {
+    return m_fd;
+  }
+  // Whether it is mapped with huge pages
+  bool huge() const {
+    return m_huge;
+  }
+
+  // Return the segment that contains the buffer, nullptr if not found
+  static Segment const* find(void const* buffer, size_t size);
+};
+
+}
+
+}
+
+#endif
@@ -0,0 +1,319 @@
+#include "transport/shm/socket.h"
+
+#include <algorithm>
+
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+
+#include "common/exception.h"
+
+namespace lseb {
+
+namespace shm {
+
+sockaddr_un control_address(std::string const& port, socklen_t& len) {
+  // Abstract socket namespace: the address does not live on the filesystem
+  sockaddr_un addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  std::string const name = "lseb-shm-" + port;
+  std::memcpy(addr.sun_path + 1, name.c_str(), name.size());
+  len = offsetof(sockaddr_un, sun_path) + 1 + name.size();
+  return addr;
+}
+
+void send_announcement(int fd, Announcement const& ann, int attached_fd) {
+  iovec iov = { const_cast<Announcement*>(&ann), sizeof(ann) };
+  union {
+    cmsghdr align;
+    unsigned char buf[CMSG_SPACE(sizeof(int))];
+  } control;
+  std::memset(&control, 0, sizeof(control));
+
+  msghdr msg;
+  std::memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+
+  cmsghdr* cm = CMSG_FIRSTHDR(&msg);
+  cm->cmsg_level = SOL_SOCKET;
+  cm->cmsg_type = SCM_RIGHTS;
+  cm->cmsg_len = CMSG_LEN(sizeof(int));
+  std::memcpy(CMSG_DATA(cm), &attached_fd, sizeof(int));
+
+  if (sendmsg(fd, &msg, MSG_NOSIGNAL) != sizeof(ann)) {
+    throw exception::socket::generic_error(
+        "Error on sendmsg: " + std::string(strerror(errno)));
+  }
+}
+
+bool recv_announcement(int fd, Announcement& ann, int& attached_fd, bool wait) {
+  iovec iov = { &ann, sizeof(ann) };
+  union {
+    cmsghdr align;
+    unsigned char buf[CMSG_SPACE(sizeof(int))];
+  } control;
+
+  msghdr msg;
+  std::memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+
+  ssize_t ret = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC | (wait ? 0 : MSG_DONTWAIT));
+  if (ret < 0 && !wait && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    return false;
+  }
+  cmsghdr* cm = CMSG_FIRSTHDR(&msg);
+  if (ret != sizeof(ann) || !cm || cm->cmsg_type != SCM_RIGHTS) {
+    throw exception::socket::generic_error(
+        "Error on recvmsg: " + std::string(ret < 0 ? strerror(errno) : "bad announcement"));
+  }
+  std::memcpy(&attached_fd, CMSG_DATA(cm), sizeof(int));
+  return true;
+}
+
+Socket::Socket(int fd, int control_fd, uint32_t credits, int side)
+    : m_fd(fd),
+      m_credits(credits),
+      m_control(nullptr),
+      m_control_size(control_size(credits)),
+      m_send_slots(m_credits),
+      m_send_head(0),
+      m_send_next(0),
+      m_send_tail(0),
+      m_recv_slots(m_credits),
+      m_recv_head(0),
+      m_recv_tail(0) {
+  void* addr = mmap(
+      nullptr,
+      m_control_size,
+      PROT_READ | PROT_WRITE,
+      MAP_SHARED,
+      control_fd,
+      0);
+  close(control_fd);
+  if (addr == MAP_FAILED) {
+    close(m_fd);
+    throw exception::socket::generic_error(
+        "Error on mmap: " + std::string(strerror(errno)));
+  }
+  m_control = static_cast<unsigned char*>(addr);
+
+  // Queues of the direction in which the connector (side 0) sends first
+  size_t const footprint = DescriptorQueue::footprint(m_credits);
+  DescriptorQueue queues[4];
+  for (int i = 0; i < 4; ++i) {
+    queues[i] = DescriptorQueue(m_control + i * footprint, m_credits);
+  }
+  int const send_dir = side ? 2 : 0;
+  int const recv_dir = side ? 0 : 2;
+  m_send_posted = queues[send_dir];
+  m_send_completed = queues[send_dir + 1];
+  m_recv_posted = queues[recv_dir];
+  m_recv_completed = queues[recv_dir + 1];
+}
+
+Socket::~Socket() {
+  for (auto const& region : m_peer_regions) {
+    munmap(region.local, region.size);
+  }
+  munmap(m_control, m_control_size);
+  close(m_fd);
+}
+
+size_t Socket::control_size(uint32_t credits) {
+  return 4 * DescriptorQueue::footprint(credits);
+}
+
+void Socket::register_memory(void* buffer, size_t size) {
+  Segment const* segment = Segment::find(buffer, size);
+  // Memory outside of a segment can be used only to send data
+  if (!segment || std::find(std::begin(m_segments), std::end(m_segments),
+      segment) != std::end(m_segments)) {
+    return;
+  }
+  Announcement ann;
+  ann.type = Announcement::MEMORY_REGION;
+  ann.base = reinterpret_cast<uint64_t>(segment->begin());
+  ann.size = segment->size();
+  send_announcement(m_fd, ann, segment->fd());
+  m_segments.push_back(segment);
+}
+
+unsigned char* Socket::translate(Descriptor const& desc) {
+  while (true) {
+    for (auto const& region : m_peer_regions) {
+      if (region.begin <= desc.addr
+          && desc.addr + desc.len <= region.begin + region.size) {
+        return region.local + (desc.addr - region.begin);
+      }
+    }
+
+    // The peer announces a region before posting buffers from it
+    Announcement ann;
+    int fd;
+    if (!recv_announcement(m_fd, ann, fd, false)) {
+      throw exception::socket::generic_error(
+          "Error on translate: buffer outside of announced memory");
+    }
+    void* addr = mmap(
+        nullptr,
+        ann.size,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED,
+        fd,
+        0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+      throw exception::socket::generic_error(
+          "Error on mmap: " + std::string(strerror(errno)));
+    }
+    m_peer_regions.push_back(
+        { ann.base, ann.size, static_cast<unsigned char*>(addr) });
+  }
+}
+
+void Socket::progress_send() {
+  Descriptor desc;
+  while (m_send_next != m_send_head && m_send_posted.pop(desc)) {
+    SendSlot const& slot = m_send_slots[m_send_next % m_credits];
+    if (slot.iov.iov_len > desc.len) {
+      throw exception::socket::generic_error(
+          "Error on send: message longer than the posted buffer");
+    }
+    unsigned char* dest = translate(desc);
+    for (size_t s = 0; s < slot.n_sge; ++s) {
+      std::memcpy(dest, slot.sge[s].iov_base, slot.sge[s].iov_len);
+      dest += slot.sge[s].iov_len;
+    }
+    desc.len = slot.iov.iov_len;
+    if (!m_send_completed.push(desc)) {
+      throw exception::socket::generic_error(
+          "Error on push: completion queue full");
+    }
+    ++m_send_next;
+  }
+}
+
+size_t Socket::poll_completed_send(iovec* iov, size_t n) {
+  progress_send();
+
+  size_t i = 0;
+  for (; i < n && m_send_tail != m_send_next; ++m_send_tail) {
+    iov[i++] = m_send_slots[m_send_tail % m_credits].iov;
+  }
+  return i;
+}
+
+size_t Socket::poll_completed_recv(iovec* iov, size_t n) {
+  size_t i = 0;
+  Descriptor desc;
+  while (i < n && m_recv_completed.pop(desc)) {
+    iov[i++] = { reinterpret_cast<void*>(desc.addr), desc.len };
+    ++m_recv_tail;
+  }
+  return i;
+}
+
+void Socket::post_send(iovec const& iov) {
+  post_send(&iov, 1);
+}
+
+void Socket::post_send(iovec const* iov, size_t n) {
+  if (m_send_head - m_send_tail + n > m_credits) {
+    throw exception::socket::generic_error(
+        "Error on post_send: no credits available");
+  }
+  for (size_t i = 0; i < n; ++i) {
+    SendSlot& slot = m_send_slots[m_send_head % m_credits];
+    slot.iov = iov[i];
+    slot.sge[0] = iov[i];
+    slot.n_sge = 1;
+    ++m_send_head;
+  }
+  progress_send();
+}
+
+void Socket::post_sendv(iovec const* iov, size_t n) {
+  if (m_send_head - m_send_tail == m_credits) {
+    throw exception::socket::generic_error(
+        "Error on post_sendv: no credits available");
+  }
+  if (!n || n > MAX_SEND_SGE) {
+    throw exception::socket::generic_error(
+        "Error on post_sendv: wrong number of segments");
+  }
+  // The segments are copied one after the other into the posted buffer
+  SendSlot& slot = m_send_slots[m_send_head % m_credits];
+  slot.iov = { iov[0].iov_base, 0 };
+  for (size_t i = 0; i < n; ++i) {
+    slot.sge[i] = iov[i];
+    slot.iov.iov_len += iov[i].iov_len;
+  }
+  slot.n_sge = n;
+  ++m_send_head;
+  progress_send();
+}
+
+void Socket::post_recv(iovec const& iov) {
+  if (!available_recv()) {
+    throw exception::socket::generic_error(
+        "Error on post_recv: no credits available");
+  }
+  Segment const* segment = Segment::find(iov.iov_base, iov.iov_len);
+  if (!segment || std::find(std::begin(m_segments), std::end(m_segments),
+      segment) == std::end(m_segments)) {
+    throw exception::socket::generic_error(
+        "Error on post_recv: buffer outside of registered memory");
+  }
+  Descriptor const desc = { reinterpret_cast<uint64_t>(iov.iov_base),
+      iov.iov_len };
+  if (!m_recv_posted.push(desc)) {
+    throw exception::socket::generic_error(
+        "Error on push: receive queue full");
+  }
+  m_recv_slots[m_recv_head % m_credits] = iov;
+  ++m_recv_head;
+}
+
+bool Socket::available_send() {
+  return m_send_head - m_send_tail < m_credits;
+}
+
+bool Socket::available_recv() {
+  return m_recv_head - m_recv_tail < m_credits;
+}
+
+std::vector<iovec> Socket::pending_send() {
+  std::vector<iovec> iov_vect;
+  iov_vect.reserve(m_send_head - m_send_tail);
+  for (uint64_t i = m_send_tail; i != m_send_head; ++i) {
+    iov_vect.push_back(m_send_slots[i % m_credits].iov);
+  }
+  return iov_vect;
+}
+
+std::vector<iovec> Socket::pending_recv() {
+  std::vector<iovec> iov_vect;
+  iov_vect.reserve(m_recv_head - m_recv_tail);
+  for (uint64_t i = m_recv_tail; i != m_recv_head; ++i) {
+    iov_vect.push_back(m_recv_slots[i % m_credits]);
+  }
+  return iov_vect;
+}
+
+std::string Socket::peer_hostname() {
+  return "localhost";
+}
+
+}
+
+}
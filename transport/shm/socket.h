@@ -0,0 +1,117 @@
+#ifndef TRANSPORT_SHM_SOCKET_H
+#define TRANSPORT_SHM_SOCKET_H
+
+#include <vector>
+#include <string>
+
+#include <cstdint>
+
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "transport/connection.h"
+#include "transport/shm/queue.h"
+#include "transport/shm/segment.h"
+
+namespace lseb {
+
+namespace shm {
+
+// A shared-memory connection is made of a control block, created by the
+// connector and mapped by both peers, with two descriptor queues for each
+// direction: the receiver posts its buffers in the first one and the sender
+// copies the message directly into them, returning the filled buffers in the
+// second one. The memory that receives data must be allocated with a Segment,
+// which is announced to the peer (passing its memfd) by register_memory.
+
+struct Announcement {
+  enum : uint64_t {
+    CONTROL_BLOCK = 0,
+    MEMORY_REGION = 1
+  };
+  uint64_t type;
+  uint64_t base;  // address in the announcing process or credits
+  uint64_t size;
+};
+
+sockaddr_un control_address(std::string const& port, socklen_t& len);
+void send_announcement(int fd, Announcement const& ann, int attached_fd);
+bool recv_announcement(int fd, Announcement& ann, int& attached_fd, bool wait);
+
+class Socket : public Connection {
+
+  struct SendSlot {
+    iovec iov;  // as completed: the first segment, with the whole length
+    iovec sge[MAX_SEND_SGE];
+    size_t n_sge;
+  };
+
+  struct PeerRegion {
+    uint64_t begin;
+    uint64_t size;
+    unsigned char* local;
+  };
+
+  int m_fd;  // control socket
+  uint32_t m_credits;
+  unsigned char* m_control;
+  size_t m_control_size;
+
+  DescriptorQueue m_send_posted;  // buffers posted by the peer
+  DescriptorQueue m_send_completed;  // buffers filled for the peer
+  DescriptorQueue m_recv_posted;
+  DescriptorQueue m_recv_completed;
+
+  std::vector<SendSlot> m_send_slots;
+  uint64_t m_send_head;  // next slot to post
+  uint64_t m_send_next;  // first slot not delivered
+  uint64_t m_send_tail;  // first slot not completed
+
+  std::vector<iovec> m_recv_slots;
+  uint64_t m_recv_head;
+  uint64_t m_recv_tail;
+
+  std::vector<PeerRegion> m_peer_regions;
+  std::vector<Segment const*> m_segments;
+
+  unsigned char* translate(Descriptor const& desc);
+  void progress_send();
+
+ public:
+
+  // The connector uses side 0, the acceptor side 1
+  Socket(int fd, int control_fd, uint32_t credits, int side);
+  Socket(Socket const& other) = delete;  // non construction-copyable
+  Socket& operator=(Socket const&) = delete;  // non copyable
+  ~Socket() override;
+
+  static size_t control_size(uint32_t credits);
+
+  void register_memory(void* buffer, size_t size) override;
+
+  using Connection::poll_completed_send;
+  using Connection::poll_completed_recv;
+  size_t poll_completed_send(iovec* iov, size_t n) override;
+  size_t poll_completed_recv(iovec* iov, size_t n) override;
+
+  using Connection::post_recv;
+  void post_send(iovec const& iov) override;
+  void post_recv(iovec const& iov) override;
+  void post_send(iovec const* iov, size_t n) override;
+  void post_sendv(iovec const* iov, size_t n) override;
+
+  bool available_send() override;
+  bool available_recv() override;
+
+  std::vector<iovec> pending_send() override;
+  std::vector<iovec> pending_recv() override;
+
+  std::string peer_hostname() override;
+};
+
+}
+
+}
+
+#endif
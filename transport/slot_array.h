@@ -0,0 +1,81 @@
+#ifndef TRANSPORT_SLOT_ARRAY_H
+#define TRANSPORT_SLOT_ARRAY_H
+
+#include <vector>
+
+#include <cstdint>
+
+#include <sys/uio.h>
+
+#include "common/exception.h"
+
+namespace lseb {
+
+// Fixed array of in-flight work requests. The index of the slot is used as
+// the context of the work request, so that a completion is matched to its
+// buffer with an array access. Nothing is allocated after the construction.
+
+class SlotArray {
+  std::vector<iovec> m_slots;
+  std::vector<bool> m_used;
+  std::vector<uint32_t> m_free;  // stack of free indexes
+
+ public:
+  explicit SlotArray(uint32_t size)
+      : m_slots(size),
+        m_used(size, false) {
+    m_free.reserve(size);
+    for (uint32_t i = size; i != 0; --i) {
+      m_free.push_back(i - 1);
+    }
+  }
+
+  bool full() const {
+    return m_free.empty();
+  }
+
+  size_t size() const {
+    return m_slots.size() - m_free.size();
+  }
+
+  size_t capacity() const {
+    return m_slots.size();
+  }
+
+  uint32_t acquire(iovec const& iov) {
+    if (m_free.empty()) {
+      throw exception::socket::generic_error(
+          "Error on acquire: no free slots");
+    }
+    uint32_t const index = m_free.back();
+    m_free.pop_back();
+    m_slots[index] = iov;
+    m_used[index] = true;
+    return index;
+  }
+
+  iovec release(uint64_t index) {
+    if (index >= m_slots.size() || !m_used[index]) {
+      throw exception::socket::generic_error(
+          "Error on release: slot not in use");
+    }
+    m_used[index] = false;
+    m_free.push_back(index);
+    return m_slots[index];
+  }
+
+  std::vector<iovec> pending() const {
+    std::vector<iovec> iov_vect;
+    iov_vect.reserve(size());
+    for (size_t i = 0; i < m_slots.size(); ++i) {
+      if (m_used[i]) {
+        iov_vect.push_back(m_slots[i]);
+      }
+    }
+    return iov_vect;
+  }
+};
+
+}
+
+#endif
@@ -0,0 +1,126 @@
+#include "transport/tcp/acceptor.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+
+#include "common/exception.h"
+
+namespace lseb {
+
+Acceptor::Acceptor(int credits)
+    : m_credits(credits),
+      m_fd(-1),
+      m_epoll_fd(-1) {
+}
+
+Acceptor::~Acceptor() {
+  if (m_epoll_fd != -1) {
+    close(m_epoll_fd);
+  }
+  if (m_fd != -1) {
+    close(m_fd);
+  }
+}
+
+void Acceptor::listen(std::string const& hostname, std::string const& port) {
+  addrinfo hints;
+  std::memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_PASSIVE;
+  addrinfo* res;
+  int ret = getaddrinfo(hostname.c_str(), port.c_str(), &hints, &res);
+  if (ret) {
+    throw exception::acceptor::generic_error(
+        "Error on getaddrinfo: " + std::string(gai_strerror(ret)));
+  }
+
+  m_fd = socket(res->ai_family, res->ai_socktype | SOCK_NONBLOCK, 0);
+  if (m_fd == -1) {
+    freeaddrinfo(res);
+    throw exception::acceptor::generic_error(
+        "Error on socket: " + std::string(strerror(errno)));
+  }
+
+  int one = 1;
+  setsockopt(m_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  ret = bind(m_fd, res->ai_addr, res->ai_addrlen);
+  freeaddrinfo(res);
+  if (ret) {
+    throw exception::acceptor::generic_error(
+        "Error on bind: " + std::string(strerror(errno)));
+  }
+
+  if (::listen(m_fd, tcp::LISTEN_BACKLOG)) {
+    throw exception::acceptor::generic_error(
+        "Error on listen: " + std::string(strerror(errno)));
+  }
+
+  m_epoll_fd = epoll_create1(0);
+  if (m_epoll_fd == -1) {
+    throw exception::acceptor::generic_error(
+        "Error on epoll_create1: " + std::string(strerror(errno)));
+  }
+
+  epoll_event event;
+  std::memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN;
+  event.data.fd = m_fd;
+  if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_fd, &event)) {
+    throw exception::acceptor::generic_error(
+        "Error on epoll_ctl: " + std::string(strerror(errno)));
+  }
+}
+
+void Acceptor::share_receive_queue(int size) {
+  m_srq = std::make_shared<SharedReceiveQueue>(size);
+}
+
+void Acceptor::share_completion_queue(
+    std::shared_ptr<CompletionQueue> const& cq) {
+  m_cq = cq;
+}
+
+void Acceptor::enable_wait() {
+  // The sockets, and the epoll set of a completion queue, can always be
+  // waited for
+}
+
+void Acceptor::enable_write_ring() {
+  throw exception::acceptor::generic_error(
+      "Error on enable_write_ring: not supported by TCP");
+}
+
+void Acceptor::enable_rdm() {
+  throw exception::acceptor::generic_error(
+      "Error on enable_rdm: not supported by TCP");
+}
+
+std::unique_ptr<Socket> Acceptor::accept() {
+  while (true) {
+    int fd = accept4(m_fd, nullptr, nullptr, SOCK_NONBLOCK);
+    if (fd != -1) {
+      std::unique_ptr<Socket> socket_ptr(new Socket(fd, m_credits, m_srq, m_cq));
+      return socket_ptr;
+    }
+    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+      throw exception::acceptor::generic_error(
+          "Error on accept4: " + std::string(strerror(errno)));
+    }
+
+    // Wait for the next connection request
+    epoll_event event;
+    if (epoll_wait(m_epoll_fd, &event, 1, -1) == -1 && errno != EINTR) {
+      throw exception::acceptor::generic_error(
+          "Error on epoll_wait: " + std::string(strerror(errno)));
+    }
+  }
+}
+
+}
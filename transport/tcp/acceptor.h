@@ -0,0 +1,43 @@
+#ifndef TRANSPORT_TCP_ACCEPTOR_H
+#define TRANSPORT_TCP_ACCEPTOR_H
+
+#include <memory>
+#include <string>
+
+#include "transport/tcp/socket.h"
+
+namespace lseb {
+
+class Acceptor {
+
+  uint32_t m_credits;
+  int m_fd;
+  int m_epoll_fd;
+  std::shared_ptr<SharedReceiveQueue> m_srq;
+  std::shared_ptr<CompletionQueue> m_cq;
+
+ public:
+
+  Acceptor(int credits);
+  Acceptor(Acceptor const& other) = delete;  // non construction-copyable
+  Acceptor& operator=(Acceptor const&) = delete;  // non copyable
+  // The sockets accepted afterwards post their receives to a single queue of
+  // the given size. It must be called before listen.
+  void share_receive_queue(int size);
+  // The sockets accepted afterwards report their completions to cq. It must
+  // be called before listen.
+  void share_completion_queue(std::shared_ptr<CompletionQueue> const& cq);
+  // The sockets accepted afterwards can be waited for, see
+  // Connection::wait_fds. It must be called before listen.
+  void enable_wait();
+  // The write ring needs one-sided writes, not available on TCP: it throws
+  void enable_write_ring();
+  void enable_rdm();
+  void listen(std::string const& hostname, std::string const& port);
+  ~Acceptor();
+  std::unique_ptr<Socket> accept();
+};
+
+}
+
+#endif
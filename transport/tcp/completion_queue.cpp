@@ -0,0 +1,73 @@
+#include "transport/tcp/completion_queue.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+
+#include "common/exception.h"
+#include "transport/tcp/socket.h"
+
+namespace lseb {
+
+CompletionQueue::CompletionQueue(uint32_t size, bool wait)
+    : m_events(size) {
+  m_epoll_fd = epoll_create1(0);
+  if (m_epoll_fd == -1) {
+    throw exception::socket::generic_error(
+        "Error on epoll_create1: " + std::string(strerror(errno)));
+  }
+}
+
+CompletionQueue::~CompletionQueue() {
+  close(m_epoll_fd);
+}
+
+std::vector<int> CompletionQueue::wait_fds() const {
+  return {m_epoll_fd};
+}
+
+void CompletionQueue::attach(Socket* socket, int fd) {
+  // Edge triggered: a socket is notified only when its state changes, and
+  // stays ready until a read or a write would block
+  epoll_event event;
+  std::memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+  event.data.ptr = socket;
+  if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &event)) {
+    throw exception::socket::generic_error(
+        "Error on epoll_ctl: " + std::string(strerror(errno)));
+  }
+}
+
+void CompletionQueue::detach(int fd) {
+  epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+void CompletionQueue::poll() {
+  int ret = epoll_wait(m_epoll_fd, m_events.data(), m_events.size(), 0);
+  if (ret == -1) {
+    if (errno == EINTR) {
+      return;
+    }
+    throw exception::socket::generic_error(
+        "Error on epoll_wait: " + std::string(strerror(errno)));
+  }
+  for (int i = 0; i < ret; ++i) {
+    auto socket = static_cast<Socket*>(m_events[i].data.ptr);
+    uint32_t const events = m_events[i].events;
+    // Errors and hang-ups are read by the next call on the socket
+    if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+      socket->m_readable = true;
+    }
+    if (events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) {
+      socket->m_writable = true;
+    }
+    // Zero-copy notifications are queued in the error queue
+    if (events & EPOLLERR) {
+      socket->m_notified = true;
+    }
+  }
+}
+
+}
@@ -0,0 +1,42 @@
+#ifndef TRANSPORT_TCP_COMPLETION_QUEUE_H
+#define TRANSPORT_TCP_COMPLETION_QUEUE_H
+
+#include <vector>
+
+#include <cstdint>
+
+#include <sys/epoll.h>
+
+namespace lseb {
+
+class Socket;
+
+// Readiness of all the sockets bound to it, read with a single epoll_wait.
+// The sockets then read from and write to the kernel only once they have
+// been reported ready, so that the idle ones cost no system calls.
+
+class CompletionQueue {
+  int m_epoll_fd;
+  std::vector<epoll_event> m_events;
+
+ public:
+  // The epoll set can always be waited for, wait is only needed by the
+  // queues of the other transport layers
+  explicit CompletionQueue(uint32_t size, bool wait = false);
+  CompletionQueue(CompletionQueue const& other) = delete;  // non construction-copyable
+  CompletionQueue& operator=(CompletionQueue const&) = delete;  // non copyable
+  ~CompletionQueue();
+
+  std::vector<int> wait_fds() const;
+
+  void attach(Socket* socket, int fd);
+  void detach(int fd);
+
+  // Hand the events to the sockets, which complete the work requests when
+  // they are polled
+  void poll();
+};
+
+}
+
+#endif
@@ -0,0 +1,113 @@
+#include "transport/tcp/connector.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+
+#include "common/exception.h"
+
+namespace {
+
+// Wait for the completion of a non-blocking connect
+int wait_connected(int fd, int timeout_ms) {
+  int epoll_fd = epoll_create1(0);
+  if (epoll_fd == -1) {
+    return errno;
+  }
+
+  epoll_event event;
+  std::memset(&event, 0, sizeof(event));
+  event.events = EPOLLOUT;
+  event.data.fd = fd;
+  int err = 0;
+  if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event)) {
+    err = errno;
+  } else {
+    int ret = epoll_wait(epoll_fd, &event, 1, timeout_ms);
+    if (ret == -1) {
+      err = errno;
+    } else if (ret == 0) {
+      err = ETIMEDOUT;
+    } else {
+      socklen_t len = sizeof(err);
+      if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len)) {
+        err = errno;
+      }
+    }
+  }
+  close(epoll_fd);
+  return err;
+}
+
+}
+
+namespace lseb {
+
+Connector::Connector(int credits, int signal_interval)
+    : m_credits(credits) {
+  // Sends complete without completion events, there is nothing to save by
+  // signaling only some of them
+}
+
+void Connector::share_completion_queue(
+    std::shared_ptr<CompletionQueue> const& cq) {
+  m_cq = cq;
+}
+
+void Connector::enable_wait() {
+  // The sockets, and the epoll set of a completion queue, can always be
+  // waited for
+}
+
+void Connector::enable_write_ring() {
+  throw exception::connector::generic_error(
+      "Error on enable_write_ring: not supported by TCP");
+}
+
+void Connector::enable_rdm() {
+  throw exception::connector::generic_error(
+      "Error on enable_rdm: not supported by TCP");
+}
+
+std::unique_ptr<Socket> Connector::connect(
+    std::string const& hostname,
+    std::string const& port) {
+  addrinfo hints;
+  std::memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* res;
+  int ret = getaddrinfo(hostname.c_str(), port.c_str(), &hints, &res);
+  if (ret) {
+    throw exception::connector::generic_error(
+        "Error on getaddrinfo: " + std::string(gai_strerror(ret)));
+  }
+
+  int fd = socket(res->ai_family, res->ai_socktype | SOCK_NONBLOCK, 0);
+  if (fd == -1) {
+    freeaddrinfo(res);
+    throw exception::connector::generic_error(
+        "Error on socket: " + std::string(strerror(errno)));
+  }
+
+  ret = ::connect(fd, res->ai_addr, res->ai_addrlen);
+  freeaddrinfo(res);
+  int err = (ret == -1) ? errno : 0;
+  if (err == EINPROGRESS) {
+    err = wait_connected(fd, tcp::CONNECT_TIMEOUT_MS);
+  }
+  if (err) {
+    close(fd);
+    throw exception::connector::generic_error(
+        "Error on connect: " + std::string(strerror(err)));
+  }
+
+  std::unique_ptr<Socket> socket_ptr(new Socket(fd, m_credits, nullptr, m_cq));
+  return socket_ptr;
+}
+
+}
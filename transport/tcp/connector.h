@@ -0,0 +1,36 @@
+#ifndef TRANSPORT_TCP_CONNECTOR_H
+#define TRANSPORT_TCP_CONNECTOR_H
+
+#include <memory>
+#include <string>
+
+#include "transport/tcp/socket.h"
+
+namespace lseb {
+
+class Connector {
+
+  uint32_t m_credits;
+  std::shared_ptr<CompletionQueue> m_cq;
+
+ public:
+
+  Connector(int credits, int signal_interval = 1);
+  Connector(Connector const& other) = delete;  // non construction-copyable
+  Connector& operator=(Connector const&) = delete;  // non copyable
+  // The sockets connected afterwards report their completions to cq
+  void share_completion_queue(std::shared_ptr<CompletionQueue> const& cq);
+  // The sockets connected afterwards can be waited for, see
+  // Connection::wait_fds
+  void enable_wait();
+  // The write ring needs one-sided writes, not available on TCP: it throws
+  void enable_write_ring();
+  void enable_rdm();
+  std::unique_ptr<Socket> connect(
+      std::string const& hostname,
+      std::string const& port);
+};
+
+}
+
+#endif
@@ -0,0 +1,476 @@
+#include "transport/tcp/socket.h"
+
+#include <algorithm>
+
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <linux/errqueue.h>
+
+#include "common/exception.h"
+
+namespace lseb {
+
+SharedReceiveQueue::SharedReceiveQueue(uint32_t size)
+    : buffers(size),
+      head(0),
+      tail(0),
+      outstanding(0),
+      sockets(0) {
+}
+
+Socket::Socket(
+    int fd,
+    uint32_t credits,
+    std::shared_ptr<SharedReceiveQueue> const& srq,
+    std::shared_ptr<CompletionQueue> const& cq)
+    : m_fd(fd),
+      m_credits(credits),
+      m_send_slots(m_credits),
+      m_send_head(0),
+      m_send_next(0),
+      m_send_tail(0),
+      m_recv_slots(srq ? srq->buffers.size() : m_credits),
+      m_srq(srq),
+      m_recv_head(0),
+      m_recv_next(0),
+      m_recv_tail(0),
+      m_srq_held(0),
+      m_recv_header(0),
+      m_recv_next_header(0),
+      m_recv_header_read(0),
+      m_recv_payload_read(0),
+      m_send_flags(MSG_NOSIGNAL),
+      m_zerocopy(false),
+      m_zc_calls(0),
+      m_zc_done(0),
+      m_cq(cq),
+      m_readable(true),
+      m_writable(true),
+      m_notified(true) {
+
+  m_iov_buffer.reserve((1 + MAX_SEND_SGE) * tcp::MAX_SEND_BATCH);
+
+  int flags = fcntl(m_fd, F_GETFL, 0);
+  if (flags == -1 || fcntl(m_fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+    throw exception::socket::generic_error(
+        "Error on fcntl: " + std::string(strerror(errno)));
+  }
+
+  int one = 1;
+  if (setsockopt(m_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one))) {
+    throw exception::socket::generic_error(
+        "Error on setsockopt: " + std::string(strerror(errno)));
+  }
+
+#if defined(HAVE_ZEROCOPY) && defined(MSG_ZEROCOPY)
+  // Fall back to copying sends if the kernel does not support MSG_ZEROCOPY
+  m_zerocopy = !setsockopt(m_fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one));
+  if (m_zerocopy) {
+    m_send_flags |= MSG_ZEROCOPY;
+  }
+#endif
+
+  if (m_cq) {
+    m_cq->attach(this, m_fd);
+  }
+  if (m_srq) {
+    ++m_srq->sockets;
+  }
+}
+
+Socket::~Socket() {
+  if (m_cq) {
+    m_cq->detach(m_fd);
+  }
+  if (m_srq) {
+    --m_srq->sockets;
+  }
+  close(m_fd);
+}
+
+void Socket::register_memory(void* buffer, size_t size) {
+  // Nothing to do: the kernel copies (or pins) the user buffers on demand
+}
+
+bool Socket::completed(SendSlot const& slot) const {
+  if (slot.written != sizeof(slot.header) + slot.iov.iov_len) {
+    return false;
+  }
+  // The counters wrap around, so compare them using their difference
+  return !m_zerocopy || static_cast<int32_t>(m_zc_done - slot.last_call) > 0;
+}
+
+void Socket::progress_send() {
+  while (m_send_next != m_send_head && (m_writable || !m_cq)) {
+
+    // Gather the unwritten part of the pending messages
+    m_iov_buffer.clear();
+    size_t requested = 0;
+    for (uint64_t i = m_send_next;
+        i != m_send_head
+            && m_iov_buffer.size() < (1 + MAX_SEND_SGE) * tcp::MAX_SEND_BATCH;
+        ++i) {
+      SendSlot& slot = m_send_slots[i % m_credits];
+      size_t offset = slot.written;
+      if (offset < sizeof(slot.header)) {
+        m_iov_buffer.push_back(
+            { reinterpret_cast<unsigned char*>(&slot.header) + offset,
+                sizeof(slot.header) - offset });
+        offset = 0;
+      } else {
+        offset -= sizeof(slot.header);
+      }
+      for (size_t s = 0; s < slot.n_sge; ++s) {
+        iovec const& sge = slot.sge[s];
+        if (offset < sge.iov_len) {
+          m_iov_buffer.push_back(
+              { static_cast<unsigned char*>(sge.iov_base) + offset,
+                  sge.iov_len - offset });
+          offset = 0;
+        } else {
+          offset -= sge.iov_len;
+        }
+      }
+      requested += sizeof(slot.header) + slot.iov.iov_len - slot.written;
+    }
+
+    msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = m_iov_buffer.data();
+    msg.msg_iovlen = m_iov_buffer.size();
+    ssize_t ret = sendmsg(m_fd, &msg, m_send_flags);
+
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        m_writable = false;
+        return;
+      }
+      // ENOBUFS is returned when the zero-copy notification memory is full,
+      // which is freed by reading the notifications
+      if (errno == ENOBUFS) {
+        return;
+      }
+      throw exception::socket::generic_error(
+          "Error on sendmsg: " + std::string(strerror(errno)));
+    }
+
+    uint32_t const call = m_zc_calls;
+    if (m_zerocopy) {
+      ++m_zc_calls;
+    }
+
+    // Account the written bytes to the pending messages
+    size_t bytes = ret;
+    while (bytes && m_send_next != m_send_head) {
+      SendSlot& slot = m_send_slots[m_send_next % m_credits];
+      size_t const remaining = sizeof(slot.header) + slot.iov.iov_len
+          - slot.written;
+      if (bytes < remaining) {
+        slot.written += bytes;
+        bytes = 0;
+      } else {
+        slot.written += remaining;
+        slot.last_call = call;
+        bytes -= remaining;
+        ++m_send_next;
+      }
+    }
+
+    // The socket buffer is full
+    if (static_cast<size_t>(ret) < requested) {
+      return;
+    }
+  }
+}
+
+void Socket::read_zerocopy_notifications() {
+  while (true) {
+    unsigned char control[128];
+    msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    if (recvmsg(m_fd, &msg, MSG_ERRQUEUE) < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        m_notified = false;
+        return;
+      }
+      throw exception::socket::generic_error(
+          "Error on recvmsg: " + std::string(strerror(errno)));
+    }
+
+    for (cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+      if (!(cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR)
+          && !(cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)) {
+        continue;
+      }
+      auto serr = reinterpret_cast<sock_extended_err*>(CMSG_DATA(cm));
+      if (serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY || serr->ee_errno) {
+        throw exception::socket::generic_error(
+            "Error on zero-copy notification: "
+                + std::string(strerror(serr->ee_errno)));
+      }
+      // Notifications carry the range [ee_info, ee_data] of completed calls
+      uint32_t const done = serr->ee_data + 1;
+      if (static_cast<int32_t>(done - m_zc_done) > 0) {
+        m_zc_done = done;
+      }
+    }
+  }
+}
+
+bool Socket::take_shared_buffer() {
+  if (!m_srq || m_srq->tail == m_srq->head
+      || m_srq_held >= std::max<uint64_t>(
+          m_srq->buffers.size() / m_srq->sockets,
+          1)) {
+    return false;
+  }
+  ++m_srq_held;
+  m_recv_slots[m_recv_head % m_recv_slots.size()] =
+      m_srq->buffers[m_srq->tail++ % m_srq->buffers.size()];
+  ++m_recv_head;
+  return true;
+}
+
+void Socket::progress_recv() {
+  while (m_readable || !m_cq) {
+    iovec iov[2];
+    int iovcnt = 0;
+    if (m_recv_header_read < sizeof(m_recv_header)) {
+      // With a shared queue the buffer is taken after the header
+      if (m_recv_next == m_recv_head && !m_srq) {
+        return;
+      }
+      iov[iovcnt++] = {
+          reinterpret_cast<unsigned char*>(&m_recv_header) + m_recv_header_read,
+          sizeof(m_recv_header) - m_recv_header_read };
+    } else {
+      if (m_recv_next == m_recv_head && !take_shared_buffer()) {
+        return;
+      }
+      iovec& slot = m_recv_slots[m_recv_next % m_recv_slots.size()];
+      if (m_recv_header > slot.iov_len) {
+        throw exception::socket::generic_error(
+            "Error on recv: message longer than the posted buffer");
+      }
+      if (m_recv_payload_read == m_recv_header) {
+        // Empty message
+        slot.iov_len = m_recv_header;
+        ++m_recv_next;
+        m_recv_header_read = 0;
+        continue;
+      }
+      // Read the header of the next message together with the payload
+      iov[iovcnt++] = {
+          static_cast<unsigned char*>(slot.iov_base) + m_recv_payload_read,
+          m_recv_header - m_recv_payload_read };
+      iov[iovcnt++] = { &m_recv_next_header, sizeof(m_recv_next_header) };
+    }
+
+    ssize_t ret = readv(m_fd, iov, iovcnt);
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        m_readable = false;
+        return;
+      }
+      throw exception::socket::generic_error(
+          "Error on readv: " + std::string(strerror(errno)));
+    }
+    if (ret == 0) {
+      throw exception::socket::generic_error(
+          "Error on readv: connection closed by peer");
+    }
+
+    size_t bytes = ret;
+    if (m_recv_header_read < sizeof(m_recv_header)) {
+      m_recv_header_read += bytes;
+      m_recv_payload_read = 0;
+    } else if (bytes < m_recv_header - m_recv_payload_read) {
+      m_recv_payload_read += bytes;
+    } else {
+      bytes -= m_recv_header - m_recv_payload_read;
+      m_recv_slots[m_recv_next % m_recv_slots.size()].iov_len = m_recv_header;
+      ++m_recv_next;
+      std::memcpy(&m_recv_header, &m_recv_next_header, bytes);
+      m_recv_header_read = bytes;
+      m_recv_payload_read = 0;
+    }
+  }
+}
+
+size_t Socket::poll_completed_send(iovec* iov, size_t n) {
+  progress_send();
+  if (m_zerocopy && m_send_tail != m_send_next && (m_notified || !m_cq)) {
+    read_zerocopy_notifications();
+  }
+
+  size_t i = 0;
+  while (i < n && m_send_tail != m_send_next
+      && completed(m_send_slots[m_send_tail % m_credits])) {
+    iov[i++] = m_send_slots[m_send_tail % m_credits].iov;
+    ++m_send_tail;
+  }
+  return i;
+}
+
+size_t Socket::poll_completed_recv(iovec* iov, size_t n) {
+  progress_recv();
+
+  size_t i = 0;
+  for (; i < n && m_recv_tail != m_recv_next; ++m_recv_tail) {
+    iov[i++] = m_recv_slots[m_recv_tail % m_recv_slots.size()];
+  }
+  if (m_srq) {
+    m_srq->outstanding -= i;
+  }
+  return i;
+}
+
+void Socket::post_send(iovec const& iov) {
+  post_send(&iov, 1);
+}
+
+void Socket::post_recv(iovec const& iov) {
+  post_recv(&iov, 1);
+}
+
+void Socket::post_send(iovec const* iov, size_t n) {
+  if (m_send_head - m_send_tail + n > m_credits) {
+    throw exception::socket::generic_error(
+        "Error on post_send: no credits available");
+  }
+
+  for (size_t i = 0; i < n; ++i) {
+    SendSlot& slot = m_send_slots[m_send_head % m_credits];
+    slot.iov = iov[i];
+    slot.sge[0] = iov[i];
+    slot.n_sge = 1;
+    slot.header = iov[i].iov_len;
+    slot.written = 0;
+    ++m_send_head;
+  }
+
+  // Start the transmission immediately, gathering all the messages in the
+  // same sendmsg. The rest is done while polling.
+  progress_send();
+}
+
+void Socket::post_sendv(iovec const* iov, size_t n) {
+  if (m_send_head - m_send_tail == m_credits) {
+    throw exception::socket::generic_error(
+        "Error on post_sendv: no credits available");
+  }
+  if (!n || n > MAX_SEND_SGE) {
+    throw exception::socket::generic_error(
+        "Error on post_sendv: wrong number of segments");
+  }
+
+  // The segments follow each other on the stream, after a single header
+  SendSlot& slot = m_send_slots[m_send_head % m_credits];
+  slot.iov = { iov[0].iov_base, 0 };
+  for (size_t i = 0; i < n; ++i) {
+    slot.sge[i] = iov[i];
+    slot.iov.iov_len += iov[i].iov_len;
+  }
+  slot.n_sge = n;
+  slot.header = slot.iov.iov_len;
+  slot.written = 0;
+  ++m_send_head;
+
+  progress_send();
+}
+
+void Socket::post_recv(iovec const* iov, size_t n) {
+  if (m_srq) {
+    if (m_srq->outstanding + n > m_srq->buffers.size()) {
+      throw exception::socket::generic_error(
+          "Error on post_recv: shared receive queue full");
+    }
+    for (size_t i = 0; i < n; ++i) {
+      m_srq->buffers[m_srq->head % m_srq->buffers.size()] = iov[i];
+      ++m_srq->head;
+    }
+    m_srq->outstanding += n;
+    // The buffers beyond the ones held are posted for the first time
+    m_srq_held -= std::min<uint64_t>(m_srq_held, n);
+    return;
+  }
+
+  if (m_recv_head - m_recv_tail + n > m_credits) {
+    throw exception::socket::generic_error(
+        "Error on post_recv: no credits available");
+  }
+
+  for (size_t i = 0; i < n; ++i) {
+    m_recv_slots[m_recv_head % m_credits] = iov[i];
+    ++m_recv_head;
+  }
+}
+
+bool Socket::available_send() {
+  return m_send_head - m_send_tail < m_credits;
+}
+
+bool Socket::available_recv() {
+  if (m_srq) {
+    return m_srq->outstanding < m_srq->buffers.size();
+  }
+  return m_recv_head - m_recv_tail < m_credits;
+}
+
+std::vector<iovec> Socket::pending_send() {
+  std::vector<iovec> iov_vect;
+  iov_vect.reserve(m_send_head - m_send_tail);
+  for (uint64_t i = m_send_tail; i != m_send_head; ++i) {
+    iov_vect.push_back(m_send_slots[i % m_credits].iov);
+  }
+  return iov_vect;
+}
+
+std::vector<iovec> Socket::pending_recv() {
+  // With a shared queue, the buffers not yet taken by any socket are
+  // reported as well
+  std::vector<iovec> iov_vect;
+  for (uint64_t i = m_recv_tail; i != m_recv_head; ++i) {
+    iov_vect.push_back(m_recv_slots[i % m_recv_slots.size()]);
+  }
+  if (m_srq) {
+    for (uint64_t i = m_srq->tail; i != m_srq->head; ++i) {
+      iov_vect.push_back(m_srq->buffers[i % m_srq->buffers.size()]);
+    }
+  }
+  return iov_vect;
+}
+
+std::vector<int> Socket::wait_fds() {
+  if (m_cq) {
+    return m_cq->wait_fds();
+  }
+  return {m_fd};
+}
+
+std::string Socket::peer_hostname() {
+  char str[INET_ADDRSTRLEN];
+  sockaddr_in addr;
+  socklen_t len = sizeof(addr);
+  getpeername(m_fd, reinterpret_cast<sockaddr*>(&addr), &len);
+  inet_ntop(AF_INET, &(addr.sin_addr), str, INET_ADDRSTRLEN);
+  return str;
+}
+
+}
@@ -0,0 +1,138 @@
+#ifndef TRANSPORT_TCP_SOCKET_H
+#define TRANSPORT_TCP_SOCKET_H
+
+#include <memory>
+#include <vector>
+#include <string>
+
+#include <cstdint>
+
+#include <sys/uio.h>
+
+#include "transport/connection.h"
+#include "transport/tcp/completion_queue.h"
+
+namespace lseb {
+
+namespace tcp {
+static const int LISTEN_BACKLOG = 128;
+static const int CONNECT_TIMEOUT_MS = 1000;
+// Maximum number of messages gathered in a single writev
+static const int MAX_SEND_BATCH = 64;
+}
+
+// Receive buffers shared by all the sockets of an acceptor. A socket takes
+// the first one when it has read the header of a message, so the buffers are
+// used by the peers that are sending instead of being reserved to each one.
+// A socket holds at most its share of them until they are posted again
+// through it, so that a peer that is ahead of the others cannot take them
+// all while the receiver waits for the others.
+struct SharedReceiveQueue {
+  std::vector<iovec> buffers;
+  uint64_t head;  // next buffer to post
+  uint64_t tail;  // next buffer to take
+  uint32_t outstanding;  // posted and not yet completed
+  uint32_t sockets;  // sharing the buffers
+
+  explicit SharedReceiveQueue(uint32_t size);
+};
+
+// Each message is sent on the stream preceded by a fixed size header that
+// carries its length, so that the receiver can split the byte stream back
+// into messages and deliver each one in a separately posted buffer.
+
+class Socket : public Connection {
+
+  struct SendSlot {
+    iovec iov;  // as completed: the first segment, with the whole length
+    iovec sge[MAX_SEND_SGE];
+    size_t n_sge;
+    uint64_t header;
+    size_t written;  // bytes of header + payload already handed to the kernel
+    uint32_t last_call;  // zero-copy call that wrote the last byte
+  };
+
+  int m_fd;
+  uint32_t m_credits;
+
+  // Posted sends and receives are stored in fixed rings of m_credits slots and
+  // completed in the same order in which they were posted
+  std::vector<SendSlot> m_send_slots;
+  uint64_t m_send_head;  // next slot to post
+  uint64_t m_send_next;  // first slot not entirely written
+  uint64_t m_send_tail;  // first slot not completed
+
+  std::vector<iovec> m_recv_slots;
+  std::shared_ptr<SharedReceiveQueue> m_srq;
+  uint64_t m_recv_head;  // next slot to post
+  uint64_t m_recv_next;  // slot being filled
+  uint64_t m_recv_tail;  // first slot not completed
+  uint64_t m_srq_held;  // shared buffers taken and not yet posted again
+
+  uint64_t m_recv_header;
+  uint64_t m_recv_next_header;
+  size_t m_recv_header_read;
+  size_t m_recv_payload_read;
+
+  std::vector<iovec> m_iov_buffer;
+
+  int m_send_flags;
+  bool m_zerocopy;
+  uint32_t m_zc_calls;  // zero-copy sendmsg calls issued
+  uint32_t m_zc_done;  // zero-copy calls acknowledged by the kernel
+
+  // With a shared completion queue, the socket is read and written only once
+  // the queue has reported it ready
+  std::shared_ptr<CompletionQueue> m_cq;
+  bool m_readable;
+  bool m_writable;
+  bool m_notified;  // zero-copy notifications to read
+
+  friend class CompletionQueue;
+
+  void progress_send();
+  void progress_recv();
+  void read_zerocopy_notifications();
+  bool take_shared_buffer();
+  bool completed(SendSlot const& slot) const;
+
+ public:
+
+  // Receives are posted to srq, if given, instead of to the socket. The
+  // readiness of the socket is read from cq, if given.
+  Socket(
+      int fd,
+      uint32_t credits,
+      std::shared_ptr<SharedReceiveQueue> const& srq = nullptr,
+      std::shared_ptr<CompletionQueue> const& cq = nullptr);
+  Socket(Socket const& other) = delete;  // non construction-copyable
+  Socket& operator=(Socket const&) = delete;  // non copyable
+  ~Socket() override;
+
+  void register_memory(void* buffer, size_t size) override;
+
+  using Connection::poll_completed_send;
+  using Connection::poll_completed_recv;
+  size_t poll_completed_send(iovec* iov, size_t n) override;
+  size_t poll_completed_recv(iovec* iov, size_t n) override;
+
+  void post_send(iovec const& iov) override;
+  void post_recv(iovec const& iov) override;
+  void post_send(iovec const* iov, size_t n) override;
+  void post_recv(iovec const* iov, size_t n) override;
+  void post_sendv(iovec const* iov, size_t n) override;
+
+  bool available_send() override;
+  bool available_recv() override;
+
+  std::vector<iovec> pending_send() override;
+  std::vector<iovec> pending_recv() override;
+
+  std::string peer_hostname() override;
+
+  std::vector<int> wait_fds() override;
+};
+
+}
+
+#endif
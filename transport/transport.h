@@ -9,8 +9,28 @@
 #include "transport/libfabric/socket.h"
 #include "transport/libfabric/acceptor.h"
 #include "transport/libfabric/connector.h"
+#elif defined(TCP)
+#include "transport/tcp/socket.h"
+#include "transport/tcp/acceptor.h"
+#include "transport/tcp/connector.h"
 #else
 static_assert(true, "Missing transport layer!");
 #endif
 
+// Intra-node transports, available with any transport layer
+#include "transport/shm/socket.h"
+#include "transport/shm/acceptor.h"
+#include "transport/shm/connector.h"
+#include "transport/local/socket.h"
+#include "transport/local/acceptor.h"
+#include "transport/local/connector.h"
+
+// Unreliable datagrams, available with any transport layer
+#include "transport/dgram/socket.h"
+#include "transport/dgram/acceptor.h"
+#include "transport/dgram/connector.h"
+
+// Reverse channel of the Builder Units, available with any transport layer
+#include "transport/feedback.h"
+
 #endif
@@ -33,7 +33,9 @@ void destroy_addr_info(rdma_addrinfo* res) {
 namespace lseb {
 
 Acceptor::Acceptor(int credits)
-    : m_cm_id(nullptr) {
+    : m_cm_id(nullptr),
+      m_srq_size(0),
+      m_write_ring(false) {
   m_credits = credits;
   m_min_rtr_timer = verbs::MIN_RTR_TIMER;
   m_rnr_retry_count = verbs::RNR_RETRY_COUNT;
@@ -43,18 +45,56 @@ Acceptor::~Acceptor() {
   rdma_destroy_ep(m_cm_id);
 }
 
-void Acceptor::listen(std::string const& hostname, std::string const& port) {
-  auto res = create_addr_info(hostname, port);
+ibv_qp_init_attr Acceptor::qp_init_attr() const {
   ibv_qp_init_attr init_attr;
   memset(&init_attr, 0, sizeof(init_attr));
   init_attr.cap.max_send_wr = m_credits;
   init_attr.cap.max_recv_wr = m_credits;
-  init_attr.cap.max_send_sge = 1;
+  if (m_write_ring) {
+    // The sends are the updates of the ring, each write consumes a receive
+    init_attr.cap.max_send_wr = write_ring::UPDATES;
+    init_attr.cap.max_recv_wr = m_credits * write_ring::MESSAGES_PER_BUFFER;
+  }
+  init_attr.cap.max_send_sge = MAX_SEND_SGE;
   init_attr.cap.max_recv_sge = 1;
   init_attr.cap.max_inline_data = 0;
-  init_attr.sq_sig_all = 1;
+  init_attr.sq_sig_all = 0;  // the socket chooses the signaled sends
   init_attr.qp_type = IBV_QPT_RC;
-  int ret = rdma_create_ep(&m_cm_id, res, NULL, &init_attr);
+  return init_attr;
+}
+
+void Acceptor::share_receive_queue(int size) {
+  m_srq_size = size;
+}
+
+void Acceptor::share_completion_queue(
+    std::shared_ptr<CompletionQueue> const& cq) {
+  m_cq = cq;
+}
+
+void Acceptor::enable_wait() {
+  // The queues created by librdmacm report to a completion channel, so
+  // they can always be waited for
+}
+
+void Acceptor::enable_write_ring() {
+  m_write_ring = true;
+}
+
+void Acceptor::enable_rdm() {
+  throw exception::acceptor::generic_error(
+      "Error on enable_rdm: not supported by verbs");
+}
+
+void Acceptor::listen(std::string const& hostname, std::string const& port) {
+  auto res = create_addr_info(hostname, port);
+  ibv_qp_init_attr init_attr = qp_init_attr();
+  // With shared queues the queue pairs are created on accept
+  int ret = rdma_create_ep(
+      &m_cm_id,
+      res,
+      NULL,
+      (m_srq_size || m_cq) ? NULL : &init_attr);
   destroy_addr_info(res);
   if (ret) {
     rdma_destroy_ep(m_cm_id);
@@ -76,6 +116,36 @@ std::unique_ptr<Socket> Acceptor::accept() {
         "Error on rdma_get_request: " + std::string(strerror(errno)));
   }
 
+  if (m_srq_size || m_cq) {
+    try {
+      if (m_srq_size && !m_srq) {
+        m_srq = std::make_shared<SharedReceiveQueue>(
+            new_cm_id->verbs,
+            m_srq_size);
+      }
+      if (m_cq) {
+        m_cq->create(new_cm_id->verbs);
+      }
+    } catch (std::exception& e) {
+      rdma_destroy_ep(new_cm_id);
+      throw exception::acceptor::generic_error(e.what());
+    }
+    ibv_qp_init_attr init_attr = qp_init_attr();
+    if (m_srq) {
+      init_attr.cap.max_recv_wr = 0;
+      init_attr.srq = m_srq->srq;
+    }
+    if (m_cq) {
+      init_attr.send_cq = m_cq->send_cq();
+      init_attr.recv_cq = m_cq->recv_cq();
+    }
+    if (rdma_create_qp(new_cm_id, m_srq ? m_srq->pd : NULL, &init_attr)) {
+      rdma_destroy_ep(new_cm_id);
+      throw exception::acceptor::generic_error(
+          "Error on rdma_create_qp: " + std::string(strerror(errno)));
+    }
+  }
+
   rdma_conn_param conn_param;
   memset(&conn_param, 0, sizeof(rdma_conn_param));
   conn_param.rnr_retry_count = m_rnr_retry_count;
@@ -95,7 +165,15 @@ std::unique_ptr<Socket> Acceptor::accept() {
         "Error on ibv_modify_qp: " + std::string(strerror(errno)));
   }
 
-  std::unique_ptr<Socket> socket_ptr(new Socket(new_cm_id, m_credits));
+  std::unique_ptr<Socket> socket_ptr(
+      new Socket(new_cm_id, m_credits, 1, m_srq, m_cq));
+  if (m_write_ring) {
+    try {
+      socket_ptr->enable_write_ring(false);
+    } catch (std::exception& e) {
+      throw exception::acceptor::generic_error(e.what());
+    }
+  }
   return socket_ptr;
 }
 
@@ -18,11 +18,32 @@ class Acceptor {
 
   rdma_cm_id* m_cm_id;
 
+  // Created on the first accepted connection, when its device is known
+  uint32_t m_srq_size;
+  std::shared_ptr<SharedReceiveQueue> m_srq;
+  std::shared_ptr<CompletionQueue> m_cq;
+  bool m_write_ring;
+
+  ibv_qp_init_attr qp_init_attr() const;
+
  public:
 
   Acceptor(int credits);
   Acceptor(Acceptor const& other) = delete;  // non construction-copyable
   Acceptor& operator=(Acceptor const&) = delete;  // non copyable
+  // The sockets accepted afterwards post their receives to a single queue of
+  // the given size. It must be called before listen.
+  void share_receive_queue(int size);
+  // The sockets accepted afterwards report their completions to cq. It must
+  // be called before listen.
+  void share_completion_queue(std::shared_ptr<CompletionQueue> const& cq);
+  // The sockets accepted afterwards can be waited for, see
+  // Connection::wait_fds. It must be called before listen.
+  void enable_wait();
+  // The sockets accepted afterwards receive the messages written into a ring,
+  // see Socket::enable_write_ring. It must be called before listen.
+  void enable_write_ring();
+  void enable_rdm();
   void listen(std::string const& hostname, std::string const& port);
   ~Acceptor();
   std::unique_ptr<Socket> accept();
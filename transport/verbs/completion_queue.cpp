@@ -0,0 +1,165 @@
+#include "transport/verbs/completion_queue.h"
+
+#include <string>
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+
+#include "common/exception.h"
+#include "transport/verbs/socket.h"
+
+namespace lseb {
+
+void arm_completion_queue(ibv_comp_channel* channel, ibv_cq* cq) {
+  ibv_cq* event_cq;
+  void* event_context;
+  while (!ibv_get_cq_event(channel, &event_cq, &event_context)) {
+    ibv_ack_cq_events(event_cq, 1);
+  }
+  if (errno != EAGAIN) {
+    throw exception::socket::generic_error(
+        "Error on ibv_get_cq_event: " + std::string(strerror(errno)));
+  }
+  int ret = ibv_req_notify_cq(cq, 0);
+  if (ret) {
+    throw exception::socket::generic_error(
+        "Error on ibv_req_notify_cq: " + std::string(strerror(ret)));
+  }
+}
+
+CompletionQueue::CompletionQueue(uint32_t size, bool wait)
+    : m_size(size),
+      m_wait(wait),
+      m_context(nullptr),
+      m_channel(nullptr),
+      m_send_cq(nullptr),
+      m_recv_cq(nullptr),
+      m_wcs(size) {
+}
+
+CompletionQueue::~CompletionQueue() {
+  if (m_send_cq) {
+    ibv_destroy_cq(m_send_cq);
+  }
+  if (m_recv_cq) {
+    ibv_destroy_cq(m_recv_cq);
+  }
+  if (m_channel) {
+    ibv_destroy_comp_channel(m_channel);
+  }
+}
+
+void CompletionQueue::create(ibv_context* context) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_context) {
+    if (m_context != context) {
+      throw exception::socket::generic_error(
+          "Error on create: completion queue bound to another device");
+    }
+    return;
+  }
+  if (m_wait) {
+    m_channel = ibv_create_comp_channel(context);
+    if (!m_channel) {
+      throw exception::socket::generic_error(
+          "Error on ibv_create_comp_channel: "
+              + std::string(strerror(errno)));
+    }
+    int const flags = fcntl(m_channel->fd, F_GETFL);
+    if (flags == -1 || fcntl(m_channel->fd, F_SETFL, flags | O_NONBLOCK)) {
+      throw exception::socket::generic_error(
+          "Error on fcntl: " + std::string(strerror(errno)));
+    }
+  }
+  m_send_cq = ibv_create_cq(context, m_size, nullptr, m_channel, 0);
+  if (!m_send_cq) {
+    throw exception::socket::generic_error(
+        "Error on ibv_create_cq: " + std::string(strerror(errno)));
+  }
+  m_recv_cq = ibv_create_cq(context, m_size, nullptr, m_channel, 0);
+  if (!m_recv_cq) {
+    ibv_destroy_cq(m_send_cq);
+    m_send_cq = nullptr;
+    throw exception::socket::generic_error(
+        "Error on ibv_create_cq: " + std::string(strerror(errno)));
+  }
+  m_context = context;
+}
+
+ibv_cq* CompletionQueue::send_cq() const {
+  return m_send_cq;
+}
+
+ibv_cq* CompletionQueue::recv_cq() const {
+  return m_recv_cq;
+}
+
+std::vector<int> CompletionQueue::wait_fds() const {
+  if (!m_channel) {
+    return {};
+  }
+  return {m_channel->fd};
+}
+
+bool CompletionQueue::arm_wait() {
+  if (m_channel) {
+    arm_completion_queue(m_channel, m_send_cq);
+    arm_completion_queue(m_channel, m_recv_cq);
+  }
+  return true;
+}
+
+void CompletionQueue::attach(Socket* socket, uint32_t qp_num) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_sockets[qp_num] = socket;
+}
+
+void CompletionQueue::detach(uint32_t qp_num) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_sockets.erase(qp_num);
+}
+
+void CompletionQueue::poll() {
+  if (!m_context) {
+    return;
+  }
+
+  int ret = ibv_poll_cq(m_send_cq, m_wcs.size(), &m_wcs.front());
+  if (ret < 0) {
+    throw exception::socket::generic_error(
+        "Error on ibv_poll_cq: " + std::string(strerror(ret)));
+  }
+  for (int i = 0; i < ret; ++i) {
+    if (m_wcs[i].status) {
+      throw exception::socket::generic_error(
+          "Error status in wc of send_cq: "
+              + std::string(ibv_wc_status_str(m_wcs[i].status)));
+    }
+    auto it = m_sockets.find(m_wcs[i].qp_num);
+    // Completions of a socket already closed are dropped
+    if (it != std::end(m_sockets)) {
+      it->second->complete_send(m_wcs[i]);
+    }
+  }
+
+  ret = ibv_poll_cq(m_recv_cq, m_wcs.size(), &m_wcs.front());
+  if (ret < 0) {
+    throw exception::socket::generic_error(
+        "Error on ibv_poll_cq: " + std::string(strerror(ret)));
+  }
+  for (int i = 0; i < ret; ++i) {
+    if (m_wcs[i].status) {
+      throw exception::socket::generic_error(
+          "Error status in wc of recv_cq: "
+              + std::string(ibv_wc_status_str(m_wcs[i].status)));
+    }
+    auto it = m_sockets.find(m_wcs[i].qp_num);
+    if (it != std::end(m_sockets)) {
+      it->second->complete_recv(m_wcs[i]);
+    }
+  }
+}
+
+}
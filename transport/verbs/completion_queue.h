@@ -0,0 +1,62 @@
+#ifndef TRANSPORT_VERBS_COMPLETION_QUEUE_H
+#define TRANSPORT_VERBS_COMPLETION_QUEUE_H
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <cstdint>
+
+#include <infiniband/verbs.h>
+
+namespace lseb {
+
+class Socket;
+
+// Drain the events of channel, then request an event for the next completion
+// of cq. The descriptor of channel must be non-blocking.
+void arm_completion_queue(ibv_comp_channel* channel, ibv_cq* cq);
+
+// Send and receive completion queues shared by all the queue pairs bound to
+// it. A single ibv_poll_cq per direction reads the completions of all the
+// connections, which are handed to their socket by queue pair number.
+
+class CompletionQueue {
+  uint32_t m_size;
+  bool m_wait;
+  ibv_context* m_context;
+  ibv_comp_channel* m_channel;  // shared by the two queues
+  ibv_cq* m_send_cq;
+  ibv_cq* m_recv_cq;
+  // The sockets are attached while connecting, possibly from several threads
+  std::mutex m_mutex;
+  std::unordered_map<uint32_t, Socket*> m_sockets;
+  std::vector<ibv_wc> m_wcs;
+
+ public:
+  // With wait, the queues report their completions to a channel, so that
+  // they can be waited for
+  explicit CompletionQueue(uint32_t size, bool wait = false);
+  CompletionQueue(CompletionQueue const& other) = delete;  // non construction-copyable
+  CompletionQueue& operator=(CompletionQueue const&) = delete;  // non copyable
+  ~CompletionQueue();
+
+  // The queues are created with the first queue pair, when the device is
+  // known. All the queue pairs must belong to the same device.
+  void create(ibv_context* context);
+  ibv_cq* send_cq() const;
+  ibv_cq* recv_cq() const;
+
+  std::vector<int> wait_fds() const;
+  bool arm_wait();
+
+  void attach(Socket* socket, uint32_t qp_num);
+  void detach(uint32_t qp_num);
+
+  // Hand the completions to the sockets, which return them when polled
+  void poll();
+};
+
+}
+
+#endif
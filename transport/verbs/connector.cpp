@@ -31,13 +31,34 @@ void destroy_addr_info(rdma_addrinfo* res) {
 
 namespace lseb {
 
-Connector::Connector(int credits) {
+Connector::Connector(int credits, int signal_interval) {
   m_credits = credits;
+  m_signal_interval = signal_interval;
+  m_write_ring = false;
   m_min_rtr_timer = verbs::MIN_RTR_TIMER;
   m_retry_count = verbs::RETRY_COUNT;
   m_rnr_retry_count = verbs::RNR_RETRY_COUNT;
 }
 
+void Connector::share_completion_queue(
+    std::shared_ptr<CompletionQueue> const& cq) {
+  m_cq = cq;
+}
+
+void Connector::enable_wait() {
+  // The queues created by librdmacm report to a completion channel, so
+  // they can always be waited for
+}
+
+void Connector::enable_write_ring() {
+  m_write_ring = true;
+}
+
+void Connector::enable_rdm() {
+  throw exception::connector::generic_error(
+      "Error on enable_rdm: not supported by verbs");
+}
+
 std::unique_ptr<Socket> Connector::connect(
     std::string const& hostname,
     std::string const& port) {
@@ -46,19 +67,41 @@ std::unique_ptr<Socket> Connector::connect(
   memset(&init_attr, 0, sizeof(init_attr));
   init_attr.cap.max_send_wr = m_credits;
   init_attr.cap.max_recv_wr = m_credits;
-  init_attr.cap.max_send_sge = 1;
+  if (m_write_ring) {
+    // The receives are the updates of the ring
+    init_attr.cap.max_recv_wr = write_ring::UPDATES;
+  }
+  init_attr.cap.max_send_sge = MAX_SEND_SGE;
   init_attr.cap.max_recv_sge = 1;
   init_attr.cap.max_inline_data = 0;
-  init_attr.sq_sig_all = 1;
+  init_attr.sq_sig_all = 0;  // the socket chooses the signaled sends
   init_attr.qp_type = IBV_QPT_RC;
   rdma_cm_id* cm_id;
-  int ret = rdma_create_ep(&cm_id, res, NULL, &init_attr);
+  // With a shared completion queue the queue pair is created once that the
+  // device is known
+  int ret = rdma_create_ep(&cm_id, res, NULL, m_cq ? NULL : &init_attr);
   destroy_addr_info(res);
   if (ret) {
     throw exception::connector::generic_error(
         "Error on rdma_create_ep: " + std::string(strerror(errno)));
   }
 
+  if (m_cq) {
+    try {
+      m_cq->create(cm_id->verbs);
+    } catch (std::exception& e) {
+      rdma_destroy_ep(cm_id);
+      throw exception::connector::generic_error(e.what());
+    }
+    init_attr.send_cq = m_cq->send_cq();
+    init_attr.recv_cq = m_cq->recv_cq();
+    if (rdma_create_qp(cm_id, NULL, &init_attr)) {
+      rdma_destroy_ep(cm_id);
+      throw exception::connector::generic_error(
+          "Error on rdma_create_qp: " + std::string(strerror(errno)));
+    }
+  }
+
   rdma_conn_param conn_param;
   memset(&conn_param, 0, sizeof(rdma_conn_param));
   conn_param.retry_count = m_retry_count;
@@ -79,7 +122,17 @@ std::unique_ptr<Socket> Connector::connect(
         "Error on ibv_modify_qp: " + std::string(strerror(errno)));
   }
 
-  std::unique_ptr<Socket> socket_ptr(new Socket(cm_id, m_credits));
+  std::unique_ptr<Socket> socket_ptr(
+      new Socket(cm_id, m_credits, m_signal_interval, nullptr, m_cq));
+  if (m_write_ring) {
+    // An update sent by the peer before its receive is posted is retried,
+    // since the receiver not ready retries are unlimited
+    try {
+      socket_ptr->enable_write_ring(true);
+    } catch (std::exception& e) {
+      throw exception::connector::generic_error(e.what());
+    }
+  }
   return socket_ptr;
 }
 
@@ -14,16 +14,29 @@ namespace lseb {
 class Connector {
 
   uint32_t m_credits;
+  int m_signal_interval;
 
   uint8_t m_min_rtr_timer;
   uint8_t m_retry_count;
   uint8_t m_rnr_retry_count;
 
+  std::shared_ptr<CompletionQueue> m_cq;
+  bool m_write_ring;
+
  public:
 
-  Connector(int credits);
+  Connector(int credits, int signal_interval = 1);
   Connector(Connector const& other) = delete;  // non construction-copyable
   Connector& operator=(Connector const&) = delete;  // non copyable
+  // The sockets connected afterwards report their completions to cq
+  void share_completion_queue(std::shared_ptr<CompletionQueue> const& cq);
+  // The sockets connected afterwards can be waited for, see
+  // Connection::wait_fds
+  void enable_wait();
+  // The sockets connected afterwards write the messages into a ring of the
+  // peer, see Socket::enable_write_ring
+  void enable_write_ring();
+  void enable_rdm();
   std::unique_ptr<Socket> connect(
       std::string const& hostname,
       std::string const& port);
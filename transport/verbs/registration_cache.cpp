@@ -0,0 +1,46 @@
+#include "transport/verbs/registration_cache.h"
+
+#include <string>
+
+#include <cerrno>
+#include <cstring>
+
+#include "common/exception.h"
+
+namespace lseb {
+
+RegistrationCache& RegistrationCache::get_instance() {
+  static RegistrationCache instance;
+  return instance;
+}
+
+ibv_mr* RegistrationCache::acquire(ibv_pd* pd, void* buffer, size_t size) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto& regions = m_regions[pd];
+  ibv_mr* const* cached = regions.find(buffer, size);
+  if (cached) {
+    ++m_references[*cached];
+    return *cached;
+  }
+  ibv_mr* mr = ibv_reg_mr(pd, buffer, size, IBV_ACCESS_LOCAL_WRITE);
+  if (!mr) {
+    throw exception::socket::generic_error(
+        "Error on ibv_reg_mr: " + std::string(strerror(errno)));
+  }
+  regions.insert(buffer, size, mr);
+  m_references[mr] = 1;
+  return mr;
+}
+
+void RegistrationCache::release(ibv_mr* mr) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_references.find(mr);
+  if (it == std::end(m_references) || --it->second) {
+    return;
+  }
+  m_references.erase(it);
+  m_regions[mr->pd].erase(mr);
+  ibv_dereg_mr(mr);
+}
+
+}
@@ -0,0 +1,35 @@
+#ifndef TRANSPORT_VERBS_REGISTRATION_CACHE_H
+#define TRANSPORT_VERBS_REGISTRATION_CACHE_H
+
+#include <map>
+#include <mutex>
+
+#include <infiniband/verbs.h>
+
+#include "transport/memory_regions.h"
+
+namespace lseb {
+
+// Memory registrations shared by all the connections of a protection domain,
+// so that a buffer used with many peers is pinned only once. Registrations
+// are reference counted and released together with the last connection.
+
+class RegistrationCache {
+  std::mutex m_mutex;
+  std::map<ibv_pd*, MemoryRegions<ibv_mr*> > m_regions;
+  std::map<ibv_mr*, int> m_references;
+
+  RegistrationCache() = default;
+
+ public:
+  static RegistrationCache& get_instance();
+  RegistrationCache(RegistrationCache const&) = delete;  // non construction-copyable
+  RegistrationCache& operator=(RegistrationCache const&) = delete;  // non copyable
+
+  ibv_mr* acquire(ibv_pd* pd, void* buffer, size_t size);
+  void release(ibv_mr* mr);
+};
+
+}
+
+#endif
@@ -1,209 +1,599 @@
 #include "transport/verbs/socket.h"
 
+#include <algorithm>
+
 #include <arpa/inet.h>
+#include <fcntl.h>
 #include "common/exception.h"
+#include "transport/verbs/registration_cache.h"
 
-namespace {
-std::vector<ibv_mr*>::const_iterator find_mr(
-    std::vector<ibv_mr*> const& mrs,
-    iovec const& iov) {
-  auto it = std::begin(mrs);
-  for (; it != std::end(mrs); ++it) {
-    ibv_mr* mr = *it;
-    if (mr->addr <= iov.iov_base
-        && mr->addr + mr->length >= iov.iov_base + iov.iov_len) {
-      break;
-    }
+namespace lseb {
+
+SharedReceiveQueue::SharedReceiveQueue(ibv_context* context, uint32_t size)
+    : pending(size),
+      wrs(size),
+      sges(size) {
+  pd = ibv_alloc_pd(context);
+  if (!pd) {
+    throw exception::socket::generic_error(
+        "Error on ibv_alloc_pd: " + std::string(strerror(errno)));
+  }
+  ibv_srq_init_attr init_attr;
+  memset(&init_attr, 0, sizeof(init_attr));
+  init_attr.attr.max_wr = size;
+  init_attr.attr.max_sge = 1;
+  srq = ibv_create_srq(pd, &init_attr);
+  if (!srq) {
+    ibv_dealloc_pd(pd);
+    throw exception::socket::generic_error(
+        "Error on ibv_create_srq: " + std::string(strerror(errno)));
   }
-  return it;
-}
 }
 
-namespace lseb {
+SharedReceiveQueue::~SharedReceiveQueue() {
+  ibv_destroy_srq(srq);
+  ibv_dealloc_pd(pd);
+}
 
-Socket::Socket(rdma_cm_id* cm_id, uint32_t credits)
+Socket::Socket(
+    rdma_cm_id* cm_id,
+    uint32_t credits,
+    int signal_interval,
+    std::shared_ptr<SharedReceiveQueue> const& srq,
+    std::shared_ptr<CompletionQueue> const& cq)
     : m_cm_id(cm_id),
       m_credits(credits),
+      m_pending_send(m_credits),
+      m_pending_recv(m_credits),
+      m_srq(srq),
+      m_signal_interval(signal_interval),
+      m_unsignaled(0),
+      m_send_order(m_credits),
       m_comp_send(m_credits),
-      m_comp_recv(m_credits) {
+      m_comp_recv(m_credits),
+      m_send_wrs(m_credits),
+      m_recv_wrs(m_credits),
+      m_send_sges(std::max<size_t>(m_credits, MAX_SEND_SGE)),
+      m_recv_sges(m_credits),
+      m_cq(cq),
+      m_ring_mr(nullptr),
+      m_updates_mr(nullptr),
+      m_updates_sent(0),
+      m_updates_done(0),
+      m_update_pending(false) {
+  if (m_cq) {
+    m_recv_done.reserve(srq ? srq->pending.capacity() : m_credits);
+    m_cq->attach(this, m_cm_id->qp->qp_num);
+  }
+
+  // The queues created by librdmacm report to a channel each, which is only
+  // read when arming them
+  for (ibv_comp_channel* channel : {
+      m_cm_id->send_cq_channel,
+      m_cm_id->recv_cq_channel}) {
+    if (!channel) {
+      continue;
+    }
+    int const flags = fcntl(channel->fd, F_GETFL);
+    if (flags == -1 || fcntl(channel->fd, F_SETFL, flags | O_NONBLOCK)) {
+      throw exception::socket::generic_error(
+          "Error on fcntl: " + std::string(strerror(errno)));
+    }
+  }
 }
 
 Socket::~Socket() {
-  auto it = std::begin(m_mrs);
-  for (; it != std::end(m_mrs); ++it) {
-    ibv_dereg_mr(*it);
+  if (m_cq) {
+    m_cq->detach(m_cm_id->qp->qp_num);
+  }
+  m_mrs.for_each([](ibv_mr* mr) {
+    RegistrationCache::get_instance().release(mr);
+  });
+  if (m_ring_mr) {
+    ibv_dereg_mr(m_ring_mr);
+  }
+  if (m_updates_mr) {
+    ibv_dereg_mr(m_updates_mr);
   }
   rdma_destroy_ep(m_cm_id);
 }
 
-void Socket::register_memory(void* buffer, size_t size) {
-  ibv_mr* mr = ibv_reg_mr(m_cm_id->pd, buffer, size, IBV_ACCESS_LOCAL_WRITE);
-  if (!mr) {
+void Socket::enable_write_ring(bool writer) {
+  m_updates.resize(write_ring::UPDATES);
+  m_updates_mr = ibv_reg_mr(
+      m_cm_id->pd,
+      m_updates.data(),
+      m_updates.size() * sizeof(RingUpdate),
+      IBV_ACCESS_LOCAL_WRITE);
+  if (!m_updates_mr) {
     throw exception::socket::generic_error(
         "Error on ibv_reg_mr: " + std::string(strerror(errno)));
   }
-  m_mrs.push_back(mr);
+
+  if (writer) {
+    m_ring_writer.reset(new RingWriter);
+    for (uint64_t i = 0; i < m_updates.size(); ++i) {
+      post_update_recv(i);
+    }
+  } else {
+    // A write consumes a receive, posted without buffers
+    m_ring_receiver.reset(new RingReceiver);
+    size_t const slots = m_credits * write_ring::MESSAGES_PER_BUFFER;
+    m_recv_wrs.resize(slots);
+    m_recv_done.reserve(slots);
+  }
+}
+
+void Socket::complete_send(ibv_wc const& wc) {
+  if (m_ring_receiver) {
+    // The updates are the only sends of the receiver, all signaled
+    ++m_updates_done;
+  } else {
+    m_send_order.retire(wc.wr_id);
+  }
+}
+
+void Socket::complete_recv(ibv_wc const& wc) {
+  if (m_ring_writer) {
+    m_ring_writer->update(m_updates[wc.wr_id]);
+    post_update_recv(wc.wr_id);
+  } else if (m_ring_receiver) {
+    m_recv_done.push_back(receive_write(wc));
+  } else {
+    SlotArray& pending = m_srq ? m_srq->pending : m_pending_recv;
+    iovec iov = pending.release(wc.wr_id);
+    iov.iov_len = wc.byte_len;
+    m_recv_done.push_back(iov);
+  }
+}
+
+iovec Socket::receive_write(ibv_wc const& wc) {
+  if (!(wc.wc_flags & IBV_WC_WITH_IMM)) {
+    throw exception::socket::generic_error(
+        "Error on receive_write: write without immediate data");
+  }
+  return m_ring_receiver->receive(ntohl(wc.imm_data));
 }
 
-std::vector<iovec> Socket::poll_completed_send() {
+void Socket::post_write_recvs(size_t n) {
+  if (!n) {
+    return;
+  }
+  for (size_t i = 0; i < n; ++i) {
+    ibv_recv_wr& wr = m_recv_wrs[i];
+    wr.wr_id = 0;
+    wr.next = (i + 1 < n) ? &m_recv_wrs[i + 1] : nullptr;
+    wr.sg_list = nullptr;
+    wr.num_sge = 0;
+  }
+  ibv_recv_wr* bad_wr;
+  int ret = ibv_post_recv(m_cm_id->qp, &m_recv_wrs.front(), &bad_wr);
+  if (ret) {
+    throw exception::socket::generic_error(
+        "Error on ibv_post_recv: " + std::string(strerror(ret)));
+  }
+}
+
+void Socket::post_update_recv(uint64_t index) {
+  ibv_sge sge;
+  sge.addr = reinterpret_cast<uint64_t>(&m_updates[index]);
+  sge.length = sizeof(RingUpdate);
+  sge.lkey = m_updates_mr->lkey;
+  ibv_recv_wr wr;
+  memset(&wr, 0, sizeof(wr));
+  wr.wr_id = index;
+  wr.sg_list = &sge;
+  wr.num_sge = 1;
+  ibv_recv_wr* bad_wr;
+  int ret = ibv_post_recv(m_cm_id->qp, &wr, &bad_wr);
+  if (ret) {
+    throw exception::socket::generic_error(
+        "Error on ibv_post_recv: " + std::string(strerror(ret)));
+  }
+}
+
+void Socket::send_update() {
+  // Only the latest update matters: if all are in flight, it is sent as soon
+  // as one of them completes
+  if (m_updates_sent - m_updates_done == m_updates.size()) {
+    m_update_pending = true;
+    return;
+  }
+  m_update_pending = false;
+  uint64_t const index = m_updates_sent % m_updates.size();
+  m_updates[index] = m_ring_receiver->update();
+
+  ibv_sge sge;
+  sge.addr = reinterpret_cast<uint64_t>(&m_updates[index]);
+  sge.length = sizeof(RingUpdate);
+  sge.lkey = m_updates_mr->lkey;
+  ibv_send_wr wr;
+  memset(&wr, 0, sizeof(wr));
+  wr.wr_id = index;
+  wr.sg_list = &sge;
+  wr.num_sge = 1;
+  wr.opcode = IBV_WR_SEND;
+  wr.send_flags = IBV_SEND_SIGNALED;
+  ibv_send_wr* bad_wr;
+  int ret = ibv_post_send(m_cm_id->qp, &wr, &bad_wr);
+  if (ret) {
+    throw exception::socket::generic_error(
+        "Error on ibv_post_send: " + std::string(strerror(ret)));
+  }
+  ++m_updates_sent;
+}
+
+void Socket::register_memory(void* buffer, size_t size) {
+  if (m_mrs.find(buffer, size)) {
+    return;
+  }
+  ibv_mr* mr = RegistrationCache::get_instance().acquire(
+      m_cm_id->pd,
+      buffer,
+      size);
+  m_mrs.insert(buffer, size, mr);
+}
+
+size_t Socket::poll_completed_send(iovec* iov, size_t n) {
+  // The writer gets the updates of the ring while polling its writes
+  if (m_ring_writer && !m_cq) {
+    auto& wcs = m_comp_recv;
+    int ret = ibv_poll_cq(m_cm_id->recv_cq, wcs.size(), &wcs.front());
+    if (ret < 0) {
+      throw exception::socket::generic_error(
+          "Error on ibv_poll_cq: " + std::string(strerror(ret)));
+    }
+    for (int i = 0; i < ret; ++i) {
+      if (wcs[i].status) {
+        throw exception::socket::generic_error(
+            "Error status in wc of recv_cq: "
+                + std::string(ibv_wc_status_str(wcs[i].status)));
+      }
+      complete_recv(wcs[i]);
+    }
+  }
+
+  // A completion can retire more sends than the space left in iov, the
+  // remaining ones are handed back in the next call
+  size_t count = 0;
+  uint32_t index;
+  while (count < n && m_send_order.pop(index)) {
+    iov[count++] = m_pending_send.release(index);
+  }
+  if (count == n || m_cq) {
+    return count;
+  }
+
   auto& wcs = m_comp_send;
-  int ret = ibv_poll_cq(m_cm_id->send_cq, wcs.size(), &wcs.front());
+  int ret = ibv_poll_cq(m_cm_id->send_cq, std::min(n - count, wcs.size()),
+      &wcs.front());
   if (ret < 0) {
     throw exception::socket::generic_error(
         "Error on ibv_poll_cq: " + std::string(strerror(ret)));
   }
-  std::vector<iovec> iov_vect;
-  iov_vect.reserve(ret);
-  for (auto wcs_it = std::begin(wcs); wcs_it != std::begin(wcs) + ret;
-      ++wcs_it) {
-    if (wcs_it->status) {
+  for (int i = 0; i < ret; ++i) {
+    if (wcs[i].status) {
       throw exception::socket::generic_error(
           "Error status in wc of send_cq: "
-              + std::string(ibv_wc_status_str(wcs_it->status)));
+              + std::string(ibv_wc_status_str(wcs[i].status)));
     }
-    auto map_it = m_pending_send.find(reinterpret_cast<void*>(wcs_it->wr_id));
-    if (map_it == std::end(m_pending_send)) {
+    complete_send(wcs[i]);
+  }
+
+  while (count < n && m_send_order.pop(index)) {
+    iov[count++] = m_pending_send.release(index);
+  }
+  return count;
+}
+
+size_t Socket::poll_completed_recv(iovec* iov, size_t n) {
+  if (m_ring_receiver && !m_cq) {
+    auto& wcs = m_comp_send;
+    int ret = ibv_poll_cq(m_cm_id->send_cq, wcs.size(), &wcs.front());
+    if (ret < 0) {
       throw exception::socket::generic_error(
-          "Error on erase: key element not exists");
+          "Error on ibv_poll_cq: " + std::string(strerror(ret)));
+    }
+    for (int i = 0; i < ret; ++i) {
+      if (wcs[i].status) {
+        throw exception::socket::generic_error(
+            "Error status in wc of send_cq: "
+                + std::string(ibv_wc_status_str(wcs[i].status)));
+      }
+      complete_send(wcs[i]);
     }
-    iov_vect.push_back( { map_it->first, map_it->second });
-    m_pending_send.erase(map_it);
+  }
+  if (m_update_pending) {
+    send_update();
   }
 
-  return iov_vect;
-}
+  if (m_cq) {
+    size_t const count = std::min(n, m_recv_done.size());
+    std::copy(
+        std::begin(m_recv_done),
+        std::begin(m_recv_done) + count,
+        iov);
+    m_recv_done.erase(
+        std::begin(m_recv_done),
+        std::begin(m_recv_done) + count);
+    if (m_ring_receiver) {
+      post_write_recvs(count);
+    }
+    return count;
+  }
 
-std::vector<iovec> Socket::poll_completed_recv() {
+  SlotArray& pending = m_srq ? m_srq->pending : m_pending_recv;
   auto& wcs = m_comp_recv;
-  int ret = ibv_poll_cq(m_cm_id->recv_cq, wcs.size(), &wcs.front());
+  int ret = ibv_poll_cq(m_cm_id->recv_cq, std::min(n, wcs.size()),
+      &wcs.front());
   if (ret < 0) {
     throw exception::socket::generic_error(
         "Error on ibv_poll_cq: " + std::string(strerror(ret)));
   }
-  std::vector<iovec> iov_vect;
-  iov_vect.reserve(ret);
-  for (auto wcs_it = std::begin(wcs); wcs_it != std::begin(wcs) + ret;
-      ++wcs_it) {
-    if (wcs_it->status) {
+  for (int i = 0; i < ret; ++i) {
+    if (wcs[i].status) {
       throw exception::socket::generic_error(
           "Error status in wc of recv_cq: "
-              + std::string(ibv_wc_status_str(wcs_it->status)));
+              + std::string(ibv_wc_status_str(wcs[i].status)));
     }
-    auto map_it = m_pending_recv.find(reinterpret_cast<void*>(wcs_it->wr_id));
-    if (map_it == std::end(m_pending_recv)) {
-      throw exception::socket::generic_error(
-          "Error on erase: key element not exists");
+    if (m_ring_receiver) {
+      iov[i] = receive_write(wcs[i]);
+    } else {
+      // The buffer is reported with the length of the message received in it
+      iov[i] = pending.release(wcs[i].wr_id);
+      iov[i].iov_len = wcs[i].byte_len;
     }
-    iov_vect.push_back( { map_it->first, map_it->second });
-    m_pending_recv.erase(map_it);
+  }
+  if (m_ring_receiver) {
+    post_write_recvs(ret);
   }
 
-  return iov_vect;
+  return ret;
 }
 
 void Socket::post_send(iovec const& iov) {
+  post_send(&iov, 1);
+}
+
+void Socket::post_recv(iovec const& iov) {
+  post_recv(&iov, 1);
+}
 
-  if (!available_send()) {
+void Socket::post_send(iovec const* iov, size_t n) {
+  if (m_pending_send.size() + n > m_credits) {
     throw exception::socket::generic_error(
         "Error on post_send: no credits available");
   }
+  if (!n) {
+    return;
+  }
+
+  for (size_t i = 0; i < n; ++i) {
+    ibv_mr* const* mr = m_mrs.find(iov[i].iov_base, iov[i].iov_len);
+    if (!mr) {
+      throw exception::socket::generic_error(
+          "Error on find_mr: no valid memory regions found");
+    }
+    ibv_sge& sge = m_send_sges[i];
+    sge.addr = reinterpret_cast<uint64_t>(iov[i].iov_base);
+    sge.length = iov[i].iov_len;
+    sge.lkey = (*mr)->lkey;
+
+    ibv_send_wr& wr = m_send_wrs[i];
+    wr.sg_list = &sge;
+    wr.num_sge = 1;
+    if (m_ring_writer) {
+      uint32_t immediate;
+      wr.wr.rdma.remote_addr = m_ring_writer->place(iov[i].iov_len, immediate);
+      wr.wr.rdma.rkey = m_ring_writer->key();
+      wr.imm_data = htonl(immediate);
+    }
+  }
+
+  post_send_wrs(iov, n);
+}
 
-  auto mr_it = find_mr(m_mrs, iov);
-  if (mr_it == std::end(m_mrs)) {
+void Socket::post_sendv(iovec const* iov, size_t n) {
+  if (m_pending_send.full()) {
+    throw exception::socket::generic_error(
+        "Error on post_sendv: no credits available");
+  }
+  if (!n || n > MAX_SEND_SGE) {
     throw exception::socket::generic_error(
-        "Error on find_mr: no valid memory regions found");
+        "Error on post_sendv: wrong number of segments");
   }
 
-  ibv_sge sge;
-  sge.addr = reinterpret_cast<uint64_t>(iov.iov_base);
-  sge.length = iov.iov_len;
-  sge.lkey = (*mr_it)->lkey;
+  // A single work request gathers all the segments
+  iovec message = { iov[0].iov_base, 0 };
+  for (size_t i = 0; i < n; ++i) {
+    ibv_mr* const* mr = m_mrs.find(iov[i].iov_base, iov[i].iov_len);
+    if (!mr) {
+      throw exception::socket::generic_error(
+          "Error on find_mr: no valid memory regions found");
+    }
+    ibv_sge& sge = m_send_sges[i];
+    sge.addr = reinterpret_cast<uint64_t>(iov[i].iov_base);
+    sge.length = iov[i].iov_len;
+    sge.lkey = (*mr)->lkey;
+    message.iov_len += iov[i].iov_len;
+  }
 
-  ibv_send_wr wr;
-  wr.wr_id = reinterpret_cast<uint64_t>(iov.iov_base);
-  wr.next = nullptr;
-  wr.sg_list = &sge;
-  wr.num_sge = 1;
-  wr.opcode = IBV_WR_SEND;
-  wr.send_flags = 0;
+  ibv_send_wr& wr = m_send_wrs.front();
+  wr.sg_list = &m_send_sges.front();
+  wr.num_sge = n;
+  if (m_ring_writer) {
+    uint32_t immediate;
+    wr.wr.rdma.remote_addr = m_ring_writer->place(message.iov_len, immediate);
+    wr.wr.rdma.rkey = m_ring_writer->key();
+    wr.imm_data = htonl(immediate);
+  }
+
+  post_send_wrs(&message, 1);
+}
+
+void Socket::post_send_wrs(iovec const* iov, size_t n) {
+  int const unsignaled = m_unsignaled;
+
+  // Chain the work requests, so that they are posted with a single doorbell
+  for (size_t i = 0; i < n; ++i) {
+    ibv_send_wr& wr = m_send_wrs[i];
+    wr.wr_id = m_pending_send.acquire(iov[i]);
+    wr.next = (i + 1 < n) ? &m_send_wrs[i + 1] : nullptr;
+    wr.opcode = m_ring_writer ? IBV_WR_RDMA_WRITE_WITH_IMM : IBV_WR_SEND;
+    wr.send_flags = 0;
+    if (++m_unsignaled == m_signal_interval) {
+      wr.send_flags = IBV_SEND_SIGNALED;
+      m_unsignaled = 0;
+    }
+    m_send_order.push(wr.wr_id);
+  }
 
   ibv_send_wr* bad_wr;
-  int ret = ibv_post_send(m_cm_id->qp, &wr, &bad_wr);
+  int ret = ibv_post_send(m_cm_id->qp, &m_send_wrs.front(), &bad_wr);
   if (ret) {
+    // The work requests before bad_wr have been posted, and only they count
+    // towards the next signaled one
+    m_unsignaled = unsignaled;
+    for (ibv_send_wr* wr = &m_send_wrs.front(); wr != bad_wr; wr = wr->next) {
+      if (++m_unsignaled == m_signal_interval) {
+        m_unsignaled = 0;
+      }
+    }
+    for (ibv_send_wr* wr = bad_wr; wr; wr = wr->next) {
+      m_pending_send.release(wr->wr_id);
+      m_send_order.rewind(1);
+    }
     throw exception::socket::generic_error(
         "Error on ibv_post_send: " + std::string(strerror(ret)));
   }
+}
 
-  auto p = m_pending_send.insert(
-      std::pair<void*, size_t>(iov.iov_base, iov.iov_len));
-  if (!p.second) {
-    throw exception::socket::generic_error(
-        "Error on insert: key element already exists");
+void Socket::post_recv(iovec const* iov, size_t n) {
+  if (m_ring_receiver) {
+    if (m_ring_receiver->created()) {
+      for (size_t i = 0; i < n; ++i) {
+        m_ring_receiver->release(iov[i]);
+      }
+    } else {
+      if (n > m_credits) {
+        throw exception::socket::generic_error(
+            "Error on post_recv: no credits available");
+      }
+      size_t const slots = n * write_ring::MESSAGES_PER_BUFFER;
+      m_ring_receiver->create(iov, n, slots);
+      m_ring_mr = ibv_reg_mr(
+          m_cm_id->pd,
+          m_ring_receiver->base(),
+          m_ring_receiver->size(),
+          IBV_ACCESS_LOCAL_WRITE | IBV_ACCESS_REMOTE_WRITE);
+      if (!m_ring_mr) {
+        throw exception::socket::generic_error(
+            "Error on ibv_reg_mr: " + std::string(strerror(errno)));
+      }
+      m_ring_receiver->update().addr =
+          reinterpret_cast<uint64_t>(m_ring_receiver->base());
+      m_ring_receiver->update().key = m_ring_mr->rkey;
+      post_write_recvs(slots);
+    }
+    send_update();
+    return;
   }
-}
 
-void Socket::post_recv(iovec const& iov) {
-  if (!available_recv()) {
+  SlotArray& pending = m_srq ? m_srq->pending : m_pending_recv;
+  auto& wrs = m_srq ? m_srq->wrs : m_recv_wrs;
+  auto& sges = m_srq ? m_srq->sges : m_recv_sges;
+  if (pending.size() + n > pending.capacity()) {
     throw exception::socket::generic_error(
         "Error on post_recv: no credits available");
   }
-
-  auto mr_it = find_mr(m_mrs, iov);
-  if (mr_it == std::end(m_mrs)) {
-    throw exception::socket::generic_error(
-        "Error on find_mr: no valid memory regions found");
+  if (!n) {
+    return;
   }
 
-  ibv_sge sge;
-  sge.addr = reinterpret_cast<uint64_t>(iov.iov_base);
-  sge.length = iov.iov_len;
-  sge.lkey = (*mr_it)->lkey;
+  for (size_t i = 0; i < n; ++i) {
+    ibv_mr* const* mr = m_mrs.find(iov[i].iov_base, iov[i].iov_len);
+    if (!mr) {
+      throw exception::socket::generic_error(
+          "Error on find_mr: no valid memory regions found");
+    }
+    ibv_sge& sge = sges[i];
+    sge.addr = reinterpret_cast<uint64_t>(iov[i].iov_base);
+    sge.length = iov[i].iov_len;
+    sge.lkey = (*mr)->lkey;
+  }
 
-  ibv_recv_wr wr;
-  wr.wr_id = reinterpret_cast<uint64_t>(iov.iov_base);
-  wr.next = nullptr;
-  wr.sg_list = &sge;
-  wr.num_sge = 1;
+  for (size_t i = 0; i < n; ++i) {
+    ibv_recv_wr& wr = wrs[i];
+    wr.wr_id = pending.acquire(iov[i]);
+    wr.next = (i + 1 < n) ? &wrs[i + 1] : nullptr;
+    wr.sg_list = &sges[i];
+    wr.num_sge = 1;
+  }
 
   ibv_recv_wr* bad_wr;
-  int ret = ibv_post_recv(m_cm_id->qp, &wr, &bad_wr);
+  int ret = m_srq ?
+      ibv_post_srq_recv(m_srq->srq, &wrs.front(), &bad_wr) :
+      ibv_post_recv(m_cm_id->qp, &wrs.front(), &bad_wr);
   if (ret) {
+    for (ibv_recv_wr* wr = bad_wr; wr; wr = wr->next) {
+      pending.release(wr->wr_id);
+    }
     throw exception::socket::generic_error(
         "Error on ibv_post_recv: " + std::string(strerror(ret)));
   }
-
-  auto p = m_pending_recv.insert(
-      std::pair<void*, size_t>(iov.iov_base, iov.iov_len));
-  if (!p.second) {
-    throw exception::socket::generic_error(
-        "Error on insert: key element already exists");
-  }
 }
 
 bool Socket::available_send() {
-  return m_pending_send.size() < m_credits;
+  return !m_pending_send.full()
+      && (!m_ring_writer || m_ring_writer->available());
 }
 
 bool Socket::available_recv() {
-  return m_pending_recv.size() < m_credits;
+  if (m_ring_receiver) {
+    return !m_ring_receiver->created() || m_ring_receiver->held();
+  }
+  return !(m_srq ? m_srq->pending : m_pending_recv).full();
 }
 
 std::vector<iovec> Socket::pending_send() {
-  std::vector<iovec> iov_vect;
-  iov_vect.reserve(m_pending_send.size());
-  for (auto const& pair : m_pending_send) {
-    iov_vect.push_back( { pair.first, pair.second });
-  }
-  return iov_vect;
+  return m_pending_send.pending();
 }
 
 std::vector<iovec> Socket::pending_recv() {
-  std::vector<iovec> iov_vect;
-  iov_vect.reserve(m_pending_recv.size());
-  for (auto const& pair : m_pending_recv) {
-    iov_vect.push_back( { pair.first, pair.second });
+  if (m_ring_receiver) {
+    if (!m_ring_receiver->created()) {
+      return {};
+    }
+    return { {m_ring_receiver->base(), m_ring_receiver->size()} };
+  }
+  return (m_srq ? m_srq->pending : m_pending_recv).pending();
+}
+
+std::vector<int> Socket::wait_fds() {
+  if (m_cq) {
+    return m_cq->wait_fds();
+  }
+  std::vector<int> fds;
+  if (m_cm_id->send_cq_channel) {
+    fds.push_back(m_cm_id->send_cq_channel->fd);
+  }
+  if (m_cm_id->recv_cq_channel) {
+    fds.push_back(m_cm_id->recv_cq_channel->fd);
+  }
+  return fds;
+}
+
+bool Socket::arm_wait() {
+  if (m_cq) {
+    return m_cq->arm_wait();
+  }
+  if (m_cm_id->send_cq_channel) {
+    arm_completion_queue(m_cm_id->send_cq_channel, m_cm_id->send_cq);
+  }
+  if (m_cm_id->recv_cq_channel) {
+    arm_completion_queue(m_cm_id->recv_cq_channel, m_cm_id->recv_cq);
   }
-  return iov_vect;
+  return true;
 }
 
 std::string Socket::peer_hostname() {
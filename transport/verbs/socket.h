@@ -1,7 +1,7 @@
 #ifndef TRANSPORT_VERBS_SOCKET_H
 #define TRANSPORT_VERBS_SOCKET_H
 
-#include <map>
+#include <memory>
 #include <vector>
 #include <string>
 
@@ -10,6 +10,13 @@
 #include <infiniband/verbs.h>
 #include <rdma/rdma_cma.h>
 
+#include "transport/connection.h"
+#include "transport/verbs/completion_queue.h"
+#include "transport/memory_regions.h"
+#include "transport/retire_queue.h"
+#include "transport/slot_array.h"
+#include "transport/write_ring.h"
+
 namespace lseb {
 
 namespace verbs {
@@ -18,38 +25,121 @@ static const uint8_t RNR_RETRY_COUNT = 7;
 static const uint8_t MIN_RTR_TIMER = 1;
 }
 
-class Socket {
+// Receive queue shared by all the sockets of an acceptor, so that the buffers
+// are consumed by the peers that are sending instead of being reserved to
+// each one. The completions are still delivered to the queue of each socket.
+// The queue pairs attached to it must belong to its protection domain.
+struct SharedReceiveQueue {
+  ibv_pd* pd;
+  ibv_srq* srq;
+  SlotArray pending;  // the index of the slot is the wr_id
+  std::vector<ibv_recv_wr> wrs;
+  std::vector<ibv_sge> sges;
+
+  SharedReceiveQueue(ibv_context* context, uint32_t size);
+  SharedReceiveQueue(SharedReceiveQueue const& other) = delete;  // non construction-copyable
+  SharedReceiveQueue& operator=(SharedReceiveQueue const&) = delete;  // non copyable
+  ~SharedReceiveQueue();
+};
+
+class Socket : public Connection {
 
   rdma_cm_id* m_cm_id;
-  std::vector<ibv_mr*> m_mrs;
+  MemoryRegions<ibv_mr*> m_mrs;  // shared with the other connections
   uint32_t m_credits;
-  std::map<void*, size_t> m_pending_send;
-  std::map<void*, size_t> m_pending_recv;
+  SlotArray m_pending_send;  // the index of the slot is the wr_id
+  SlotArray m_pending_recv;
+  std::shared_ptr<SharedReceiveQueue> m_srq;
+
+  // Only one send every m_signal_interval generates a completion
+  int m_signal_interval;
+  int m_unsignaled;
+  RetireQueue m_send_order;
   std::vector<ibv_wc> m_comp_send;
   std::vector<ibv_wc> m_comp_recv;
 
+  // Work requests of a batch, chained and posted together
+  std::vector<ibv_send_wr> m_send_wrs;
+  std::vector<ibv_recv_wr> m_recv_wrs;
+  std::vector<ibv_sge> m_send_sges;
+  std::vector<ibv_sge> m_recv_sges;
+
+  // With a shared completion queue, the completions are handed over by it:
+  // the sends are retired in m_send_order, the receives queued here
+  std::shared_ptr<CompletionQueue> m_cq;
+  std::vector<iovec> m_recv_done;
+
+  // With the write ring, only one of the two is set. The updates of the ring
+  // are sent from, or received into, the registered m_updates.
+  std::unique_ptr<RingWriter> m_ring_writer;
+  std::unique_ptr<RingReceiver> m_ring_receiver;
+  ibv_mr* m_ring_mr;
+  std::vector<RingUpdate> m_updates;
+  ibv_mr* m_updates_mr;
+  uint64_t m_updates_sent;
+  uint64_t m_updates_done;
+  bool m_update_pending;
+
+  friend class CompletionQueue;
+
+  // Account a successful work completion
+  void complete_send(ibv_wc const& wc);
+  void complete_recv(ibv_wc const& wc);
+
+  // The writes are received into the ring, consuming a receive each
+  iovec receive_write(ibv_wc const& wc);
+  void post_write_recvs(size_t n);
+  void post_update_recv(uint64_t index);
+  void send_update();
+
+  // Post the first n work requests of m_send_wrs, whose buffers are already
+  // set: iov is what each one reports on completion
+  void post_send_wrs(iovec const* iov, size_t n);
+
  public:
 
-  Socket(rdma_cm_id* cm_id, uint32_t credits);
+  // Receives are posted to srq, if given, instead of to the queue pair. The
+  // queue pair must use the queues of cq, if given.
+  Socket(
+      rdma_cm_id* cm_id,
+      uint32_t credits,
+      int signal_interval = 1,
+      std::shared_ptr<SharedReceiveQueue> const& srq = nullptr,
+      std::shared_ptr<CompletionQueue> const& cq = nullptr);
   Socket(Socket const& other) = delete;  // non construction-copyable
   Socket& operator=(Socket const&) = delete;  // non copyable
-  ~Socket();
+  ~Socket() override;
+
+  // One-sided mode: the messages are written with RDMA_WRITE_WITH_IMM into a
+  // ring of the receiver, made of the buffers of its first post_recv, which
+  // must be contiguous. The following post_recv give back the space of the
+  // received messages, in the order in which they have been received. It
+  // must be called on both sides, before any other operation.
+  void enable_write_ring(bool writer);
+
+  void register_memory(void* buffer, size_t size) override;
 
-  void register_memory(void* buffer, size_t size);
+  using Connection::poll_completed_send;
+  using Connection::poll_completed_recv;
+  size_t poll_completed_send(iovec* iov, size_t n) override;
+  size_t poll_completed_recv(iovec* iov, size_t n) override;
 
-  std::vector<iovec> poll_completed_send();
-  std::vector<iovec> poll_completed_recv();
+  void post_send(iovec const& iov) override;
+  void post_recv(iovec const& iov) override;
+  void post_send(iovec const* iov, size_t n) override;
+  void post_recv(iovec const* iov, size_t n) override;
+  void post_sendv(iovec const* iov, size_t n) override;
 
-  void post_send(iovec const& iov);
-  void post_recv(iovec const& iov);
+  bool available_send() override;
+  bool available_recv() override;
 
-  bool available_send();
-  bool available_recv();
+  std::vector<iovec> pending_send() override;
+  std::vector<iovec> pending_recv() override;
 
-  std::vector<iovec> pending_send();
-  std::vector<iovec> pending_recv();
+  std::string peer_hostname() override;
 
-  std::string peer_hostname();
+  std::vector<int> wait_fds() override;
+  bool arm_wait() override;
 };
 
 }
@@ -0,0 +1,253 @@
+#ifndef TRANSPORT_WRITE_RING_H
+#define TRANSPORT_WRITE_RING_H
+
+#include <algorithm>
+#include <vector>
+
+#include <cstdint>
+
+#include <sys/uio.h>
+
+#include "common/exception.h"
+
+namespace lseb {
+
+// Ring of the receiver, sent to the writer when the ring is created and each
+// time that some space is released. Only the latest one matters.
+struct RingUpdate {
+  uint64_t addr;  // remote address of the beginning of the ring
+  uint64_t key;
+  uint64_t size;
+  uint64_t chunk;  // longest message
+  uint64_t slots;  // messages that can be in the ring at the same time
+  uint64_t consumed_bytes;  // offset up to which the space is free again
+  uint64_t consumed_msgs;
+};
+
+namespace write_ring {
+
+// Updates sent and not yet received by the writer
+static const uint32_t UPDATES = 4;
+
+// Messages shorter than the buffers posted to create the ring are packed, so
+// that it holds up to this many messages per buffer
+static const uint32_t MESSAGES_PER_BUFFER = 2;
+
+// The 32 bits of immediate data of a write carry its length and the lowest
+// bits of its sequence number, checked by the receiver
+static const uint32_t LENGTH_BITS = 24;
+static const uint32_t MAX_LENGTH = (1U << LENGTH_BITS) - 1;
+
+inline uint32_t immediate(uint64_t count, uint64_t len) {
+  return static_cast<uint32_t>(count << LENGTH_BITS)
+      | static_cast<uint32_t>(len);
+}
+
+inline uint64_t length(uint32_t immediate) {
+  return immediate & MAX_LENGTH;
+}
+
+inline bool in_sequence(uint32_t immediate, uint64_t count) {
+  return immediate >> LENGTH_BITS
+      == static_cast<uint32_t>(count << LENGTH_BITS) >> LENGTH_BITS;
+}
+
+}
+
+// Placement of messages written at byte granularity into a ring of the
+// receiver. A message is never split at the end of the ring, it is written at
+// the beginning instead. Offsets grow monotonically and are taken modulo the
+// size, so that the writer and the receiver place the messages in the same
+// way knowing only their lengths.
+
+class WriteRing {
+  uint64_t m_size;
+  uint64_t m_offset;  // end of the last message placed
+  uint64_t m_count;  // messages placed
+
+ public:
+  explicit WriteRing(uint64_t size = 0)
+      : m_size(size),
+        m_offset(0),
+        m_count(0) {
+  }
+
+  // Bytes taken by a message of length len, including the end of the ring
+  // skipped to place it
+  uint64_t required(uint64_t len) const {
+    uint64_t const position = m_offset % m_size;
+    return (position + len > m_size ? m_size - position : 0) + len;
+  }
+
+  // Place a message of length len and return its position in the ring
+  uint64_t place(uint64_t len) {
+    m_offset += required(len) - len;
+    uint64_t const position = m_offset % m_size;
+    m_offset += len;
+    ++m_count;
+    return position;
+  }
+
+  // Whether a message of length len can be placed, given the last update
+  bool fits(uint64_t len, RingUpdate const& update) const {
+    return m_offset + required(len) - update.consumed_bytes <= m_size
+        && m_count - update.consumed_msgs < update.slots;
+  }
+
+  uint64_t offset() const {
+    return m_offset;
+  }
+
+  uint64_t count() const {
+    return m_count;
+  }
+};
+
+// Bookkeeping of the receiver. The buffers posted first make up the ring,
+// the ones posted afterwards give back the space of the received messages,
+// which must be released in the order in which they have been received.
+
+class RingReceiver {
+  // A message held in the ring: where it starts, and the offset of its end
+  struct Placed {
+    uint64_t position;
+    uint64_t end;
+  };
+
+  unsigned char* m_base;
+  WriteRing m_ring;
+  std::vector<Placed> m_placed;  // by count of the messages
+  RingUpdate m_update;
+
+ public:
+  RingReceiver()
+      : m_base(nullptr),
+        m_update() {
+  }
+
+  bool created() const {
+    return m_base;
+  }
+
+  void create(iovec const* iov, size_t n, uint64_t slots) {
+    if (!n) {
+      throw exception::socket::generic_error(
+          "Error on create: empty ring");
+    }
+    m_base = static_cast<unsigned char*>(iov[0].iov_base);
+    m_update.size = 0;
+    m_update.chunk = 0;
+    for (size_t i = 0; i < n; ++i) {
+      if (iov[i].iov_base != m_base + m_update.size) {
+        throw exception::socket::generic_error(
+            "Error on create: ring buffers not contiguous");
+      }
+      m_update.size += iov[i].iov_len;
+      m_update.chunk = std::max<uint64_t>(m_update.chunk, iov[i].iov_len);
+    }
+    if (m_update.chunk > write_ring::MAX_LENGTH) {
+      throw exception::socket::generic_error(
+          "Error on create: ring buffers too long for the immediate data");
+    }
+    m_update.slots = slots;
+    m_ring = WriteRing(m_update.size);
+    m_placed.resize(slots);
+  }
+
+  void* base() const {
+    return m_base;
+  }
+
+  uint64_t size() const {
+    return m_update.size;
+  }
+
+  // Messages received and not yet released
+  uint64_t held() const {
+    return m_ring.count() - m_update.consumed_msgs;
+  }
+
+  // The transport fills in how the writer addresses the ring
+  RingUpdate& update() {
+    return m_update;
+  }
+
+  // A message has been written, with the given immediate data
+  iovec receive(uint32_t immediate) {
+    uint64_t const len = write_ring::length(immediate);
+    if (!write_ring::in_sequence(immediate, m_ring.count())
+        || held() == m_update.slots
+        || len > m_update.chunk) {
+      throw exception::socket::generic_error(
+          "Error on receive: write out of the ring");
+    }
+    uint64_t const position = m_ring.place(len);
+    m_placed[(m_ring.count() - 1) % m_placed.size()] =
+        { position, m_ring.offset() };
+    return {m_base + position, len};
+  }
+
+  // Give back the space of the oldest message received, which iov must start
+  void release(iovec const& iov) {
+    if (!held()) {
+      throw exception::socket::generic_error(
+          "Error on release: no message in the ring");
+    }
+    Placed const& oldest = m_placed[m_update.consumed_msgs % m_placed.size()];
+    if (iov.iov_base != m_base + oldest.position) {
+      throw exception::socket::generic_error(
+          "Error on release: messages released out of order");
+    }
+    m_update.consumed_bytes = oldest.end;
+    ++m_update.consumed_msgs;
+  }
+};
+
+// Bookkeeping of the writer, which places the messages according to the
+// latest update of the receiver
+
+class RingWriter {
+  WriteRing m_ring;
+  RingUpdate m_update;
+  bool m_ready;
+
+ public:
+  RingWriter()
+      : m_update(),
+        m_ready(false) {
+  }
+
+  void update(RingUpdate const& update) {
+    if (!m_ready) {
+      m_ring = WriteRing(update.size);
+      m_update = update;
+      m_ready = true;
+    } else if (update.consumed_msgs > m_update.consumed_msgs) {
+      m_update = update;
+    }
+  }
+
+  // Whether a message of any length can be written
+  bool available() const {
+    return m_ready && m_ring.fits(m_update.chunk, m_update);
+  }
+
+  // Place a message of length len, returning its remote address and the
+  // immediate data of the write
+  uint64_t place(uint64_t len, uint32_t& immediate) {
+    if (!m_ready || len > m_update.chunk || !m_ring.fits(len, m_update)) {
+      throw exception::socket::generic_error(
+          "Error on place: no space in the ring");
+    }
+    immediate = write_ring::immediate(m_ring.count(), len);
+    return m_update.addr + m_ring.place(len);
+  }
+
+  uint64_t key() const {
+    return m_update.key;
+  }
+};
+
+}
+
+#endif